@@ -34,6 +34,7 @@
 #define ESTAR2_CELL_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,22 +43,88 @@ extern "C" {
 
 enum {
   ESTAR_FLAG_GOAL     = 1,
-  ESTAR_FLAG_OBSTACLE = 2
+  ESTAR_FLAG_OBSTACLE = 2,
+  ESTAR_FLAG_GHOST    = 4,	/* rhs is set from outside, see parallel.h */
+  ESTAR_FLAG_LAZY     = 8,	/* cost not asked for yet, see estar_set_speed_source() */
+  ESTAR_FLAG_OUTSIDE  = 16	/* beyond the region of interest, see estar_set_roi() */
 };
 
 
+/* Building with the ESTAR_COMPACT option (which defines the macro of
+   the same name) shrinks the cells for very large maps. Everything
+   that includes this header has to be compiled with the same setting,
+   estar_compact_enabled() tells how the library was built.
+
+   Per cell on a 64-bit machine, the default layout takes 160 bytes:
+   32 for the four doubles, 16 for pqi and flags (with padding), 40 for
+   nbor and 72 for prop. The compact one takes 64 bytes: 16 for four
+   floats, 8 for pqi, flags and nxnbor (with padding), and 40 for nbor.
+   It has no prop array, the propagator pairs get assembled from nbor
+   on the fly (see estar_cell_prop()). Floats keep about 7 significant
+   digits, so phi remains accurate to better than a hundredth of a cell
+   up to distances of some 10000 cells, and queue indices limit the
+   grid to less than 2^32 cells.
+
+   Add the optional per-cell arrays of estar_t (4 bytes for
+   estar_set_speed_frame(), 8 per queued cell) for the total: 400
+   million compact cells need 25.6 GB for the grid, or about 27.3 GB
+   with a speed frame and 10 million queued cells. */
+#ifdef ESTAR_COMPACT
+typedef float estar_real_t;
+typedef uint32_t estar_pqi_t;
+typedef uint8_t estar_flags_t;
+#else
+typedef double estar_real_t;
+typedef size_t estar_pqi_t;
+typedef int estar_flags_t;
+#endif
+
+
 typedef struct estar_cell_s {
-  double cost;			 /* set this to 1/speed for "sensible" values */
-  double phi;
-  double rhs;
-  double key;			 /* managed by pqueue */
-  size_t pqi;			 /* managed by pqueue; pqi==0 means "not on queue" */
-  int flags;
+  estar_real_t cost;		 /* set this to 1/speed for "sensible" values */
+  estar_real_t phi;
+  estar_real_t rhs;
+  estar_real_t key;		 /* managed by pqueue */
+  estar_pqi_t pqi;		 /* managed by pqueue; pqi==0 means "not on queue" */
+  estar_flags_t flags;
+#ifdef ESTAR_COMPACT
+  uint8_t nxnbor;		 /* how many of nbor are to the east or west */
+#endif
   struct estar_cell_s * nbor[5]; /* null-terminated array of neighbors */
+#ifndef ESTAR_COMPACT
   struct estar_cell_s * prop[9]; /* null-terminated array of pairwise propagators */
+#endif
 } estar_cell_t;
 
 
+/* The propagator pairs of a cell: one east or west and one north or
+   south neighbor each, with the east or west one first, and terminated
+   by a null pointer. Compact cells do not store them, in which case
+   they are written to buf (which has room for 9 pointers). */
+static inline estar_cell_t ** estar_cell_prop (estar_cell_t * cell, estar_cell_t ** buf)
+{
+#ifdef ESTAR_COMPACT
+  size_t ix, iy, nn;
+  
+  nn = 0;
+  for (ix = 0; ix < cell->nxnbor; ++ix) {
+    for (iy = cell->nxnbor; NULL != cell->nbor[iy]; ++iy) {
+      buf[nn++] = cell->nbor[ix];
+      buf[nn++] = cell->nbor[iy];
+    }
+  }
+  buf[nn] = NULL;
+  return buf;
+#else
+  return cell->prop;
+#endif
+}
+
+
+/* Gradient of the rhs around a cell, towards its lowest neighbor.
+   Returns 0 and leaves gx and gy alone if no neighbor lies below the
+   cell, otherwise the number of axes that contribute (1 or 2). For a
+   cell at infinity next to finite ones, the components are infinite. */
 int estar_cell_calc_gradient (estar_cell_t * cell, double * gx, double * gy);
 
 
@@ -97,6 +97,14 @@
    }
    \endcode     
    
+   For use in real-time loops, call estar_reserve() right after
+   estar_init().  From then on, estar_set_goal(), estar_set_speed(),
+   and estar_propagate() never allocate memory and never exit the
+   process.  Instead, they return ESTAR_EFULL when the queue runs out
+   of space.  Reserving room for all dimx * dimy cells guarantees that
+   this never happens, because each cell is on the queue at most
+   once.
+   
    To trace back a solution path from a given cell to the goal depends
    on that cell having been visited, have a look at the
    cb_phi_expose() function in the gester.c sources, towards the end
@@ -109,12 +117,97 @@
 
 #include <estar2/grid.h>
 #include <estar2/pqueue.h>
+#include <estar2/profile.h>
+#include <estar2/record.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
+/**
+   State of the optional focused mode, see estar_set_focus().  The
+   heuristic is the Euclidean distance to the query cell, scaled by
+   the smallest cost ever seen in the grid so that it never
+   overestimates.  The key modifier km plays the same role as in
+   D*-Lite: it accumulates the heuristic distance travelled by the
+   query cell, so that keys computed before a move remain valid lower
+   bounds and need not all be recomputed.
+   
+   Unlike on a plain graph, the heuristic cannot be fully consistent
+   with the interpolated update: a cell can depend on a neighbor whose
+   value is only marginally smaller.  So the heuristic is further
+   scaled by a weight below one, and cells whose phi and rhs differ by
+   less than a fraction of their cost are considered consistent.  The
+   defaults set by estar_init() roughly halve the number of expanded
+   cells on open maps while keeping the values between goal and query
+   cell within about 0.05% of the unfocused result.  Raising the
+   weight towards one narrows the wavefront further, but quickly
+   leads to many re-expansions; lowering the tolerance improves the
+   accuracy at the price of more re-expansions.
+*/
+typedef struct {
+  estar_cell_t * cell;		/* query cell, NULL means unfocused */
+  size_t ix, iy;
+  double scale;			/* lower bound on the cost of any cell */
+  double km;			/* key modifier */
+  double weight;		/* heuristic weight, in (0, 1] */
+  double tolerance;		/* consistency tolerance, relative to cost */
+} estar_focus_t;
+
+
+/**
+   Counters of what happened during propagation, see
+   estar_stats_snapshot().  They are only maintained when the library
+   is built with the ESTAR_STATS option (check estar_stats_enabled()
+   at runtime), otherwise the code to update them is compiled out and
+   they stay at zero.  The structure itself is always there, so that
+   estar_t has the same layout either way.
+   
+   Queue counters: a cell that gets queued while not yet on the queue
+   is an insert, a cell whose key changes while queued is an update.
+   Removes only count cells that were actually on the queue.  Each
+   expansion in estar_propagate() is either a raise (phi goes to
+   infinity and the cell gets re-evaluated) or a lower (phi drops to
+   rhs).  Each candidate value computed for a propagator pair is
+   either interpolated from both cells of the pair, or not (the
+   secondary is unusable or too far above the primary).  The fallback
+   counts how often calc_rhs() had to resort to the plain
+   non-interpolated minimum over all neighbors.
+*/
+typedef struct {
+  unsigned long long pq_insert;
+  unsigned long long pq_update;
+  unsigned long long pq_remove;
+  unsigned long long pq_extract;
+  unsigned long long raise;
+  unsigned long long lower;
+  unsigned long long calc_rhs;
+  unsigned long long interpolated;
+  unsigned long long non_interpolated;
+  unsigned long long fallback;
+} estar_stats_t;
+
+
+/**
+   Source of speeds that get asked for on demand, see
+   estar_set_speed_source().  Returns the speed of cell (ix, iy), just
+   like the argument of estar_set_speed().
+*/
+typedef double (*estar_speed_fn) (void * data, size_t ix, size_t iy);
+
+
+/**
+   Speeds in a float array, row by row with stride floats from the
+   start of one row to the next.  Use estar_speed_view() with a
+   pointer to this as data to plan directly on such a cost map.
+*/
+typedef struct {
+  float const * speed;
+  size_t stride;
+} estar_speed_view_t;
+
+
 /**
    E* computes the crossing-time values (called "phi" as this is
    commonly used in the literature about Level-Set and Fast-Marching
@@ -145,16 +238,79 @@ extern "C" {
 typedef struct {
   estar_grid_t grid;
   estar_pqueue_t pq;
+  estar_focus_t focus;
+  estar_stats_t stats;
+  estar_profile_t * profile;	/* optional, see estar_set_profile() */
+  estar_recorder_t * recorder;	/* optional, see estar_record_start() */
+  float * frame;		/* last speeds, see estar_set_speed_frame() */
+  unsigned long long version;	/* bumped whenever phi or goals might change */
+  unsigned long long * stamp;	/* per chunk of cells, see ESTAR_STAMP_SHIFT */
+  estar_speed_fn speed_fn;	/* optional, see estar_set_speed_source() */
+  void * speed_data;
 } estar_t;
 
 
+/** The cells are split into chunks of 2^ESTAR_STAMP_SHIFT cells in
+    memory order (whole tiles for 16x16 tiles), and each chunk has a
+    stamp in estar_t.  Whenever the rhs or the flags of a cell change,
+    the version gets bumped and the new value stored in the stamps of
+    the chunks of the cell and of its neighbors.  Expanding a cell
+    stamps its own chunk.  The phi, rhs, flags, or gradient of a cell
+    can only have changed since version V if the stamp of its chunk is
+    above V. */
+#define ESTAR_STAMP_SHIFT 8
+
+/** Whether any cell in [x0, x1) x [y0, y1) can have changed since
+    version since, judging by the stamps (see ESTAR_STAMP_SHIFT). */
+int estar_changed_since (estar_t const * estar, size_t x0, size_t y0,
+			 size_t x1, size_t y1, unsigned long long since);
+
+
+/**
+   Bytes of memory held by an estar_t, see estar_memory_usage().  The
+   cells of the grid are split into their state (cost, values, queue
+   index, flags, and any padding needed for alignment, tiling, or huge
+   pages) and their topology (the neighbor and propagator pointers
+   that tie them together).
+*/
+typedef struct {
+  size_t grid;
+  size_t topology;
+  size_t queue;
+  size_t frame;			/* see estar_set_speed_frame() */
+  size_t stamps;		/* see ESTAR_STAMP_SHIFT */
+  size_t total;			/* all of the above plus the estar_t */
+} estar_memory_t;
+
+
 /** Initializes the given estar_t instance to represent a grid with
     the given dimensions.  In case you are reusing a previously
     initialized estar_t instance, you should first call estar_fini()
     on it. */
 void estar_init (estar_t * estar, size_t dimx, size_t dimy);
 
-/** Clears everything except speed information. You need to
+/** Same as estar_init(), but allows to tune how the grid is laid out
+    in memory, see estar_grid_conf_t.  The choice is transparent to
+    code that accesses cells through estar_grid_at() and the neighbor
+    arrays, but not to code that does pointer arithmetic on cells. */
+void estar_init_conf (estar_t * estar, size_t dimx, size_t dimy,
+		      estar_grid_conf_t const * conf);
+
+/** Switch to real-time mode: make room on the queue for at least
+    cap cells, and never grow it again.  Returns ESTAR_OK, or
+    ESTAR_ENOMEM if the memory could not be allocated (in which case
+    nothing changes).  A cap of dimx * dimy is always enough.  Note
+    that estar_reset() starts threads, and thus allocates, when the
+    grid was configured with more than one thread. */
+int estar_reserve (estar_t * estar, size_t cap);
+
+/** Clears the goals, the queue and the results of propagation: all
+    phi and rhs go back to infinity, and focus.km to zero.  Everything
+    else stays: the speeds (including the cached speeds of a speed
+    source and the frame of estar_set_speed_frame()), the region of
+    interest, the speed source itself, the query cell of
+    estar_set_focus(), the profile (whose running epoch gets dropped)
+    and the recorder (which logs the reset).  You need to
     estar_set_goal() again after calling this function. */
 void estar_reset (estar_t * estar);
 
@@ -166,40 +322,236 @@ void estar_fini (estar_t * estar);
     upper limit.  Indeed, it is a common usecase to have one E*
     instance where all the obstacle cells are goals, then E* serves as
     a distance transform (each cell will end up with a phi value equal
-    to the Euclidean distance to the closest obstacle). */
-void estar_set_goal (estar_t * estar, size_t ix, size_t iy);
+    to the Euclidean distance to the closest obstacle).  Returns
+    ESTAR_OK, or ESTAR_EFULL in real-time mode when the queue is
+    full. */
+int estar_set_goal (estar_t * estar, size_t ix, size_t iy);
 
 /** Set the wavefront propagation speed for the given cell.  A speed
     of 0 (zero) means that this cell is an obstacle, and a speed of 1
     (one) means it lies in freespace.  Nothing prevents you from
     setting speeds higher than 1 (or indeed lower than 0), but the
     algorithm is not really designed to handle this properly. So, just
-    don't do it. */
-void estar_set_speed (estar_t * estar, size_t ix, size_t iy, double speed);
+    don't do it.  Returns ESTAR_OK, or ESTAR_EFULL in real-time mode
+    when some cell could not be queued; the results will then be
+    incomplete until you estar_reset(). */
+int estar_set_speed (estar_t * estar, size_t ix, size_t iy, double speed);
+
+/** Like estar_set_speed(), but takes the cost of the cell, which is
+    the inverse of its speed and infinity for obstacles.  Costs taken
+    from the cells can be restored exactly this way, whereas turning
+    them back into speeds can be off by one ulp.  This is what
+    estar-replay uses for the costs recorded by estar_record_start(). */
+int estar_set_cost (estar_t * estar, size_t ix, size_t iy, double cost);
+
+/** Set the speeds of all cells at once, which is much faster than
+    calling estar_set_speed() for each of them, in particular for
+    cells that do not change or that the wavefront has not reached
+    yet (e.g. when loading a map before setting the goal).  The
+    speeds are given in row-major order, with stride floats from the
+    start of one row to the start of the next (at least dimx).
+    Returns ESTAR_OK, or ESTAR_EFULL as estar_set_speed(). */
+int estar_set_speed_bulk (estar_t * estar, float const * speed, size_t stride);
+
+/** Apply a complete new frame of speeds, for instance the output of
+    a costmap layer that produces the whole map in every cycle.  The
+    speeds are given in row-major order (dimx floats per row).  The
+    frame is compared against a copy of the previous one in chunks
+    with memcmp(), and only the cells that actually changed are
+    updated, so an unchanged frame costs hardly more than comparing
+    the two arrays.  The copy is allocated by the first call (and
+    initialized from the current costs), which can then fail with
+    ESTAR_ENOMEM; it is kept in sync with estar_set_speed() and
+    estar_set_speed_bulk().  Returns ESTAR_OK, or ESTAR_EFULL as
+    estar_set_speed(). */
+int estar_set_speed_frame (estar_t * estar, float const * speed);
+
+/** Take speeds from a callback instead of estar_set_speed(), and only
+    when the wavefront first reaches a cell.  The result is cached in
+    the cell, so each cell is asked for at most once until
+    estar_invalidate() says otherwise.  This way, planning on a huge
+    map that the wavefront only partly covers costs time in
+    proportion to the cells it reaches.  All cells are marked as not
+    asked for yet (ESTAR_FLAG_LAZY) or, if the wavefront already
+    reached them, asked right away, as with estar_invalidate() on the
+    whole map.  estar_reset() keeps the cached speeds.  With a NULL
+    callback, the cells that have not been asked for keep whatever
+    speed they had before.  While a source is set, do not mix it with
+    estar_set_speed() and friends, and note that the recorder does
+    not log the speeds it delivers.  Not supported by
+    estar_parallel_t.  Returns ESTAR_OK, or ESTAR_EFULL as
+    estar_set_speed(). */
+int estar_set_speed_source (estar_t * estar, estar_speed_fn speed, void * data);
+
+/** Tell the planner that the speeds of the speed source changed in
+    [x0, x1) x [y0, y1).  Cells that the wavefront has not reached yet
+    simply get asked again later; for the others, the callback is
+    called right away and the change handled like estar_set_speed().
+    The box gets clipped to the grid, so it may reach beyond it, and
+    without a speed source there is nothing to do.  Returns ESTAR_OK,
+    or ESTAR_EFULL as estar_set_speed(). */
+int estar_invalidate (estar_t * estar, size_t x0, size_t y0, size_t x1, size_t y1);
+
+/** A speed source that reads an estar_speed_view_t. */
+double estar_speed_view (void * data, size_t ix, size_t iy);
+
+/** Restrict propagation to a region of interest.  Cells where mask
+    is zero (row by row, stride bytes from one row to the next) get
+    ESTAR_FLAG_OUTSIDE: they are never expanded and keep infinite phi
+    and rhs, so the wavefront stops at the border of the region
+    instead of flooding the whole grid.  Goals are expanded anyway.
+    A NULL mask makes the whole grid the region again.  The region can
+    change at any time: cells that leave it are repaired like new
+    obstacles, and cells that join it next to the wavefront get
+    updated, so that the next estar_propagate() calls simply continue
+    from where the old border stopped them.  estar_reset() keeps the
+    region.  The recorder logs the whole mask on each call, see
+    estar_record_roi().  Returns ESTAR_OK, or ESTAR_EFULL as
+    estar_set_speed(). */
+int estar_set_roi (estar_t * estar, unsigned char const * mask, size_t stride);
+
+/** Shortcut for estar_set_roi() with the box [x0, x1) x [y0, y1). */
+int estar_set_roi_box (estar_t * estar, size_t x0, size_t y0, size_t x1, size_t y1);
 
 /** Internal function: update a single cell.  There is probably no
     good reason to have this exposed in the interface, except that it
     can help with experimentation and debugging. */
-void estar_update (estar_t * estar, estar_cell_t * cell);
+int estar_update (estar_t * estar, estar_cell_t * cell);
 
 /** Perform one wavefront propagation step.  Repeatedly call this
     function in order to run E*. It takes the topmost cell from the
     priority queue, raises or lowers its phi value depending on why it
     had ended up on the queue in the first place, and then potentially
-    schedules its neighbors for an update. */
-void estar_propagate (estar_t * estar);
+    schedules its neighbors for an update.  Returns ESTAR_OK, or
+    ESTAR_EFULL in real-time mode when some neighbor could not be
+    queued (see estar_set_speed()). */
+int estar_propagate (estar_t * estar);
+
+/** Switch to (or stay in) focused mode and make the given cell the
+    query cell.  In focused mode, the queue is ordered by the usual
+    key plus an admissible heuristic towards the query cell, so the
+    wavefront expands along a narrow ellipse instead of a disk.  The
+    query cell can be moved at any time, for instance as the robot
+    advances, without having to re-sort the queue.  Note that in
+    focused mode only the query cell (and the cells the wavefront
+    happened to pass) are guaranteed to be up to date: use
+    estar_focus_done() instead of an empty queue as stopping
+    criterion. */
+void estar_set_focus (estar_t * estar, size_t ix, size_t iy);
+
+/** Leave focused mode.  Subsequent propagation will again expand the
+    whole grid in order of increasing values.  This takes time in
+    proportion to the number of cells, because it has to find and
+    queue the cells that focused mode left within its tolerance.
+    Returns ESTAR_OK, or ESTAR_EFULL in real-time mode when the queue
+    is full. */
+int estar_clear_focus (estar_t * estar);
+
+/** In focused mode, returns non-zero when the value of the query cell
+    is final, i.e. when nothing remaining on the queue can change it
+    anymore.  Without a focus this simply tells whether the queue is
+    empty. */
+int estar_focus_done (estar_t * estar);
+
+/** Returns non-zero if the library has been built with statistics
+    counters, see estar_stats_t. */
+int estar_stats_enabled (void);
+
+/** Returns non-zero if the library has been built with the
+    ESTAR_COMPACT option, see estar_cell_t. */
+int estar_compact_enabled (void);
+
+/** Copies the current counters, e.g. at the end of a planning
+    cycle. */
+void estar_stats_snapshot (estar_t const * estar, estar_stats_t * stats);
+
+/** Sets all counters back to zero, e.g. at the start of a planning
+    cycle.  estar_init() does this too, but estar_reset() does not. */
+void estar_stats_reset (estar_t * estar);
+
+/** Start recording change epochs into the given profile, or stop
+    doing so when profile is NULL.  Each batch of estar_set_speed()
+    and estar_set_goal() calls, up to the point where propagation has
+    emptied the queue, is one epoch.  Its number of raised and
+    lowered cells, peak queue length, and wall time go into the
+    histograms of the profile, see estar_profile_t.  Note that in
+    focused mode the queue rarely runs empty, so epochs tend to span
+    several changes.  The profile is not owned by the estar_t, and an
+    epoch that is still running when estar_reset() gets called is
+    dropped. */
+void estar_set_profile (estar_t * estar, estar_profile_t * profile);
+
+/** Start logging all calls to estar_set_goal(), estar_set_speed(),
+    estar_set_cost(), estar_propagate(), estar_reset(),
+    estar_set_focus(), estar_clear_focus() and estar_set_roi() into
+    the given file, in the format described in record.h.  The log can
+    be replayed with the estar-replay tool.  Costs and the region of
+    interest set before this call are logged as well (costs exactly,
+    as with estar_set_cost()), but goals are not, so start recording
+    right after estar_init() or estar_reset().
+    Returns 0 on success, -1 if writing failed.  The recorder is not
+    owned by the estar_t and must stay valid until estar_record_stop().
+    Note that stdio may allocate its buffer on the first write. */
+int estar_record_start (estar_t * estar, estar_recorder_t * rec, FILE * fp);
+
+/** Append the current phi of all cells to the log, so that a replay
+    can check whether it arrives at the same values. */
+int estar_record_phi (estar_t * estar);
+
+/** Append the current region of interest to the log.  There is
+    rarely a reason to call this yourself: estar_set_roi() and
+    estar_set_roi_box() do it after each change of the region.
+    Returns -1 if not recording or if writing failed. */
+int estar_record_roi (estar_t * estar);
+
+/** Terminate the log and stop recording.  The file is flushed but
+    not closed.  Returns -1 if any write failed since
+    estar_record_start(). */
+int estar_record_stop (estar_t * estar);
+
+/** Fills in how much memory the given instance currently holds.  The
+    queue shrinks again after a big wave of updates has passed, unless
+    it has been frozen with estar_reserve(). */
+void estar_memory_usage (estar_t const * estar, estar_memory_t * mem);
 
 /** A debugging function to print the priority queue of cells that are
     pending updates to stdout. */
 void estar_dump_queue (estar_t * estar, char const * pfx);
 
+/** Bits in the result of estar_check() and estar_check_sampled(). */
+enum {
+  ESTAR_CHECK_CONSISTENT   = 1,	/**< consistent cell is on the queue */
+  ESTAR_CHECK_INCONSISTENT = 2,	/**< inconsistent cell is not on the queue */
+  ESTAR_CHECK_NOT_QUEUED   = 4,	/**< queued cell has pqi == 0 */
+  ESTAR_CHECK_QUEUED       = 8,	/**< pqi of a cell points to another slot */
+  ESTAR_CHECK_PQI          = 16, /**< queue slot and pqi disagree */
+  ESTAR_CHECK_HEAP         = 32, /**< heap order is violated */
+  ESTAR_CHECK_KEY          = 64, /**< queued cell has a wrong key */
+  ESTAR_CHECK_RHS          = 128 /**< rhs disagrees with the neighbors */
+};
+
 /** A debugging function which performs internal consistency checks.
-    It returns 0 when everything is honky dory, and a bitmask
-    otherwise.  It also writes human-readbable error messages to
-    stdout, so you need not neccessarily worry about the meanings in
-    the bitmask. */
+    It returns 0 when everything is honky dory, and a bitmask of
+    ESTAR_CHECK_xxx values otherwise.  It also writes human-readbable
+    error messages to stdout, each prefixed with pfx, unless pfx is
+    NULL.  The rhs of each cell is only compared against its
+    neighbors when the queue is empty and there is no focus: it may
+    lie slightly above the recomputed value (see check_cell() in
+    estar.c), but not below it, nor above the non-interpolated value
+    from the best neighbor.  This
+    takes time proportional to the number of cells plus the length of
+    the queue. */
 int estar_check (estar_t * estar, char const * pfx);
 
+/** Like estar_check(), but only looks at the top of the queue and at
+    nsamples randomly chosen cells and queue slots, so it takes
+    constant time per sample and can stay enabled in production,
+    e.g. once per planning cycle.  The state of the random number
+    generator is kept in *rng, which can be initialized to any
+    value. */
+int estar_check_sampled (estar_t * estar, size_t nsamples,
+			 unsigned long long * rng, char const * pfx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,129 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_EXPORT_H
+#define ESTAR2_EXPORT_H
+
+#include <estar2/estar.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Compact frames of phi for logging and transport. Values are stored
+   as 16-bit multiples of a resolution, so with a resolution of 0.01
+   cells they reach up to about 655 cells. Larger values saturate at
+   ESTAR_EXPORT_MAX, and infinity becomes ESTAR_EXPORT_INF. The map is
+   split into square tiles, and a frame carries either all of them (a
+   key frame) or only those whose quantized values changed since the
+   previous frame (a delta frame). A frame looks like this:
+ 
+     "ESTARPHI"  magic
+     u32         format version (ESTAR_EXPORT_VERSION)
+     u32         tile size
+     u64 u64     dimx dimy
+     f64         resolution
+     u64         sequence number, counting from zero
+     u8          'K' for a key frame, 'D' for a delta frame
+     u32         number of tiles that follow
+ 
+   followed by that many tiles, each of them a u32 tile index (row by
+   row over the tiles) and tile * tile u16 values, row by row. Cells
+   of the last row and column of tiles that lie outside of the map are
+   ESTAR_EXPORT_INF. All numbers are stored in little-endian byte
+   order. A delta frame can only be decoded after the frame with the
+   previous sequence number. */
+#define ESTAR_EXPORT_VERSION 1
+#define ESTAR_EXPORT_INF 0xffff
+#define ESTAR_EXPORT_MAX 0xfffe
+
+
+typedef struct {
+  size_t dimx, dimy, tile, tdimx, tdimy;
+  double resolution;
+  uint16_t * prev;		/* values of the last frame, tile by tile */
+  uint16_t * value;		/* one tile, scratch for estar_export_frame() */
+  unsigned char * buf;		/* the last frame */
+  size_t len, cap;
+  uint64_t seq;			/* of the next frame */
+  unsigned long long since;	/* estar_t::version at the last frame */
+} estar_export_t;
+
+
+typedef struct {
+  size_t dimx, dimy, tile, tdimx, tdimy;
+  double resolution;
+  uint16_t * value;		/* tile by tile, like estar_export_t::prev */
+  uint64_t seq;			/* of the last frame */
+  int valid;			/* a key frame has been decoded */
+} estar_import_t;
+
+
+/* The tile size is the number of cells per side, e.g. 16. It has to
+   lie within 1 to 0xffff, the range that estar_import_frame() accepts,
+   or the program exits with an error. */
+void estar_export_init (estar_export_t * exp, size_t dimx, size_t dimy,
+			size_t tile, double resolution);
+void estar_export_fini (estar_export_t * exp);
+
+/* Encodes the phi of the planner, which must have the dimensions
+   given to estar_export_init(), into exp->buf, and returns its length
+   in bytes. The first frame is always a key frame, later ones only if
+   key is non-zero. Tiles whose cells have not changed since the last
+   frame, judging by the stamps of the planner (see ESTAR_STAMP_SHIFT),
+   are skipped without looking at them. That makes a delta frame after
+   a small repair cheap enough to produce after every propagation
+   batch. */
+size_t estar_export_frame (estar_export_t * exp, estar_t const * estar, int key);
+
+void estar_import_init (estar_import_t * imp);
+void estar_import_fini (estar_import_t * imp);
+
+/* Decodes a frame. Returns 0, or -1 if the frame is malformed or is a
+   delta frame that does not follow the last decoded frame, in which
+   case the values are left alone and only a key frame can be decoded
+   next. */
+int estar_import_frame (estar_import_t * imp, void const * frame, size_t len);
+
+/* Phi of a cell in the last decoded frame: to within half the
+   resolution, infinity, or ESTAR_EXPORT_MAX times the resolution if it
+   was larger than that. */
+double estar_import_phi (estar_import_t const * imp, size_t ix, size_t iy);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -40,16 +40,103 @@ extern "C" {
 #endif
 
 
+/* Upper limit on estar_grid_conf_t::nthreads, larger values get
+   clamped to it. */
+#define ESTAR_GRID_MAXTHREADS 64
+
+
+/* Kinds of memory pages for the cells, see estar_grid_conf_t. */
+enum {
+  ESTAR_PAGES_DEFAULT,		/* whatever malloc() hands out */
+  ESTAR_PAGES_THP,		/* ask for transparent huge pages */
+  ESTAR_PAGES_HUGETLB		/* reserved huge pages, else like THP */
+};
+
+
+/* Optional settings for estar_grid_init_conf(). Use
+   estar_grid_conf_default() to initialize them, so that code keeps
+   working when settings get added. */
+typedef struct {
+  /* Edge length of the square tiles that the cells are stored in, in
+     cells. Must be a power of two. Tiles are stored in row-major
+     order, and so are the cells within each tile. A value of one
+     gives the classic row-major layout of the whole grid. With larger
+     tiles, the north and south neighbors of most cells lie within the
+     same few cache lines and pages as the cell itself. */
+  size_t tile;
+  /* Number of threads used to initialize and reset the cells. Each
+     thread handles a contiguous range of rows of tiles, always the
+     same one, and is pinned to a CPU, picked evenly from the allowed
+     ones. On NUMA machines, this means the pages of each range get
+     placed (by first touch) on the node that later resets them, and
+     that the ranges are spread over all nodes as long as CPUs are
+     numbered node by node; the actual topology is not consulted. The
+     threads get started anew for each call, which costs some tens of
+     microseconds, so this only pays off for large grids. At most
+     ESTAR_GRID_MAXTHREADS, and at most one per row of tiles. */
+  size_t nthreads;
+  /* One of the ESTAR_PAGES_xxx values. Huge pages cut down on TLB
+     misses on large grids. If the requested kind is not available,
+     the next best one is used instead. */
+  int pages;
+} estar_grid_conf_t;
+
+
 typedef struct {
   estar_cell_t * cell;
   size_t dimx, dimy;
+  size_t tshift;		/* log2 of the tile edge length */
+  size_t tdimx, tdimy;		/* number of tiles along x and y */
+  size_t ncells;		/* allocated cells, including tile padding */
+  size_t nthreads;		/* for estar_grid_parallel() */
+  size_t mapsize;		/* zero unless the cells were mmap()ed */
 } estar_grid_t;
 
 
+/* Callback for estar_grid_parallel(), which gets called on
+   consecutive ranges of cells [begin, end) in memory order. */
+typedef void (*estar_grid_fn_t) (estar_grid_t * grid,
+				 estar_cell_t * begin, estar_cell_t * end,
+				 void * data);
+
+
+void estar_grid_conf_default (estar_grid_conf_t * conf);
+
 void estar_grid_init (estar_grid_t * grid, size_t dimx, size_t dimy);
+void estar_grid_init_conf (estar_grid_t * grid, size_t dimx, size_t dimy,
+			   estar_grid_conf_t const * conf);
 void estar_grid_fini (estar_grid_t * grid);
 
-#define estar_grid_at(grid,ix,iy) (&(grid)->cell[(ix)+(iy)*(grid)->dimx])
+/* Apply fn to all allocated cells (including tile padding), split
+   over grid->nthreads threads in the same way every time. Returns
+   when all of them are done. */
+void estar_grid_parallel (estar_grid_t * grid, estar_grid_fn_t fn, void * data);
+
+
+static inline size_t estar_grid_index (estar_grid_t const * grid,
+				       size_t ix, size_t iy)
+{
+  size_t const ts = grid->tshift;
+  size_t const tm = ((size_t) 1 << ts) - 1;
+  return (((iy >> ts) * grid->tdimx + (ix >> ts)) << (2 * ts))
+    | ((iy & tm) << ts) | (ix & tm);
+}
+
+
+static inline void estar_grid_coords (estar_grid_t const * grid,
+				      estar_cell_t const * cell,
+				      size_t * ix, size_t * iy)
+{
+  size_t const ts = grid->tshift;
+  size_t const tm = ((size_t) 1 << ts) - 1;
+  size_t const idx = cell - grid->cell;
+  size_t const tile = idx >> (2 * ts);
+  *ix = ((tile % grid->tdimx) << ts) | (idx & tm);
+  *iy = ((tile / grid->tdimx) << ts) | ((idx >> ts) & tm);
+}
+
+
+#define estar_grid_at(grid,ix,iy) (&(grid)->cell[estar_grid_index((grid),(ix),(iy))])
 
 
 #ifdef __cplusplus
@@ -0,0 +1,137 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_PARALLEL_H
+#define ESTAR2_PARALLEL_H
+
+#include <estar2/estar.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* One rectangular part of the grid, planned by its own estar_t. Its
+   grid holds the cells the subdomain owns plus a border of ghost
+   cells (flagged ESTAR_FLAG_GHOST) on each side that touches another
+   subdomain. Ghost cells never compute their own rhs: it gets copied
+   from the phi of the cell they stand for, and from there on they
+   propagate into the subdomain like any other cell. */
+typedef struct {
+  estar_t estar;
+  size_t x0, y0;		/* global coordinates of local cell (0, 0) */
+  size_t ox0, oy0, ox1, oy1;	/* owned cells, global [ox0, ox1) x [oy0, oy1) */
+  estar_cell_t ** ghost;	/* pairs of ghost cell and the cell it mirrors */
+  size_t nghosts;
+  double topkey;		/* published between rounds */
+  size_t npops;			/* of the last estar_parallel_propagate() */
+  size_t nidle;			/* rounds of it without any expansion */
+} estar_sub_t;
+
+
+/* Domain decomposition: the grid is split into nx by ny subdomains,
+   and estar_parallel_propagate() runs one thread per subdomain: the
+   calling one, plus workers that estar_parallel_init() starts and
+   that wait for the next propagation in between (so the struct must
+   not be moved or copied). The threads proceed in rounds. In each of them, every subdomain expands
+   the cells on its queue whose key is at most window (times the
+   smallest cost) above the lowest key of all queues, then all of them
+   copy the phi of the cells along their borders into the ghost cells
+   of their neighbors. Once all queues are empty, the field is
+   consistent across the borders, and ghost cells take part in the
+   same update equations as the cells they stand for.
+   
+   The window keeps subdomains from running ahead of waves that have
+   not reached them yet. Besides causing work that gets undone later,
+   running ahead changes the order of expansion, and E* does not
+   interpolate from neighbors that lie above the wavefront at the time
+   (see calc_rhs()), so a cell can end up slightly above its
+   sequential value. Below 1/sqrt(2), the least that phi can grow from
+   one cell to the next, a subdomain does not get to expand a cell
+   before those in other subdomains that its value could depend on,
+   and the field comes out the same as that of the sequential planner
+   (test-parallel checks this on random maps and repairs). The default
+   of 0.5 means one round per half a cell of wavefront progress.
+   
+   In each round, only the subdomains that the band of keys within the
+   window crosses have anything to expand, and the others wait at the
+   barrier. So the speedup is bounded by how many subdomains the
+   wavefront crosses at once, rather than by the number of threads: a
+   wave that starts at a single goal crosses few of them until it has
+   grown to about the size of a subdomain. The nidle counters of the
+   subdomains show how much time that costs.
+   
+   Focused propagation (estar_set_focus()) is not supported. */
+typedef struct {
+  size_t dimx, dimy;
+  size_t nx, ny;
+  size_t * xsplit, * ysplit;	/* nx + 1 and ny + 1 subdomain boundaries */
+  estar_sub_t * sub;		/* nx * ny of them, row by row */
+  double window;		/* in cells, see above */
+  size_t nrounds;		/* of the last estar_parallel_propagate(), 0 for one subdomain */
+  
+  /* shared with the workers */
+  struct estar_worker_s * worker; /* one per subdomain, the first one runs in the caller */
+  pthread_barrier_t barrier;
+  double scale;			/* smallest cost, for the running propagation */
+  int quit;
+} estar_parallel_t;
+
+
+/* Splits the grid into nthreads subdomains, arranged as close to
+   square as the factors of nthreads allow, and initializes a planner
+   for each of them with the given grid configuration (the number of
+   threads in there is ignored). Also starts the nthreads - 1 worker
+   threads, which estar_parallel_fini() stops again. */
+void estar_parallel_init (estar_parallel_t * par, size_t dimx, size_t dimy,
+			  size_t nthreads, estar_grid_conf_t const * conf);
+void estar_parallel_fini (estar_parallel_t * par);
+
+/* Counterparts of estar_set_goal() and estar_set_speed(). */
+int estar_parallel_set_goal (estar_parallel_t * par, size_t ix, size_t iy);
+int estar_parallel_set_speed (estar_parallel_t * par, size_t ix, size_t iy, double speed);
+
+/* Propagates until all queues are empty, and returns the number of
+   cells expanded in total. */
+size_t estar_parallel_propagate (estar_parallel_t * par);
+
+/* The cell at global coordinates (ix, iy), in the subdomain that owns
+   it. */
+estar_cell_t * estar_parallel_cell (estar_parallel_t const * par, size_t ix, size_t iy);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
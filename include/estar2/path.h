@@ -0,0 +1,110 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_PATH_H
+#define ESTAR2_PATH_H
+
+#include <estar2/estar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Outcomes of estar_trace_path() and estar_path_update(). */
+enum {
+  ESTAR_PATH_GOAL,		/* the last point lies in a goal cell */
+  ESTAR_PATH_FULL,		/* ran out of room for points */
+  ESTAR_PATH_STUCK		/* no way down from the last point */
+};
+
+
+/* Follow the gradient from (x, y) until reaching a goal cell, just
+   like gestar2 does, but in a single step per cell. Within each cell,
+   the gradient according to estar_cell_calc_gradient() is constant,
+   so the path can go straight to the point where it leaves the cell
+   (the cell being the one whose center is nearest). Where the
+   gradients of two neighboring cells point at each other, the path
+   slides along their common boundary instead of zig-zagging across
+   it. Where none of this leads to a cell with a lower rhs, as can
+   happen in narrow passages, the path goes to the center of the
+   neighbor with the lowest rhs instead, so it always ends up at a
+   goal if the start has a finite rhs. Writes at most maxpoints points
+   as interleaved coordinates to xy, starting with (x, y) itself and
+   followed by about one point per cell, and stores their number in
+   npoints. Returns one of the ESTAR_PATH_xxx values. */
+int estar_trace_path (estar_grid_t const * grid, double x, double y,
+		      double * xy, size_t maxpoints, size_t * npoints);
+
+
+/* Number of values that the step from a point on a path depends on,
+   see estar_path_t. */
+#define ESTAR_PATH_NDEPS 11
+
+
+/* A path that gets traced anew only where needed. Besides the points,
+   it keeps what the step from each of them depends on: the rhs of the
+   cell the point lies in, of the cell the step leads into, of the cell
+   beside it (for sliding) and of the neighbors of the first one, and
+   the gradients of the first two. All of these cells lie among the
+   first one and its neighbors. Plus the estar_t version at which all
+   of this was valid, to compare the stamps against. */
+typedef struct {
+  double * xy;
+  double * deps;		/* ESTAR_PATH_NDEPS per point */
+  size_t npoints, maxpoints;
+  int status;			/* an ESTAR_PATH_xxx value */
+  unsigned long long version;
+  size_t nsteps;		/* steps evaluated by the last update */
+} estar_path_t;
+
+
+void estar_path_init (estar_path_t * path, size_t maxpoints);
+void estar_path_fini (estar_path_t * path);
+
+/* Bring the path from (x, y) up to date with the current values of
+   the estar_t, and return its status. If the start changed, the whole
+   path is traced again. Otherwise, points whose cell and neighbors
+   have not changed according to estar_changed_since() are skipped
+   without a look at their step. The step from the others is evaluated
+   again, and the path is traced again from the first one that depends
+   on a different rhs or gradient now, which gives the same result as
+   a fresh estar_trace_path(). So an update costs time in proportion
+   to the points near a change, plus the stamps it checks. */
+int estar_path_update (estar_path_t * path, estar_t const * estar, double x, double y);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
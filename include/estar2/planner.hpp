@@ -0,0 +1,726 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_PLANNER_HPP
+#define ESTAR2_PLANNER_HPP
+
+/* Header-only C++17 version of the planner in src/estar.c, for code
+   that wants the hot loop inlined instead of calling into the shared
+   library for every expansion. The scalar type, the queue and the
+   grid layout are template parameters. Instead of neighbor pointers,
+   each cell has a bitmask of the neighbors it has, and the layout
+   computes where they are. Otherwise it follows estar.c step by step:
+   with double, BinaryHeap and either layout, the phi fields are
+   identical to those of estar_t (bench-planner checks this). With
+   float, they are identical to those of a library built with
+   ESTAR_COMPACT. Focused propagation, the real-time mode, statistics
+   and the recorder are left out.
+
+   With the Fixed layout, the dimensions are compile-time constants
+   and the cells and the queue are plain arrays inside the planner, so
+   it does not allocate and can live on the stack or in an arena. That
+   is meant for many small problems, e.g. local windows around a
+   robot. */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace estar {
+  
+  
+  // same values as in cell.h
+  enum {
+    FLAG_GOAL     = 1,
+    FLAG_OBSTACLE = 2
+  };
+  
+  // bits of Cell::nbors, and the order in which neighbors get visited
+  enum {
+    WEST  = 1,
+    EAST  = 2,
+    SOUTH = 4,
+    NORTH = 8
+  };
+  
+  
+  template <typename Scalar>
+  struct Cell {
+    Scalar cost;		// 1/speed
+    Scalar phi;
+    Scalar rhs;
+    Scalar key;			// managed by the queue
+    std::uint32_t pqi;		// managed by the queue; 0 means "not on queue"
+    std::uint8_t flags;
+    std::uint8_t nbors;		// which of WEST, EAST, SOUTH, NORTH exist
+  };
+  
+  
+  /* The subset of std::vector used for the cells and the queue, in an
+     array of fixed capacity. */
+  template <typename T, std::size_t Capacity>
+  class FixedVector {
+  public:
+    FixedVector () : size_ (0) {}
+    FixedVector (std::size_t size, T const & value) : size_ (size)
+    {
+      for (std::size_t ii = 0; ii < size; ++ii) {
+	data_[ii] = value;
+      }
+    }
+    
+    std::size_t size () const { return size_; }
+    void resize (std::size_t size) { size_ = size; }
+    void push_back (T const & value) { data_[size_++] = value; }
+    void pop_back () { --size_; }
+    T & back () { return data_[size_ - 1]; }
+    T & operator[] (std::size_t ii) { return data_[ii]; }
+    T const & operator[] (std::size_t ii) const { return data_[ii]; }
+    T * data () { return data_; }
+    T * begin () { return data_; }
+    T * end () { return data_ + size_; }
+    
+  private:
+    T data_[Capacity];
+    std::size_t size_;
+  };
+  
+  /* A std::vector when the capacity is only known at runtime (zero),
+     a FixedVector otherwise. */
+  template <typename T, std::size_t Capacity>
+  using Storage = typename std::conditional<0 == Capacity,
+					    std::vector<T>,
+					    FixedVector<T, Capacity> >::type;
+  
+  
+  /* Layouts tell the planner how many cells there are, and where the
+     neighbors of a cell are. Their capacity is the number of cells if
+     that is a compile-time constant, and zero otherwise. */
+  
+  /* Cells stored row by row, as with estar_grid_conf_t::tile == 1. */
+  class RowMajor {
+  public:
+    static constexpr std::size_t capacity = 0;
+    
+    void init (std::size_t dimx, std::size_t dimy)
+    {
+      dimx_ = dimx;
+      dimy_ = dimy;
+    }
+    
+    std::size_t size () const { return dimx_ * dimy_; }
+    
+    std::size_t index (std::size_t ix, std::size_t iy) const { return iy * dimx_ + ix; }
+    
+    std::size_t west (std::size_t ii) const { return ii - 1; }
+    std::size_t east (std::size_t ii) const { return ii + 1; }
+    std::size_t south (std::size_t ii) const { return ii - dimx_; }
+    std::size_t north (std::size_t ii) const { return ii + dimx_; }
+    
+  private:
+    std::size_t dimx_, dimy_;
+  };
+  
+  
+  /* Square tiles of 2^Shift cells on a side, laid out like the tiled
+     estar_grid_t. The last row and column of tiles are padded with
+     obstacle cells. */
+  template <unsigned Shift>
+  class Tiled {
+  public:
+    static constexpr std::size_t edge = std::size_t (1) << Shift;
+    static constexpr std::size_t mask = edge - 1;
+    static constexpr std::size_t area = edge * edge;
+    static constexpr std::size_t capacity = 0;
+    
+    void init (std::size_t dimx, std::size_t dimy)
+    {
+      tdimx_ = (dimx + mask) >> Shift;
+      tdimy_ = (dimy + mask) >> Shift;
+    }
+    
+    std::size_t size () const { return tdimx_ * tdimy_ * area; }
+    
+    std::size_t index (std::size_t ix, std::size_t iy) const
+    {
+      return (((iy >> Shift) * tdimx_ + (ix >> Shift)) << (2 * Shift))
+	| ((iy & mask) << Shift) | (ix & mask);
+    }
+    
+    std::size_t west (std::size_t ii) const
+    {
+      return 0 != (ii & mask) ? ii - 1 : ii - area + mask;
+    }
+    
+    std::size_t east (std::size_t ii) const
+    {
+      return mask != (ii & mask) ? ii + 1 : ii + area - mask;
+    }
+    
+    std::size_t south (std::size_t ii) const
+    {
+      return 0 != (ii & (mask << Shift)) ? ii - edge : ii - tdimx_ * area + (mask << Shift);
+    }
+    
+    std::size_t north (std::size_t ii) const
+    {
+      return (mask << Shift) != (ii & (mask << Shift))
+	? ii + edge : ii + tdimx_ * area - (mask << Shift);
+    }
+    
+  private:
+    std::size_t tdimx_, tdimy_;
+  };
+  
+  
+  /* Row by row like RowMajor, but with the dimensions fixed at compile
+     time, so that the neighbor offsets are constants. */
+  template <std::size_t DimX, std::size_t DimY>
+  class Fixed {
+  public:
+    static constexpr std::size_t dimx = DimX;
+    static constexpr std::size_t dimy = DimY;
+    static constexpr std::size_t capacity = DimX * DimY;
+    
+    void init (std::size_t width, std::size_t height)
+    {
+      if (DimX != width || DimY != height) {
+	throw std::invalid_argument ("estar::Fixed: dimensions do not match");
+      }
+    }
+    
+    static constexpr std::size_t size () { return capacity; }
+    
+    static constexpr std::size_t index (std::size_t ix, std::size_t iy) { return iy * DimX + ix; }
+    
+    static constexpr std::size_t west (std::size_t ii) { return ii - 1; }
+    static constexpr std::size_t east (std::size_t ii) { return ii + 1; }
+    static constexpr std::size_t south (std::size_t ii) { return ii - DimX; }
+    static constexpr std::size_t north (std::size_t ii) { return ii + DimX; }
+  };
+  
+  
+  /* Queues get the node type and the capacity of the layout. */
+  
+  /* The binary heap of src/heap.h, operation for operation, so that
+     cells with equal keys come out in the same order. Index zero is
+     unused. */
+  template <typename Node, std::size_t Capacity = 0>
+  class BinaryHeap {
+  public:
+    BinaryHeap () : heap_ (1, nullptr) {}
+    
+    std::size_t size () const { return heap_.size () - 1; }
+    
+    double top_key () const
+    {
+      return heap_.size () > 1 ? heap_[1]->key : std::numeric_limits<double>::infinity ();
+    }
+    
+    void clear () { heap_.resize (1); }
+    
+    void insert_or_update (Node * node)
+    {
+      if (0 != node->pqi) {
+	bubble_up (node->pqi);
+	bubble_down (node->pqi);
+	return;
+      }
+      heap_.push_back (node);
+      node->pqi = heap_.size () - 1;
+      bubble_up (node->pqi);
+    }
+    
+    void remove (Node * node)
+    {
+      std::size_t const index = node->pqi;
+      if (index != size ()) {
+	heap_[index] = heap_.back ();
+	heap_[index]->pqi = index;
+	heap_.pop_back ();
+	bubble_up (index);
+	bubble_down (index);
+      }
+      else {
+	heap_.pop_back ();
+      }
+      node->pqi = 0;
+    }
+    
+    Node * extract ()
+    {
+      Node * const node = heap_[1];
+      node->pqi = 0;
+      if (size () > 1) {
+	heap_[1] = heap_.back ();
+	heap_[1]->pqi = 1;
+	heap_.pop_back ();
+	bubble_down (1);
+      }
+      else {
+	heap_.pop_back ();
+      }
+      return node;
+    }
+    
+  private:
+    void swap (std::size_t aa, std::size_t bb)
+    {
+      Node * const tmp = heap_[aa];
+      heap_[aa] = heap_[bb];
+      heap_[bb] = tmp;
+      heap_[aa]->pqi = aa;
+      heap_[bb]->pqi = bb;
+    }
+    
+    void bubble_up (std::size_t index)
+    {
+      std::size_t parent = index / 2;
+      while (parent > 0 && heap_[index]->key < heap_[parent]->key) {
+	swap (index, parent);
+	index = parent;
+	parent = index / 2;
+      }
+    }
+    
+    void bubble_down (std::size_t index)
+    {
+      std::size_t const len = size ();
+      std::size_t child, target;
+      target = index;
+      for (;;) {
+	child = 2 * index;
+	if (child <= len && heap_[child]->key < heap_[target]->key) {
+	  target = child;
+	}
+	++child;
+	if (child <= len && heap_[child]->key < heap_[target]->key) {
+	  target = child;
+	}
+	if (index == target) {
+	  break;
+	}
+	swap (target, index);
+	index = target;
+      }
+    }
+    
+    Storage<Node *, 0 == Capacity ? 0 : Capacity + 1> heap_;
+  };
+  
+  
+  /* A heap with four children per node, which is half as deep and
+     keeps siblings on one cache line. Cells with equal keys can come
+     out in a different order than with BinaryHeap, which can make
+     phi differ in the last bits. */
+  template <typename Node, std::size_t Capacity = 0>
+  class QuaternaryHeap {
+  public:
+    QuaternaryHeap () : heap_ (1, nullptr) {}
+    
+    std::size_t size () const { return heap_.size () - 1; }
+    
+    double top_key () const
+    {
+      return heap_.size () > 1 ? heap_[1]->key : std::numeric_limits<double>::infinity ();
+    }
+    
+    void clear () { heap_.resize (1); }
+    
+    void insert_or_update (Node * node)
+    {
+      if (0 != node->pqi) {
+	sift_down (sift_up (node->pqi));
+	return;
+      }
+      heap_.push_back (node);
+      node->pqi = heap_.size () - 1;
+      sift_up (node->pqi);
+    }
+    
+    void remove (Node * node)
+    {
+      std::size_t const index = node->pqi;
+      Node * const last = heap_.back ();
+      heap_.pop_back ();
+      node->pqi = 0;
+      if (last != node) {
+	heap_[index] = last;
+	last->pqi = index;
+	sift_down (sift_up (index));
+      }
+    }
+    
+    Node * extract ()
+    {
+      Node * const node = heap_[1];
+      remove (node);
+      return node;
+    }
+    
+  private:
+    // children of index ii are 4 * ii - 2 to 4 * ii + 1
+    std::size_t sift_up (std::size_t index)
+    {
+      Node * const node = heap_[index];
+      std::size_t parent;
+      while (index > 1) {
+	parent = (index + 2) / 4;
+	if ( ! (node->key < heap_[parent]->key)) {
+	  break;
+	}
+	heap_[index] = heap_[parent];
+	heap_[index]->pqi = index;
+	index = parent;
+      }
+      heap_[index] = node;
+      node->pqi = index;
+      return index;
+    }
+    
+    void sift_down (std::size_t index)
+    {
+      std::size_t const len = size ();
+      Node * const node = heap_[index];
+      std::size_t child, best, last;
+      for (;;) {
+	child = 4 * index - 2;
+	if (child > len) {
+	  break;
+	}
+	last = child + 3 < len ? child + 3 : len;
+	best = child;
+	for (++child; child <= last; ++child) {
+	  if (heap_[child]->key < heap_[best]->key) {
+	    best = child;
+	  }
+	}
+	if ( ! (heap_[best]->key < node->key)) {
+	  break;
+	}
+	heap_[index] = heap_[best];
+	heap_[index]->pqi = index;
+	index = best;
+      }
+      heap_[index] = node;
+      node->pqi = index;
+    }
+    
+    Storage<Node *, 0 == Capacity ? 0 : Capacity + 1> heap_;
+  };
+  
+  
+  template <typename Scalar,
+	    template <typename, std::size_t> class QueuePolicy = BinaryHeap,
+	    typename LayoutPolicy = RowMajor>
+  class Planner {
+  public:
+    typedef Cell<Scalar> cell_type;
+    
+    /* All cells start out with a speed of one, like estar_init(). */
+    Planner (std::size_t dimx, std::size_t dimy)
+      : dimx_ (dimx), dimy_ (dimy)
+    {
+      layout_.init (dimx, dimy);
+      cell_.resize (layout_.size ());
+      for (cell_type & cell : cell_) {
+	cell.cost = infinity ();
+	cell.flags = FLAG_OBSTACLE;	// padding, if any
+	cell.nbors = 0;
+      }
+      for (std::size_t iy = 0; iy < dimy; ++iy) {
+	for (std::size_t ix = 0; ix < dimx; ++ix) {
+	  cell_type & cell = cell_[layout_.index (ix, iy)];
+	  cell.cost = 1;
+	  cell.flags = 0;
+	  cell.nbors = (ix > 0 ? WEST : 0) | (ix < dimx - 1 ? EAST : 0)
+	    | (iy > 0 ? SOUTH : 0) | (iy < dimy - 1 ? NORTH : 0);
+	}
+      }
+      reset ();
+    }
+    
+    /* Only for the Fixed layout. */
+    Planner () : Planner (LayoutPolicy::dimx, LayoutPolicy::dimy) {}
+    
+    // the queue points into the cells
+    Planner (Planner const &) = delete;
+    Planner & operator= (Planner const &) = delete;
+    
+    std::size_t dimx () const { return dimx_; }
+    std::size_t dimy () const { return dimy_; }
+    std::size_t queue_length () const { return queue_.size (); }
+    
+    cell_type const & at (std::size_t ix, std::size_t iy) const
+    {
+      return cell_[layout_.index (ix, iy)];
+    }
+    
+    /* Like estar_reset(): forget goals and propagation results. */
+    void reset ()
+    {
+      for (cell_type & cell : cell_) {
+	cell.phi = infinity ();
+	cell.rhs = infinity ();
+	cell.key = infinity ();
+	cell.pqi = 0;
+	cell.flags &= ~FLAG_GOAL;
+      }
+      queue_.clear ();
+    }
+    
+    void set_goal (std::size_t ix, std::size_t iy)
+    {
+      cell_type & goal = cell_[layout_.index (ix, iy)];
+      goal.rhs = 0;
+      goal.flags |= FLAG_GOAL;
+      goal.flags &= ~FLAG_OBSTACLE;
+      enqueue (goal);
+    }
+    
+    void set_speed (std::size_t ix, std::size_t iy, double speed)
+    {
+      std::size_t const ii = layout_.index (ix, iy);
+      cell_type & cell = cell_[ii];
+      double const cost = speed <= 0.0 ? infinity () : 1.0 / speed;
+      if (cost == cell.cost) {
+	return;
+      }
+      bool const need_update = ! untouched (ii);
+      cell.cost = cost;
+      if (std::isinf (cost)) {
+	cell.phi = infinity ();
+	cell.rhs = infinity ();
+	cell.flags |= FLAG_OBSTACLE;
+      }
+      else {
+	cell.flags &= ~FLAG_OBSTACLE;
+      }
+      if (need_update) {
+	update (ii);
+	update_nbors (ii);
+      }
+    }
+    
+    /* Expand the cell at the top of the queue, if any. */
+    void propagate ()
+    {
+      if (0 == queue_.size ()) {
+	return;
+      }
+      cell_type & cell = *queue_.extract ();
+      std::size_t const ii = &cell - cell_.data ();
+      if (cell.phi > cell.rhs) {
+	cell.phi = cell.rhs;
+	update_nbors (ii);
+      }
+      else {
+	cell.phi = infinity ();
+	update_nbors (ii);
+	update (ii);
+      }
+    }
+    
+    /* Propagate until the queue is empty, and return the number of
+       expansions. */
+    std::size_t flush ()
+    {
+      std::size_t npops;
+      for (npops = 0; 0 != queue_.size (); ++npops) {
+	propagate ();
+      }
+      return npops;
+    }
+    
+  private:
+    static constexpr Scalar infinity () { return std::numeric_limits<Scalar>::infinity (); }
+    
+    static double interpolate (double cost, double primary, double secondary)
+    {
+      if (cost <= secondary - primary) {
+	return primary + cost;
+      }
+      double const tmp = primary + secondary;
+      return (tmp + std::sqrt (std::pow (tmp, 2.0)
+			       - 2.0 * (std::pow (primary, 2.0)
+					+ std::pow (secondary, 2.0)
+					- std::pow (cost, 2.0)))) / 2.0;
+    }
+    
+    static bool usable (cell_type const & cell, double phimax)
+    {
+      return ! (cell.flags & FLAG_OBSTACLE) && 0 == cell.pqi
+	&& ! (cell.phi > phimax) && ! std::isinf (cell.phi);
+    }
+    
+    void calc_pair (cell_type & cell, std::size_t aa, std::size_t bb, double phimax)
+    {
+      cell_type const * primary = &cell_[aa];
+      cell_type const * secondary = &cell_[bb];
+      double rr;
+      if ( ! (primary->rhs <= secondary->rhs)) {
+	primary = &cell_[bb];
+	secondary = &cell_[aa];
+      }
+      if ( ! usable (*primary, phimax)) {
+	return;
+      }
+      if ( ! usable (*secondary, phimax)) {
+	rr = primary->rhs + cell.cost;
+      }
+      else {
+	rr = interpolate (cell.cost, primary->phi, secondary->phi);
+      }
+      if (rr < cell.rhs) {
+	cell.rhs = rr;
+      }
+    }
+    
+    void calc_rhs (std::size_t ii, double phimax)
+    {
+      cell_type & cell = cell_[ii];
+      unsigned const nb = cell.nbors;
+      cell.rhs = infinity ();
+      
+      // same pairs in the same order as the prop array of estar_cell_t
+      if (nb & WEST) {
+	if (nb & SOUTH) {
+	  calc_pair (cell, layout_.west (ii), layout_.south (ii), phimax);
+	}
+	if (nb & NORTH) {
+	  calc_pair (cell, layout_.west (ii), layout_.north (ii), phimax);
+	}
+      }
+      if (nb & EAST) {
+	if (nb & SOUTH) {
+	  calc_pair (cell, layout_.east (ii), layout_.south (ii), phimax);
+	}
+	if (nb & NORTH) {
+	  calc_pair (cell, layout_.east (ii), layout_.north (ii), phimax);
+	}
+      }
+      
+      if (std::isinf (cell.rhs)) {
+	double rr = infinity ();
+	if ((nb & WEST) && cell_[layout_.west (ii)].phi < rr) {
+	  rr = cell_[layout_.west (ii)].phi;
+	}
+	if ((nb & EAST) && cell_[layout_.east (ii)].phi < rr) {
+	  rr = cell_[layout_.east (ii)].phi;
+	}
+	if ((nb & SOUTH) && cell_[layout_.south (ii)].phi < rr) {
+	  rr = cell_[layout_.south (ii)].phi;
+	}
+	if ((nb & NORTH) && cell_[layout_.north (ii)].phi < rr) {
+	  rr = cell_[layout_.north (ii)].phi;
+	}
+	cell.rhs = rr;
+	cell.rhs += cell.cost;
+      }
+    }
+    
+    void enqueue (cell_type & cell)
+    {
+      cell.key = cell.rhs < cell.phi ? cell.rhs : cell.phi;
+      queue_.insert_or_update (&cell);
+    }
+    
+    void dequeue (cell_type & cell)
+    {
+      if (0 != cell.pqi) {
+	queue_.remove (&cell);
+      }
+    }
+    
+    void update (std::size_t ii)
+    {
+      cell_type & cell = cell_[ii];
+      if (cell.flags & FLAG_OBSTACLE) {
+	dequeue (cell);
+	return;
+      }
+      if ( ! (cell.flags & FLAG_GOAL)) {
+	calc_rhs (ii, queue_.top_key ());
+      }
+      if (cell.phi != cell.rhs) {
+	enqueue (cell);
+      }
+      else {
+	dequeue (cell);
+      }
+    }
+    
+    void update_nbors (std::size_t ii)
+    {
+      unsigned const nb = cell_[ii].nbors;
+      if (nb & WEST) {
+	update (layout_.west (ii));
+      }
+      if (nb & EAST) {
+	update (layout_.east (ii));
+      }
+      if (nb & SOUTH) {
+	update (layout_.south (ii));
+      }
+      if (nb & NORTH) {
+	update (layout_.north (ii));
+      }
+    }
+    
+    bool untouched (std::size_t ii) const
+    {
+      cell_type const & cell = cell_[ii];
+      unsigned const nb = cell.nbors;
+      if (0 != cell.pqi || ! std::isinf (cell.phi) || ! std::isinf (cell.rhs)
+	  || (cell.flags & FLAG_GOAL)) {
+	return false;
+      }
+      return ! ((nb & WEST) && ! std::isinf (cell_[layout_.west (ii)].phi))
+	&& ! ((nb & EAST) && ! std::isinf (cell_[layout_.east (ii)].phi))
+	&& ! ((nb & SOUTH) && ! std::isinf (cell_[layout_.south (ii)].phi))
+	&& ! ((nb & NORTH) && ! std::isinf (cell_[layout_.north (ii)].phi));
+    }
+    
+    std::size_t dimx_, dimy_;
+    LayoutPolicy layout_;
+    Storage<cell_type, LayoutPolicy::capacity> cell_;
+    QueuePolicy<cell_type, LayoutPolicy::capacity> queue_;
+  };
+  
+}
+
+#endif
@@ -0,0 +1,167 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_POOL_H
+#define ESTAR2_POOL_H
+
+#include <estar2/estar.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Number of latency samples kept by estar_pool_t. */
+#define ESTAR_POOL_NLATENCY 4096
+
+
+/* A planner that has been handed out by the pool at least once. Kept
+   on a free list between jobs. */
+typedef struct estar_pool_instance_s {
+  estar_t estar;
+  struct estar_pool_instance_s * next;
+} estar_pool_instance_t;
+
+
+/* One planning request. The caller fills in the first block, and the
+   job must stay valid until its done callback has run. The setup
+   callback gets a planner of the requested size, which estar_reset()
+   has cleared of goals and propagation results, and which has no
+   focus, region of interest, speed source, profile or recorder. It
+   still has the speeds of the job that used it last, though, so setup
+   has to set all speeds that matter (estar_set_speed_bulk() makes
+   that cheap). A recorder that a job started is simply dropped, so
+   the job has to call estar_record_stop() itself if it wants the log
+   to be complete.
+   Once the queue is empty, done is called with the same planner,
+   which gets recycled afterwards. Both callbacks run on a worker
+   thread. */
+typedef struct estar_job_s {
+  size_t dimx, dimy;
+  void (*setup) (estar_t * estar, void * data);
+  void (*done) (estar_t * estar, void * data);
+  void * data;
+  
+  /* managed by the pool */
+  estar_pool_instance_t * inst;
+  double submitted;		/* CLOCK_MONOTONIC, in seconds */
+  size_t npops;
+  size_t nslices;
+  struct estar_job_s * prev, * next;
+} estar_job_t;
+
+
+/* Jobs that have been started, waiting for their next slice. */
+typedef struct {
+  pthread_mutex_t mutex;
+  estar_job_t * head, * tail;
+} estar_pool_deque_t;
+
+
+/* A fixed set of worker threads that run estar_job_t, recycling the
+   planners of finished jobs for the next jobs of the same size.
+   
+   Jobs propagate in slices of at most budget expansions. After a
+   slice, an unfinished job goes to the back of the deque of the
+   worker that ran it, so that one long flush cannot hold up the short
+   ones behind it. New jobs wait in a shared inbox. Workers start
+   (that is, get a planner for) the first one of them as long as there
+   are fewer than max_active started jobs. Otherwise they continue the
+   started jobs from the front of their own deque, and when that is
+   empty, steal from the back of the deques of the others. The limit
+   bounds the number of planners in use, and thus the memory, while
+   still letting short jobs overtake long ones. Of the planners that
+   are not in use, the max_free most recently used ones are kept for
+   jobs of the same size, and older ones get freed.
+   
+   A worker that puts a job back or finishes one continues with the
+   next job itself, so it only wakes up another worker if there is
+   more work than that: a job it put back behind others on its deque,
+   or a new job that can start besides the one it put back. */
+typedef struct {
+  size_t nthreads;
+  pthread_t * thread;
+  estar_pool_deque_t * deque;	/* one per worker */
+  
+  pthread_mutex_t mutex;	/* protects everything below */
+  pthread_cond_t work;		/* seq changed, or quit */
+  pthread_cond_t idle;		/* pending dropped to zero */
+  unsigned long seq;		/* bumped whenever there may be new work */
+  int quit;
+  estar_job_t * inbox_head, * inbox_tail;
+  size_t pending;		/* submitted and not done yet */
+  size_t active;		/* started and not done yet */
+  estar_pool_instance_t * free;	/* most recently used first */
+  size_t nfree;
+  size_t ninstances;		/* planners in use or on the free list */
+  double latency[ESTAR_POOL_NLATENCY]; /* ring buffer, in seconds */
+  size_t nlatency;		/* number of samples ever taken */
+  
+  /* can be changed while no jobs are pending */
+  size_t budget;		/* expansions per slice, default 1024 */
+  size_t max_active;		/* default 2 * nthreads */
+  size_t max_free;		/* default max_active */
+  estar_grid_conf_t conf;	/* for new planners */
+} estar_pool_t;
+
+
+/* Starts nthreads workers. New planners get the given grid
+   configuration, or the default one if conf is NULL. */
+void estar_pool_init (estar_pool_t * pool, size_t nthreads,
+		      estar_grid_conf_t const * conf);
+
+/* Waits for all pending jobs, stops the workers, and frees all
+   planners. */
+void estar_pool_fini (estar_pool_t * pool);
+
+/* Queues a job and returns right away. Can be called from any thread,
+   including from the callbacks of other jobs. */
+void estar_pool_submit (estar_pool_t * pool, estar_job_t * job);
+
+/* Blocks until all submitted jobs are done. */
+void estar_pool_wait (estar_pool_t * pool);
+
+/* Median and 99th percentile of the time from submission to the end
+   of the done callback, over the last ESTAR_POOL_NLATENCY jobs, in
+   seconds. Both are zero if no job has finished yet. */
+void estar_pool_latency (estar_pool_t * pool, double * p50, double * p99);
+
+/* Forgets the latency samples taken so far. */
+void estar_pool_clear_latency (estar_pool_t * pool);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -41,18 +41,54 @@ extern "C" {
 #endif
 
 
+/* Return codes of the functions that can fail without exiting. */
+enum {
+  ESTAR_OK = 0,
+  ESTAR_EFULL = -1,		/* fixed-capacity queue is full */
+  ESTAR_ENOMEM = -2		/* could not allocate memory */
+};
+
+
 typedef struct {
   estar_cell_t ** heap;
   size_t len, cap;
+  /* the heap doubles when it is full, and halves when it is less
+     than a quarter full, but never below mincap */
+  size_t mincap;
+  /* when non-zero, the heap is never reallocated: inserting into a
+     full queue fails with ESTAR_EFULL instead */
+  int fixed;
+  /* optional term added to the key of every cell (NULL means none);
+     this is how estar_set_focus() biases the queue */
+  double (*bias) (void * data, estar_cell_t const * cell);
+  void * bias_data;
 } estar_pqueue_t;
 
 
 void estar_pqueue_init (estar_pqueue_t * pq, size_t cap);
 void estar_pqueue_fini (estar_pqueue_t * pq);
 
+/* Make room for at least cap cells and switch to fixed capacity, so
+   that no further allocations take place. Returns ESTAR_OK, or
+   ESTAR_ENOMEM (in which case the queue is left unchanged). */
+int estar_pqueue_reserve (estar_pqueue_t * pq, size_t cap);
+
 double estar_pqueue_topkey (estar_pqueue_t * pq);
 
-void estar_pqueue_insert_or_update (estar_pqueue_t * pq, estar_cell_t * cell);
+/* The key that the cell gets on the queue, at the precision of
+   estar_real_t, so that it compares equal to the stored key. */
+double estar_pqueue_calc_key (estar_pqueue_t * pq, estar_cell_t const * cell);
+
+/* Recompute the keys of all queued cells and restore the heap
+   property. Needed whenever the bias changes in a way that can lower
+   keys. */
+void estar_pqueue_rekey (estar_pqueue_t * pq);
+
+/* Returns ESTAR_OK, or ESTAR_EFULL if the queue has a fixed
+   capacity and the cell does not fit anymore. Without fixed capacity
+   the heap grows as needed, and failure to do so exits the
+   process. */
+int estar_pqueue_insert_or_update (estar_pqueue_t * pq, estar_cell_t * cell);
 void estar_pqueue_remove_or_ignore (estar_pqueue_t * pq, estar_cell_t * cell);
 
 estar_cell_t * estar_pqueue_extract (estar_pqueue_t * pq);
@@ -0,0 +1,128 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_PROFILE_H
+#define ESTAR2_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Histograms with a fixed set of log-linear buckets, in the spirit of
+   HdrHistogram: values below 2^ESTAR_HIST_SUB_BITS each get their own
+   bucket, larger ones share a bucket with all values that agree in
+   their ESTAR_HIST_SUB_BITS + 1 most significant bits. This bounds
+   the relative error to about 6%, over the whole range of uint64_t,
+   with less than a thousand buckets. */
+#define ESTAR_HIST_SUB_BITS 4
+#define ESTAR_HIST_NBUCKETS ((64 - ESTAR_HIST_SUB_BITS + 1) << ESTAR_HIST_SUB_BITS)
+
+typedef struct {
+  uint64_t count[ESTAR_HIST_NBUCKETS];
+  uint64_t total;		/* number of recorded values */
+  uint64_t min, max;
+  double sum;
+} estar_hist_t;
+
+
+void estar_hist_init (estar_hist_t * hist);
+void estar_hist_record (estar_hist_t * hist, uint64_t value);
+
+/* Index of the bucket for a value, and the smallest value that falls
+   into a given bucket. */
+size_t estar_hist_bucket (uint64_t value);
+uint64_t estar_hist_bucket_low (size_t bucket);
+
+/* Lower bound of the bucket that contains the q-quantile, for q in
+   [0, 1]. Returns 0 for an empty histogram. */
+uint64_t estar_hist_quantile (estar_hist_t const * hist, double q);
+
+
+/* What happened during one change epoch. An epoch starts with the
+   first estar_set_speed() or estar_set_goal() after the queue was
+   empty, and ends when estar_propagate() empties the queue again.
+   Changes made while an epoch is running become part of it. A change
+   that leaves the queue empty (such as one of a cell the wavefront has
+   not reached yet) ends the epoch right away, which then only gets
+   recorded if something had been expanded in it. */
+typedef struct {
+  uint64_t id;			/* epochs are numbered from one */
+  size_t nchanges;		/* calls to set_speed/set_goal that did something */
+  size_t xmin, ymin, xmax, ymax; /* bounding box of the changed cells */
+  size_t raised, lowered;	/* expansions of either kind */
+  size_t peak_queue;		/* longest the queue got */
+  uint64_t nsec;		/* wall time from first change to empty queue */
+} estar_epoch_t;
+
+
+/* Collects epochs into histograms. Attach it to an estar_t with
+   estar_set_profile(). Nothing in here allocates memory, so it can be
+   used in real-time mode. */
+typedef struct {
+  estar_hist_t raised;
+  estar_hist_t lowered;
+  estar_hist_t peak_queue;
+  estar_hist_t nsec;
+  estar_epoch_t current;	/* valid while active is non-zero */
+  estar_epoch_t worst;		/* the one which raised the most cells */
+  int active;
+  uint64_t nepochs;
+  uint64_t t0;			/* start of the current epoch */
+  /* optional, called at the end of each epoch */
+  void (*on_epoch) (void * data, estar_epoch_t const * epoch);
+  void * on_epoch_data;
+} estar_profile_t;
+
+
+void estar_profile_init (estar_profile_t * profile);
+
+/* Used by the planner to keep track of epochs, see estar.c. */
+void estar_profile_change (estar_profile_t * profile, size_t ix, size_t iy);
+void estar_profile_finish (estar_profile_t * profile);
+void estar_profile_idle (estar_profile_t * profile);
+
+/* Writes the histograms (non-empty buckets only, as pairs of bucket
+   lower bound and count), a few quantiles, and the worst epoch as a
+   JSON object. Returns 0 on success, -1 if writing failed. */
+int estar_profile_write_json (estar_profile_t const * profile, FILE * fp);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_QUERY_H
+#define ESTAR2_QUERY_H
+
+#include <estar2/estar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Queries of the navigation function at continuous positions. Cell
+   (ix, iy) is centered on the point (ix, iy), just like for the paths
+   that gestar2 and estar-cli trace, so the grid covers the rectangle
+   [-0.5, dimx-0.5) x [-0.5, dimy-0.5).
+
+   Within the square spanned by four neighboring cell centers, phi is
+   interpolated bilinearly, and the gradient is that of the
+   interpolating patch. Like estar_cell_calc_gradient(), gradients
+   point downhill, towards the goal, with x and y growing along the
+   grid indices. Where one of the four cells has an infinite phi
+   (obstacles, cells that have not been reached yet), the nearest cell
+   is used instead: its phi, and its gradient according to
+   estar_cell_calc_gradient(), which is zero if there is none or if
+   the nearest cell itself is at infinity. Points
+   outside the grid get an infinite phi and a zero gradient. */
+
+/* Query npoints positions given as interleaved coordinates in xy
+   (x0, y0, x1, y1, ...). Writes npoints values to phi, and if grad is
+   not NULL also npoints interleaved gradient vectors. The points are
+   handled in blocks: the cells for a whole block get looked up (and
+   prefetched) first, and only then interpolated, so the memory
+   accesses of neighboring points overlap. Points that are close to
+   each other in the input should be close to each other on the grid
+   for best performance. Returns the number of points with a finite
+   phi. */
+size_t estar_query (estar_grid_t const * grid, size_t npoints,
+		    double const * xy, double * phi, double * grad);
+
+/* Compute the gradient of every cell in the rectangle of width x
+   height cells starting at (x0, y0), which has to lie within the
+   grid, with the same conventions as
+   estar_cell_calc_gradient(). The gradient of cell (x0 + ix, y0 + iy)
+   goes to gx[iy * stride + ix] and gy[iy * stride + ix]. Unlike
+   estar_cell_calc_gradient(), which gives infinite components for a
+   cell at infinity next to finite ones (an obstacle at the edge of
+   the wavefront, for instance), cells at infinity get a zero gradient
+   here, as in estar_query(). The axes are also the true ones for
+   grids that are only one cell wide.
+
+   The rows are processed in runs of cells that are contiguous in
+   memory: their rhs values and those of their neighbors are copied
+   into buffers first, and the gradients then get computed without
+   branches, which the compiler can vectorize.
+
+   If since is not NULL and *since is not zero, only the cells whose
+   gradient might have changed since estar->version was *since get
+   recomputed (see ESTAR_STAMP_SHIFT), and the others are left alone,
+   so gx and gy have to hold the result of an earlier call for the
+   same rectangle. Either way, *since is set to the current version
+   afterwards. Returns the number of recomputed cells. */
+size_t estar_compute_gradient_field (estar_t const * estar,
+				     size_t x0, size_t y0,
+				     size_t width, size_t height,
+				     double * gx, double * gy, size_t stride,
+				     unsigned long long * since);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_RECORD_H
+#define ESTAR2_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Compact binary log of the calls made on an estar_t, which can be
+   replayed with the estar-replay tool. The log starts with a header
+ 
+     "ESTARLOG"  magic
+     u32         format version (ESTAR_RECORD_VERSION)
+     u32         tile size of the grid layout
+     u64 u64     dimx dimy
+ 
+   followed by records that each start with one of the opcodes below.
+   All integers and doubles are stored in little-endian byte order.
+   Runs of consecutive estar_propagate() calls are stored as a single
+   record with a count. */
+#define ESTAR_RECORD_VERSION 3
+
+enum {
+  ESTAR_RECORD_GOAL        = 'G', /* u32 ix, u32 iy */
+  ESTAR_RECORD_SPEED       = 'S', /* u32 ix, u32 iy, f64 speed */
+  ESTAR_RECORD_COST        = 'K', /* u32 ix, u32 iy, f64 cost */
+  ESTAR_RECORD_PROPAGATE   = 'P', /* u64 count */
+  ESTAR_RECORD_RESET       = 'R',
+  ESTAR_RECORD_FOCUS       = 'F', /* u32 ix, u32 iy */
+  ESTAR_RECORD_CLEAR_FOCUS = 'C',
+  ESTAR_RECORD_PHI         = 'Z', /* u64 n, n * f64 phi in row-major order */
+  ESTAR_RECORD_ROI         = 'O', /* u64 n, n * u8 mask in row-major order */
+  ESTAR_RECORD_END         = 'E'
+};
+
+
+typedef struct {
+  FILE * fp;
+  uint64_t npropagate;		/* pending run of estar_propagate() calls */
+  int error;			/* non-zero after a failed write */
+} estar_recorder_t;
+
+
+/* Used by the planner to log its calls, see estar.c. The opcode
+   decides which of the arguments get written. */
+void estar_record (estar_recorder_t * rec, int op, size_t ix, size_t iy, double value);
+void estar_record_propagate (estar_recorder_t * rec);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
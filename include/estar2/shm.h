@@ -0,0 +1,141 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_SHM_H
+#define ESTAR2_SHM_H
+
+#include <estar2/estar.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define ESTAR_SHM_MAGIC 0x4d485345u /* "ESHM" in little endian */
+
+
+/* Start of a shared-memory region created by estar_shm_create(). The
+   map is split into square tiles, and each tile has its cells stored
+   contiguously, row by row, in each of the arrays. The arrays
+   start at the given byte offsets from the beginning of the region.
+   Cells of the last row and column of tiles that lie outside of the
+   map have infinite phi and rhs and ESTAR_FLAG_OBSTACLE.
+   
+   The version of a tile is odd while the producer writes to it, and
+   grows by two with each write. The sequence counter works the same
+   way for a whole estar_shm_publish(). */
+typedef struct {
+  uint32_t magic;		/* ESTAR_SHM_MAGIC once initialized */
+  uint32_t tile;		/* cells per side of a tile */
+  uint64_t dimx, dimy;
+  uint64_t tdimx, tdimy;	/* number of tiles */
+  uint64_t size;		/* of the whole region, in bytes */
+  uint64_t seq;
+  uint64_t version;		/* offset of uint64_t[tdimx * tdimy] */
+  uint64_t phi;			/* offset of double[tdimx * tdimy * tile * tile] */
+  uint64_t rhs;			/* same */
+  uint64_t flags;		/* offset of uint8_t[tdimx * tdimy * tile * tile] */
+} estar_shm_header_t;
+
+
+/* A mapping of the region, as the producer or as a consumer. */
+typedef struct {
+  char * name;
+  int producer;
+  estar_shm_header_t * header;
+  uint64_t * version;
+  double * phi;
+  double * rhs;
+  uint8_t * flags;
+  int published;		/* producer only: at least once */
+  unsigned long long since;	/* producer only: estar_t::version at last publish */
+} estar_shm_t;
+
+
+/* Creates the region with the given POSIX shared-memory name (such as
+   "/estar") and maps it read-write. The tile size is the number of
+   cells per side, e.g. 16. Returns 0, or -1 with errno set: EINVAL for
+   a tile size of zero, and EEXIST if the name is taken, which keeps
+   two producers from silently taking over each other's region. A
+   region left behind by a producer that did not get to call
+   estar_shm_close() has to be removed with shm_unlink() first. */
+int estar_shm_create (estar_shm_t * shm, char const * name,
+		      size_t dimx, size_t dimy, size_t tile);
+
+/* Maps an existing region read-only. Returns 0, or -1 with errno set
+   (EINVAL if the region has not been initialized). */
+int estar_shm_open (estar_shm_t * shm, char const * name);
+
+/* Unmaps the region. For the producer, also removes the name, which
+   consumers that still have it mapped do not notice. */
+void estar_shm_close (estar_shm_t * shm);
+
+/* Copies phi, rhs and the flags of the planner, which must have the
+   dimensions of the region, into it. Only the tiles that can have
+   changed since the last call get written, judging by the stamps of
+   the planner (see ESTAR_STAMP_SHIFT). Returns the number of tiles
+   written. Meant to be called between propagation batches. */
+size_t estar_shm_publish (estar_shm_t * shm, estar_t const * estar);
+
+/* Index of a cell into the arrays of the region. */
+static inline size_t estar_shm_index (estar_shm_header_t const * header,
+				      size_t ix, size_t iy)
+{
+  size_t const tile = header->tile;
+  return ((iy / tile) * header->tdimx + ix / tile) * tile * tile
+    + (iy % tile) * tile + ix % tile;
+}
+
+/* Reading a tile in place: estar_shm_tile_begin() waits until the
+   tile is not being written and returns its version. After reading,
+   estar_shm_tile_end() tells whether the version is still the same,
+   i.e. whether what was read is consistent. If it is not, start
+   over. */
+uint64_t estar_shm_tile_begin (estar_shm_t const * shm, size_t tx, size_t ty);
+int estar_shm_tile_end (estar_shm_t const * shm, size_t tx, size_t ty, uint64_t version);
+
+/* Copies a consistent state of a tile, retrying as needed, into
+   arrays of tile * tile cells (any of them can be NULL), and returns
+   its version. */
+uint64_t estar_shm_read_tile (estar_shm_t const * shm, size_t tx, size_t ty,
+			      double * phi, double * rhs, uint8_t * flags);
+
+/* The sequence counter, which is odd during a publication. */
+uint64_t estar_shm_seq (estar_shm_t const * shm);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ESTAR2_VOLUME_H
+#define ESTAR2_VOLUME_H
+
+#include <estar2/cell.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* E* on a three-dimensional grid of voxels, each connected to its six
+   face neighbors. Where the 2D planner combines pairs of neighbors,
+   the update here combines the lowest neighbor along each of the
+   three axes, solving the eikonal equation in one, two or three
+   dimensions depending on how many of them are low enough to
+   contribute. Otherwise it works just like estar_t, including the
+   queue (see src/heap.h), so that changing speeds only repairs what is
+   affected.
+   
+   Voxels do not store any neighbor pointers. They are kept in x, then
+   y, then z order, surrounded by one layer of obstacle voxels that
+   take the place of bounds checks, so the neighbors are at fixed
+   offsets. At 24 bytes per voxel (plus the outer layer, and 8 bytes
+   per queued voxel), a 512^3 volume takes about 3.3 GB. */
+typedef struct {
+  float cost;			/* 1/speed */
+  float phi;
+  float rhs;
+  float key;			/* managed by the queue */
+  uint32_t pqi;			/* managed by the queue; 0 means "not on queue" */
+  uint8_t flags;		/* ESTAR_FLAG_GOAL and ESTAR_FLAG_OBSTACLE */
+} estar_voxel_t;
+
+
+typedef struct {
+  estar_voxel_t * voxel;	/* including the outer layer */
+  size_t dimx, dimy, dimz;
+  size_t nvoxels;		/* (dimx + 2) * (dimy + 2) * (dimz + 2) */
+  size_t step[3];		/* offsets of the neighbors along x, y, z */
+  estar_voxel_t ** heap;	/* the queue, index 0 is unused */
+  size_t len, cap;
+} estar_volume_t;
+
+
+/* All voxels start out with a speed of one. Fails (via errx()) if
+   the memory cannot be allocated, or if there are 2^32 voxels or
+   more. */
+void estar_volume_init (estar_volume_t * vol, size_t dimx, size_t dimy, size_t dimz);
+void estar_volume_fini (estar_volume_t * vol);
+
+/* Forget all goals and propagation results, but keep the speeds. */
+void estar_volume_reset (estar_volume_t * vol);
+
+void estar_volume_set_goal (estar_volume_t * vol, size_t ix, size_t iy, size_t iz);
+
+/* A speed of zero or less turns the voxel into an obstacle. */
+void estar_volume_set_speed (estar_volume_t * vol, size_t ix, size_t iy, size_t iz,
+			     double speed);
+
+/* Expand the voxel at the top of the queue, if any. */
+void estar_volume_propagate (estar_volume_t * vol);
+
+
+static inline estar_voxel_t * estar_volume_at (estar_volume_t const * vol,
+					       size_t ix, size_t iy, size_t iz)
+{
+  return &vol->voxel[(iz + 1) * vol->step[2] + (iy + 1) * vol->step[1] + ix + 1];
+}
+
+
+static inline void estar_volume_coords (estar_volume_t const * vol,
+					estar_voxel_t const * voxel,
+					size_t * ix, size_t * iy, size_t * iz)
+{
+  size_t const idx = voxel - vol->voxel;
+  *ix = idx % vol->step[1] - 1;
+  *iy = idx % vol->step[2] / vol->step[1] - 1;
+  *iz = idx / vol->step[2] - 1;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,755 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Fixed benchmark scenarios for tracking the performance of the
+ * library across versions. Each scenario runs in a child process, so
+ * that the peak memory reported for it is its own. The results are
+ * written to stdout as one JSON document.
+ *
+ * Scenarios (each one on a square map of each requested size):
+ *   open                 empty map, goal in the center, flush
+ *   random-05/-20/-35    5, 20, 35 percent random obstacles, flush
+ *   maze                 random maze with corridors 6 cells wide
+ *   distance-transform   5 percent obstacles, all of which are goals
+ *   repair               flushed 5 percent map, then repeatedly insert
+ *                        a single obstacle near the path, flush, remove
+ *                        it again, flush (only the repairs are timed)
+ *   moving-goal          5 percent map, reset and replan for a goal
+ *                        that moves along the diagonal
+ *   frame                flushed 5 percent map, then repeatedly apply
+ *                        whole speed frames with estar_set_speed_frame()
+ *                        (unchanged, with a few new obstacles, with
+ *                        those removed again) and flush (only the
+ *                        frames are timed)
+ *   query                flushed 5 percent map, then batches of 100k
+ *                        estar_query() points, alternating between a
+ *                        64x64 window and the whole map (only the
+ *                        queries are timed)
+ *
+ * With -m, the map is read from a binary PGM file instead (pixel
+ * value divided by the maximum value gives the speed) and only the
+ * flush, distance-transform, repair and moving-goal workloads run on
+ * it. Sizes whose estimated footprint exceeds the physical memory
+ * are reported as skipped.
+ *
+ * usage: bench-estar [-s size]... [-c scenario]... [-m map.pgm]
+ *                    [-t tile] [-S seed]
+ */
+
+#include <estar2/estar.h>
+#include <estar2/query.h>
+
+#include <sys/resource.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+#include <math.h>
+#include <time.h>
+
+
+typedef struct {
+  size_t dimx, dimy;
+  unsigned char * speed;	/* 0 is an obstacle, 255 is free space */
+  size_t goalx, goaly;
+} map_t;
+
+
+typedef struct {
+  size_t pops;
+  size_t ncomputations;		/* full computations, zero for repairs */
+  size_t nrepairs;
+  size_t nqueries;
+  double seconds;
+} result_t;
+
+
+typedef struct {
+  char const * name;
+  void (*generate) (map_t * map, double param);
+  double param;
+  void (*workload) (estar_t * estar, map_t const * map, result_t * res);
+} scenario_t;
+
+
+static uint64_t rng_state;
+static size_t tile;
+
+
+static void rng_seed (uint64_t seed)
+{
+  rng_state = seed * 2 + 1;
+}
+
+
+static uint32_t rng_next (void)
+{
+  // Knuth's MMIX LCG, so that the maps are the same on every platform
+  rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rng_state >> 33;
+}
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static void map_alloc (map_t * map, size_t dimx, size_t dimy)
+{
+  map->dimx = dimx;
+  map->dimy = dimy;
+  map->speed = malloc (dimx * dimy);
+  if (NULL == map->speed) {
+    errx (EXIT_FAILURE, "%s: malloc", __func__);
+  }
+  memset (map->speed, 255, dimx * dimy);
+  map->goalx = dimx / 2;
+  map->goaly = dimy / 2;
+}
+
+
+static void clear_goal_area (map_t * map)
+{
+  size_t ix, iy;
+  for (ix = map->goalx > 2 ? map->goalx - 2 : 0; ix <= map->goalx + 2 && ix < map->dimx; ++ix) {
+    for (iy = map->goaly > 2 ? map->goaly - 2 : 0; iy <= map->goaly + 2 && iy < map->dimy; ++iy) {
+      map->speed[iy * map->dimx + ix] = 255;
+    }
+  }
+}
+
+
+static void gen_open (map_t * map, double param)
+{
+}
+
+
+static void gen_random (map_t * map, double density)
+{
+  size_t ii;
+  uint32_t const thresh = density * 0x80000000U;
+  
+  for (ii = 0; ii < map->dimx * map->dimy; ++ii) {
+    if (rng_next () < thresh) {
+      map->speed[ii] = 0;
+    }
+  }
+  clear_goal_area (map);
+}
+
+
+static void gen_maze (map_t * map, double param)
+{
+  size_t const width = 8;	/* corridor plus wall */
+  size_t const wall = 2;
+  size_t const nx = map->dimx / width;
+  size_t const ny = map->dimy / width;
+  size_t * stack;
+  unsigned char * visited;
+  size_t len, node, next, cand[4], ncand, ix, iy, jx, jy, x0, y0, x1, y1;
+  
+  memset (map->speed, 0, map->dimx * map->dimy);
+  if (0 == nx || 0 == ny) {
+    return;
+  }
+  stack = malloc (sizeof(*stack) * nx * ny);
+  visited = calloc (nx * ny, 1);
+  if (NULL == stack || NULL == visited) {
+    errx (EXIT_FAILURE, "%s: malloc", __func__);
+  }
+  
+  // depth-first carving, starting at the node that holds the goal
+  map->goalx = nx / 2 * width + (width - wall) / 2;
+  map->goaly = ny / 2 * width + (width - wall) / 2;
+  len = 0;
+  stack[len++] = ny / 2 * nx + nx / 2;
+  visited[ny / 2 * nx + nx / 2] = 1;
+  while (len > 0) {
+    node = stack[len - 1];
+    ix = node % nx;
+    iy = node / nx;
+    ncand = 0;
+    if (ix > 0 && ! visited[node - 1]) {
+      cand[ncand++] = node - 1;
+    }
+    if (ix < nx - 1 && ! visited[node + 1]) {
+      cand[ncand++] = node + 1;
+    }
+    if (iy > 0 && ! visited[node - nx]) {
+      cand[ncand++] = node - nx;
+    }
+    if (iy < ny - 1 && ! visited[node + nx]) {
+      cand[ncand++] = node + nx;
+    }
+    if (0 == ncand) {
+      --len;
+      continue;
+    }
+    next = cand[rng_next () % ncand];
+    visited[next] = 1;
+    stack[len++] = next;
+    
+    // open up both nodes and the wall between them
+    jx = next % nx;
+    jy = next / nx;
+    x0 = (ix < jx ? ix : jx) * width;
+    y0 = (iy < jy ? iy : jy) * width;
+    x1 = (ix > jx ? ix : jx) * width + width - wall;
+    y1 = (iy > jy ? iy : jy) * width + width - wall;
+    for (jy = y0; jy < y1; ++jy) {
+      memset (map->speed + jy * map->dimx + x0, 255, x1 - x0);
+    }
+  }
+  
+  free (stack);
+  free (visited);
+}
+
+
+static int pgm_token (FILE * fp, size_t * value)
+{
+  int cc;
+  
+  // skip whitespace and comments
+  for (cc = fgetc (fp); EOF != cc; cc = fgetc (fp)) {
+    if ('#' == cc) {
+      while (EOF != cc && '\n' != cc) {
+	cc = fgetc (fp);
+      }
+    }
+    else if (cc != ' ' && cc != '\t' && cc != '\r' && cc != '\n') {
+      break;
+    }
+  }
+  if (cc < '0' || cc > '9') {
+    return -1;
+  }
+  for (*value = 0; cc >= '0' && cc <= '9'; cc = fgetc (fp)) {
+    *value = *value * 10 + cc - '0';
+  }
+  return 0;		/* the single whitespace after the token is eaten */
+}
+
+
+static void load_pgm (map_t * map, char const * fname)
+{
+  FILE * fp;
+  size_t dimx, dimy, maxval, ii, best, dist;
+  
+  fp = fopen (fname, "rb");
+  if (NULL == fp) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  if ('P' != fgetc (fp) || '5' != fgetc (fp)
+      || pgm_token (fp, &dimx) || pgm_token (fp, &dimy) || pgm_token (fp, &maxval)
+      || 0 == dimx || 0 == dimy || 0 == maxval || maxval > 255) {
+    errx (EXIT_FAILURE, "%s: not an 8-bit binary PGM file", fname);
+  }
+  map_alloc (map, dimx, dimy);
+  if (dimx * dimy != fread (map->speed, 1, dimx * dimy, fp)) {
+    errx (EXIT_FAILURE, "%s: file too short", fname);
+  }
+  fclose (fp);
+  
+  // PGM rows go from top to bottom, flip them so y points up
+  for (ii = 0; ii < dimx * dimy; ++ii) {
+    map->speed[ii] = map->speed[ii] * 255 / maxval;
+  }
+  for (ii = 0; ii < dimy / 2; ++ii) {
+    unsigned char tmp[dimx];
+    memcpy (tmp, map->speed + ii * dimx, dimx);
+    memcpy (map->speed + ii * dimx, map->speed + (dimy - 1 - ii) * dimx, dimx);
+    memcpy (map->speed + (dimy - 1 - ii) * dimx, tmp, dimx);
+  }
+  
+  // goal at the free cell closest to the center
+  best = (size_t) -1;
+  for (ii = 0; ii < dimx * dimy; ++ii) {
+    if (0 == map->speed[ii]) {
+      continue;
+    }
+    dist = labs ((long) (ii % dimx) - (long) (dimx / 2))
+      + labs ((long) (ii / dimx) - (long) (dimy / 2));
+    if (dist < best) {
+      best = dist;
+      map->goalx = ii % dimx;
+      map->goaly = ii / dimx;
+    }
+  }
+  if ((size_t) -1 == best) {
+    errx (EXIT_FAILURE, "%s: no free cell", fname);
+  }
+}
+
+
+static void apply_map (estar_t * estar, map_t const * map)
+{
+  size_t ix, iy;
+  unsigned char const * sp;
+  
+  sp = map->speed;
+  for (iy = 0; iy < map->dimy; ++iy) {
+    for (ix = 0; ix < map->dimx; ++ix, ++sp) {
+      if (255 != *sp) {
+	estar_set_speed (estar, ix, iy, *sp / 255.0);
+      }
+    }
+  }
+}
+
+
+static size_t flush (estar_t * estar)
+{
+  size_t npops;
+  for (npops = 0; 0 != estar->pq.len; ++npops) {
+    estar_propagate (estar);
+  }
+  return npops;
+}
+
+
+static void run_flush (estar_t * estar, map_t const * map, result_t * res)
+{
+  double t0;
+  
+  apply_map (estar, map);
+  estar_set_goal (estar, map->goalx, map->goaly);
+  t0 = now ();
+  res->pops = flush (estar);
+  res->seconds = now () - t0;
+  res->ncomputations = 1;
+}
+
+
+static void run_distance_transform (estar_t * estar, map_t const * map, result_t * res)
+{
+  size_t ix, iy;
+  unsigned char const * sp;
+  double t0;
+  
+  sp = map->speed;
+  for (iy = 0; iy < map->dimy; ++iy) {
+    for (ix = 0; ix < map->dimx; ++ix, ++sp) {
+      if (0 == *sp) {
+	estar_set_goal (estar, ix, iy);
+      }
+    }
+  }
+  t0 = now ();
+  res->pops = flush (estar);
+  res->seconds = now () - t0;
+  res->ncomputations = 1;
+}
+
+
+static void run_repair (estar_t * estar, map_t const * map, result_t * res)
+{
+  size_t const nrepairs = 20;
+  size_t ii, ix, iy, dx, dy;
+  estar_cell_t * cell;
+  double t0;
+  
+  apply_map (estar, map);
+  estar_set_goal (estar, map->goalx, map->goaly);
+  flush (estar);
+  
+  // Obstacles go into free cells near the goal, where they affect a
+  // large part of the map, and at random distances further out.
+  res->pops = 0;
+  res->seconds = 0.0;
+  dx = map->dimx / 4;
+  dy = map->dimy / 4;
+  for (ii = 0; ii < nrepairs; ++ii) {
+    do {
+      if (0 == ii % 2) {
+	ix = map->goalx + 3 + rng_next () % 8;
+	iy = map->goaly + rng_next () % 8;
+      }
+      else {
+	ix = map->goalx - dx + rng_next () % (2 * dx + 1);
+	iy = map->goaly - dy + rng_next () % (2 * dy + 1);
+      }
+    } while (ix >= map->dimx || iy >= map->dimy
+	     || 0 == map->speed[iy * map->dimx + ix]
+	     || (ix == map->goalx && iy == map->goaly));
+    cell = estar_grid_at (&estar->grid, ix, iy);
+    
+    t0 = now ();
+    estar_set_speed (estar, ix, iy, 0.0);
+    res->pops += flush (estar);
+    estar_set_speed (estar, ix, iy, map->speed[iy * map->dimx + ix] / 255.0);
+    res->pops += flush (estar);
+    res->seconds += now () - t0;
+    
+    if (isinf (cell->phi)) {	/* the cell should be reachable again */
+      warnx ("repair at %zu %zu left phi at infinity", ix, iy);
+    }
+  }
+  res->nrepairs = 2 * nrepairs;
+}
+
+
+static void run_moving_goal (estar_t * estar, map_t const * map, result_t * res)
+{
+  size_t const nsteps = 4;
+  size_t ii, ix, iy;
+  double t0;
+  
+  apply_map (estar, map);
+  res->pops = 0;
+  res->seconds = 0.0;
+  for (ii = 0; ii < nsteps; ++ii) {
+    // walk along the diagonal towards the goal, skipping obstacles
+    ix = map->goalx * (ii + 1) / nsteps;
+    iy = map->goaly * (ii + 1) / nsteps;
+    while (0 == map->speed[iy * map->dimx + ix] && ix < map->goalx) {
+      ++ix;
+    }
+    t0 = now ();
+    estar_reset (estar);
+    estar_set_goal (estar, ix, iy);
+    res->pops += flush (estar);
+    res->seconds += now () - t0;
+  }
+  res->ncomputations = nsteps;
+}
+
+
+static void run_frame (estar_t * estar, map_t const * map, result_t * res)
+{
+  size_t const nframes = 21;
+  size_t const nchanges = 16;
+  size_t const ncells = map->dimx * map->dimy;
+  size_t ii, jj, ix;
+  size_t changed[16];
+  float * frame;
+  double t0;
+  
+  frame = malloc (ncells * sizeof(*frame));
+  if (NULL == frame) {
+    errx (EXIT_FAILURE, "%s: out of memory", __func__);
+  }
+  for (ii = 0; ii < ncells; ++ii) {
+    frame[ii] = map->speed[ii] / 255.0;
+  }
+  estar_set_speed_frame (estar, frame);
+  estar_set_goal (estar, map->goalx, map->goaly);
+  flush (estar);
+  
+  // Frames come in groups of three: one identical to its predecessor,
+  // one that adds a handful of obstacles, and one that removes them
+  // again.
+  res->pops = 0;
+  res->seconds = 0.0;
+  for (ii = 0; ii < nframes; ++ii) {
+    if (1 == ii % 3) {
+      for (jj = 0; jj < nchanges; ++jj) {
+	do {
+	  ix = rng_next () % ncells;
+	} while (ix == map->goaly * map->dimx + map->goalx);
+	changed[jj] = ix;
+	frame[ix] = 0.0f;
+      }
+    }
+    else if (2 == ii % 3) {
+      for (jj = 0; jj < nchanges; ++jj) {
+	ix = changed[jj];
+	frame[ix] = map->speed[ix] / 255.0;
+      }
+    }
+    t0 = now ();
+    estar_set_speed_frame (estar, frame);
+    res->pops += flush (estar);
+    res->seconds += now () - t0;
+  }
+  res->nrepairs = nframes;
+  free (frame);
+}
+
+
+static void run_query (estar_t * estar, map_t const * map, result_t * res)
+{
+  size_t const nbatches = 20;
+  size_t const npoints = 100000;
+  size_t const window = 64;
+  size_t ii, jj, wx, wy;
+  double * xy;
+  double * phi;
+  double * grad;
+  double t0;
+  
+  xy = malloc (2 * npoints * sizeof(*xy));
+  phi = malloc (npoints * sizeof(*phi));
+  grad = malloc (2 * npoints * sizeof(*grad));
+  if (NULL == xy || NULL == phi || NULL == grad) {
+    errx (EXIT_FAILURE, "%s: out of memory", __func__);
+  }
+  apply_map (estar, map);
+  estar_set_goal (estar, map->goalx, map->goaly);
+  flush (estar);
+  
+  // Even batches model a local planner sampling around the robot,
+  // odd ones are spread over the whole map.
+  res->pops = 0;
+  res->seconds = 0.0;
+  for (ii = 0; ii < nbatches; ++ii) {
+    if (0 == ii % 2) {
+      wx = map->dimx > window ? rng_next () % (map->dimx - window) : 0;
+      wy = map->dimy > window ? rng_next () % (map->dimy - window) : 0;
+      for (jj = 0; jj < npoints; ++jj) {
+	xy[2 * jj] = wx + (rng_next () % (window << 8)) / 256.0;
+	xy[2 * jj + 1] = wy + (rng_next () % (window << 8)) / 256.0;
+      }
+    }
+    else {
+      for (jj = 0; jj < npoints; ++jj) {
+	xy[2 * jj] = (rng_next () % (map->dimx << 8)) / 256.0;
+	xy[2 * jj + 1] = (rng_next () % (map->dimy << 8)) / 256.0;
+      }
+    }
+    t0 = now ();
+    estar_query (&estar->grid, npoints, xy, phi, grad);
+    res->seconds += now () - t0;
+  }
+  res->nqueries = nbatches * npoints;
+  free (xy);
+  free (phi);
+  free (grad);
+}
+
+
+static scenario_t const synthetic[] = {
+  { "open", gen_open, 0.0, run_flush },
+  { "random-05", gen_random, 0.05, run_flush },
+  { "random-20", gen_random, 0.20, run_flush },
+  { "random-35", gen_random, 0.35, run_flush },
+  { "maze", gen_maze, 0.0, run_flush },
+  { "distance-transform", gen_random, 0.05, run_distance_transform },
+  { "repair", gen_random, 0.05, run_repair },
+  { "moving-goal", gen_random, 0.05, run_moving_goal },
+  { "frame", gen_random, 0.05, run_frame },
+  { "query", gen_random, 0.05, run_query },
+  { NULL, NULL, 0.0, NULL }
+};
+
+
+static scenario_t const filebased[] = {
+  { "file-flush", NULL, 0.0, run_flush },
+  { "file-distance-transform", NULL, 0.0, run_distance_transform },
+  { "file-repair", NULL, 0.0, run_repair },
+  { "file-moving-goal", NULL, 0.0, run_moving_goal },
+  { NULL, NULL, 0.0, NULL }
+};
+
+
+static void run (scenario_t const * sc, size_t dim, char const * mapfile, uint64_t seed)
+{
+  estar_grid_conf_t conf;
+  estar_t estar;
+  estar_memory_t mem;
+  struct rusage ru;
+  map_t map;
+  result_t res;
+  double t0, setup;
+  size_t cells;
+  
+  rng_seed (seed);
+  if (NULL != mapfile) {
+    load_pgm (&map, mapfile);
+  }
+  else {
+    map_alloc (&map, dim, dim);
+    sc->generate (&map, sc->param);
+  }
+  
+  t0 = now ();
+  estar_grid_conf_default (&conf);
+  conf.tile = tile;
+  estar_init_conf (&estar, map.dimx, map.dimy, &conf);
+  setup = now () - t0;
+  
+  memset (&res, 0, sizeof(res));
+  sc->workload (&estar, &map, &res);
+  
+  estar_memory_usage (&estar, &mem);
+  getrusage (RUSAGE_SELF, &ru);
+  cells = map.dimx * map.dimy;
+  
+  printf ("    { \"scenario\": \"%s\", \"dimx\": %zu, \"dimy\": %zu, \"cells\": %zu,\n"
+	  "      \"pops\": %zu, \"seconds\": %.6f, \"init_seconds\": %.6f,\n",
+	  sc->name, map.dimx, map.dimy, cells, res.pops, res.seconds, setup);
+  if (res.ncomputations > 0) {
+    printf ("      \"computations\": %zu, \"cells_per_sec\": %.1f,\n",
+	    res.ncomputations, res.ncomputations * cells / res.seconds);
+  }
+  else if (res.nqueries > 0) {
+    printf ("      \"queries\": %zu, \"queries_per_sec\": %.1f,\n",
+	    res.nqueries, res.nqueries / res.seconds);
+  }
+  else {
+    printf ("      \"repairs\": %zu, \"seconds_per_repair\": %.9f,\n",
+	    res.nrepairs, res.seconds / res.nrepairs);
+  }
+  printf ("      \"pops_per_sec\": %.1f, \"estar_bytes\": %zu, \"peak_rss_bytes\": %ld",
+	  res.pops / res.seconds, mem.total, ru.ru_maxrss * 1024L);
+  if (estar_stats_enabled ()) {
+    // these cover the whole run, including setting up the map
+    printf (",\n      \"stats\": { \"pq_insert\": %llu, \"pq_update\": %llu,"
+	    " \"pq_remove\": %llu, \"pq_extract\": %llu,\n"
+	    "        \"raise\": %llu, \"lower\": %llu, \"calc_rhs\": %llu,"
+	    " \"interpolated\": %llu, \"non_interpolated\": %llu, \"fallback\": %llu }",
+	    estar.stats.pq_insert, estar.stats.pq_update,
+	    estar.stats.pq_remove, estar.stats.pq_extract,
+	    estar.stats.raise, estar.stats.lower, estar.stats.calc_rhs,
+	    estar.stats.interpolated, estar.stats.non_interpolated, estar.stats.fallback);
+  }
+  printf (" }");
+  
+  estar_fini (&estar);
+  free (map.speed);
+}
+
+
+static int fits (size_t dim)
+{
+  double const need = (double) dim * dim * (sizeof(estar_cell_t) + 1);
+  double const have = (double) sysconf (_SC_PHYS_PAGES) * sysconf (_SC_PAGESIZE);
+  return have <= 0 || need < 0.9 * have;
+}
+
+
+int main (int argc, char ** argv)
+{
+  static size_t const default_size[] = { 256, 1024, 4096, 16384, 0 };
+  size_t size[32];
+  char const * scname[32];
+  size_t nsizes, nscnames, ii, jj;
+  scenario_t const * sc;
+  char const * mapfile;
+  uint64_t seed;
+  pid_t pid;
+  int opt, status, first;
+  
+  nsizes = 0;
+  nscnames = 0;
+  mapfile = NULL;
+  tile = 1;
+  seed = 42;
+  while (-1 != (opt = getopt (argc, argv, "s:c:m:t:S:"))) {
+    switch (opt) {
+    case 's':
+      if (nsizes < sizeof(size) / sizeof(*size)) {
+	size[nsizes++] = strtoul (optarg, NULL, 10);
+      }
+      break;
+    case 'c':
+      if (nscnames < sizeof(scname) / sizeof(*scname)) {
+	scname[nscnames++] = optarg;
+      }
+      break;
+    case 'm':
+      mapfile = optarg;
+      break;
+    case 't':
+      tile = strtoul (optarg, NULL, 10);
+      break;
+    case 'S':
+      seed = strtoull (optarg, NULL, 10);
+      break;
+    default:
+      fprintf (stderr,
+	       "usage: %s [-s size]... [-c scenario]... [-m map.pgm] [-t tile] [-S seed]\n",
+	       argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (0 == nsizes) {
+    for (nsizes = 0; 0 != default_size[nsizes]; ++nsizes) {
+      size[nsizes] = default_size[nsizes];
+    }
+  }
+  if (NULL != mapfile) {
+    nsizes = 1;			/* the file determines the size */
+  }
+  
+  printf ("{ \"benchmark\": \"bench-estar\", \"cell_bytes\": %zu, \"tile\": %zu, \"seed\": %llu,\n"
+	  "  \"results\": [\n",
+	  sizeof(estar_cell_t), tile, (unsigned long long) seed);
+  first = 1;
+  
+  for (sc = NULL == mapfile ? synthetic : filebased; NULL != sc->name; ++sc) {
+    if (nscnames > 0) {
+      for (jj = 0; jj < nscnames && 0 != strcmp (scname[jj], sc->name); ++jj) {
+	/* nop */;
+      }
+      if (jj == nscnames) {
+	continue;
+      }
+    }
+    for (ii = 0; ii < nsizes; ++ii) {
+      printf ("%s", first ? "" : ",\n");
+      first = 0;
+      if (NULL == mapfile && ! fits (size[ii])) {
+	printf ("    { \"scenario\": \"%s\", \"dimx\": %zu, \"dimy\": %zu,"
+		" \"skipped\": \"insufficient memory\" }",
+		sc->name, size[ii], size[ii]);
+	continue;
+      }
+      fflush (stdout);
+      
+      pid = fork ();
+      if (-1 == pid) {
+	err (EXIT_FAILURE, "fork");
+      }
+      if (0 == pid) {
+	run (sc, size[ii], mapfile, seed);
+	fflush (stdout);
+	_exit (EXIT_SUCCESS);
+      }
+      if (-1 == waitpid (pid, &status, 0) || ! WIFEXITED (status)
+	  || EXIT_SUCCESS != WEXITSTATUS (status)) {
+	printf ("    { \"scenario\": \"%s\", \"dimx\": %zu, \"dimy\": %zu,"
+		" \"failed\": true }", sc->name, size[ii], size[ii]);
+      }
+    }
+  }
+  
+  printf ("\n  ]\n}\n");
+  return 0;
+}
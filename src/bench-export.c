@@ -0,0 +1,151 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Cost of estar_export_frame() next to the propagation it follows, on
+ * a square map with random speeds, 5 percent obstacles and the goal in
+ * the center. After the initial propagation and a key frame, a series
+ * of repairs each toggle a random cell between obstacle and free, and
+ * get followed by a delta frame. Reported are the times and sizes of
+ * the frames, along with the size of the raw double values.
+ *
+ * usage: bench-export [-s size] [-r resolution] [-n repairs]
+ */
+
+#include <estar2/export.h>
+
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static uint64_t rng_state;
+
+static uint32_t rng_next (void)
+{
+  rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rng_state >> 33;
+}
+
+
+static void flush (estar_t * estar)
+{
+  while (0 != estar->pq.len) {
+    estar_propagate (estar);
+  }
+}
+
+
+int main (int argc, char ** argv)
+{
+  estar_t estar;
+  estar_export_t exp;
+  size_t dim, nrepairs, ii, ix, iy, bytes;
+  double resolution, t0, tprop, texport;
+  int opt;
+  
+  dim = 1024;
+  resolution = 0.05;
+  nrepairs = 50;
+  while (-1 != (opt = getopt (argc, argv, "s:r:n:"))) {
+    switch (opt) {
+    case 's':
+      dim = strtoul (optarg, NULL, 10);
+      break;
+    case 'r':
+      resolution = strtod (optarg, NULL);
+      break;
+    case 'n':
+      nrepairs = strtoul (optarg, NULL, 10);
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-s size] [-r resolution] [-n repairs]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  
+  estar_init (&estar, dim, dim);
+  rng_state = 43;
+  for (iy = 0; iy < dim; ++iy) {
+    for (ix = 0; ix < dim; ++ix) {
+      estar_set_speed (&estar, ix, iy, rng_next () % 20 ? 0.2 + 0.8 * (rng_next () % 1000) / 1000.0 : 0.0);
+    }
+  }
+  estar_set_goal (&estar, dim / 2, dim / 2);
+  estar_export_init (&exp, dim, dim, 16, resolution);
+  
+  printf ("# %zu x %zu cells, resolution %g, raw phi %.1f MB\n",
+	  dim, dim, resolution, 8e-6 * dim * dim);
+  printf ("# %-10s  %10s  %10s  %10s\n", "frame", "propagate", "export", "bytes");
+  t0 = now ();
+  flush (&estar);
+  tprop = now () - t0;
+  t0 = now ();
+  bytes = estar_export_frame (&exp, &estar, 1);
+  texport = now () - t0;
+  printf ("  %-10s  %8.2fms  %8.2fms  %10zu\n", "key", 1e3 * tprop, 1e3 * texport, bytes);
+  
+  tprop = 0.0;
+  texport = 0.0;
+  bytes = 0;
+  for (ii = 0; ii < nrepairs; ++ii) {
+    ix = rng_next () % dim;
+    iy = rng_next () % dim;
+    t0 = now ();
+    estar_set_speed (&estar, ix, iy, estar_grid_at (&estar.grid, ix, iy)->cost > 1e9 ? 1.0 : 0.0);
+    flush (&estar);
+    tprop += now () - t0;
+    t0 = now ();
+    bytes += estar_export_frame (&exp, &estar, 0);
+    texport += now () - t0;
+  }
+  printf ("  %-10s  %8.2fms  %8.2fms  %10zu\n", "delta", 1e3 * tprop / nrepairs,
+	  1e3 * texport / nrepairs, bytes / nrepairs);
+  
+  t0 = now ();
+  bytes = estar_export_frame (&exp, &estar, 1);
+  texport = now () - t0;
+  printf ("  %-10s  %10s  %8.2fms  %10zu\n", "key", "-", 1e3 * texport, bytes);
+  
+  estar_export_fini (&exp);
+  estar_fini (&estar);
+  return 0;
+}
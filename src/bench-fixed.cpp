@@ -0,0 +1,247 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Throughput of many small independent problems, such as the local
+ * windows of a trajectory scorer: 64 x 64 cells with random speeds,
+ * 10 percent obstacles and the goal in the center, propagated until
+ * the queue is empty. The problems are solved by estar_t with a fresh
+ * estar_init() each time, by a reused estar_t with estar_reset(), by
+ * estar::Planner with a runtime layout, and by estar::Planner with the
+ * Fixed layout on the stack. Solving the same problems, the variants
+ * whose scalar matches the library (double unless it was built with
+ * ESTAR_COMPACT) must end up with the same phi as estar_t.
+ *
+ * usage: bench-fixed [-n problems]
+ */
+
+#include <estar2/planner.hpp>
+#include <estar2/estar.h>
+
+#include <unistd.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <vector>
+
+
+static size_t const dim = 64;
+static size_t const nmaps = 32;
+
+
+static double now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static std::uint64_t rng_state;
+
+static std::uint32_t rng_next ()
+{
+  rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rng_state >> 33;
+}
+
+
+static std::vector<double> speed;	// nmaps maps of dim * dim cells
+
+
+static void make_maps ()
+{
+  speed.resize (nmaps * dim * dim);
+  rng_state = 43;
+  for (double & sp : speed) {
+    if (0 == rng_next () % 10) {
+      sp = 0.0;
+    }
+    else {
+      sp = 0.2 + 0.8 * (rng_next () % 1000) / 1000.0;
+    }
+  }
+  for (size_t ii = 0; ii < nmaps; ++ii) {
+    speed[ii * dim * dim + (dim / 2) * dim + dim / 2] = 1.0;
+  }
+}
+
+
+/* Sum of the finite phi values, to compare the variants. */
+static double checksum (double phi, double sum)
+{
+  return std::isinf (phi) ? sum : sum + phi;
+}
+
+
+static void solve_c (estar_t * estar, double const * sp, double & sum)
+{
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      estar_set_speed (estar, ix, iy, sp[iy * dim + ix]);
+    }
+  }
+  estar_set_goal (estar, dim / 2, dim / 2);
+  while (0 != estar->pq.len) {
+    estar_propagate (estar);
+  }
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      sum = checksum (estar_grid_at (&estar->grid, ix, iy)->phi, sum);
+    }
+  }
+}
+
+
+template <typename Planner>
+static void solve_cxx (Planner & planner, double const * sp, double & sum)
+{
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      planner.set_speed (ix, iy, sp[iy * dim + ix]);
+    }
+  }
+  planner.set_goal (dim / 2, dim / 2);
+  planner.flush ();
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      sum = checksum (planner.at (ix, iy).phi, sum);
+    }
+  }
+}
+
+
+static void report (char const * name, size_t nproblems, double dt, double sum)
+{
+  printf ("  %-36s  %10.0f  %10.2f  %.17g\n", name, nproblems / dt, 1e6 * dt / nproblems, sum);
+  fflush (stdout);
+}
+
+
+static double run_c_init (size_t nproblems)
+{
+  estar_t estar;
+  double t0, sum;
+  
+  sum = 0.0;
+  t0 = now ();
+  for (size_t ii = 0; ii < nproblems; ++ii) {
+    estar_init (&estar, dim, dim);
+    solve_c (&estar, &speed[(ii % nmaps) * dim * dim], sum);
+    estar_fini (&estar);
+  }
+  report ("estar_init per problem", nproblems, now () - t0, sum);
+  return sum;
+}
+
+
+static double run_c_reset (size_t nproblems)
+{
+  estar_t estar;
+  double t0, sum;
+  
+  sum = 0.0;
+  estar_init (&estar, dim, dim);
+  t0 = now ();
+  for (size_t ii = 0; ii < nproblems; ++ii) {
+    estar_reset (&estar);
+    solve_c (&estar, &speed[(ii % nmaps) * dim * dim], sum);
+  }
+  report ("estar_reset per problem", nproblems, now () - t0, sum);
+  estar_fini (&estar);
+  return sum;
+}
+
+
+template <typename Planner>
+static double run_cxx (char const * name, size_t nproblems)
+{
+  double t0, sum;
+  
+  sum = 0.0;
+  t0 = now ();
+  for (size_t ii = 0; ii < nproblems; ++ii) {
+    Planner planner (dim, dim);
+    solve_cxx (planner, &speed[(ii % nmaps) * dim * dim], sum);
+  }
+  report (name, nproblems, now () - t0, sum);
+  return sum;
+}
+
+
+int main (int argc, char ** argv)
+{
+  size_t nproblems;
+  double ref;
+  bool ok, compact;
+  int opt;
+  
+  nproblems = 2000;
+  while (-1 != (opt = getopt (argc, argv, "n:"))) {
+    switch (opt) {
+    case 'n':
+      nproblems = strtoul (optarg, NULL, 10);
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-n problems]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  make_maps ();
+  compact = 0 != estar_compact_enabled ();
+  
+  printf ("# %zu problems of %zu x %zu cells\n", nproblems, dim, dim);
+  printf ("# %-36s  %10s  %10s  %s\n", "planner", "problems/s", "us/problem", "checksum");
+  ref = run_c_init (nproblems);
+  ok = ref == run_c_reset (nproblems);
+  
+  using namespace estar;
+  double const sum_rm = run_cxx<Planner<double, BinaryHeap, RowMajor> >
+    ("Planner<double,Binary,RowMajor>", nproblems);
+  double const sum_fd = run_cxx<Planner<double, BinaryHeap, Fixed<dim, dim> > >
+    ("Planner<double,Binary,Fixed<64,64>>", nproblems);
+  double const sum_ff = run_cxx<Planner<float, BinaryHeap, Fixed<dim, dim> > >
+    ("Planner<float,Binary,Fixed<64,64>>", nproblems);
+  if (compact) {
+    ok = ok && ref == sum_ff;
+  }
+  else {
+    ok = ok && ref == sum_rm && ref == sum_fd;
+  }
+  
+  if ( ! ok) {
+    printf ("FAILED: phi differs from estar_t\n");
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
@@ -0,0 +1,198 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Compare the row-major grid layout against tiled layouts on a wide
+ * map. For each layout, the same scenario gets flushed and the time
+ * as well as a few hardware counters are reported. The counters rely
+ * on perf_event_open(2), which may be unavailable (e.g. inside
+ * virtual machines or with a restrictive perf_event_paranoid), in
+ * which case they are reported as -1.
+ *
+ * usage: bench-layout [dimx [dimy [tile ...]]]
+ */
+
+#include <estar2/estar.h>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+
+typedef struct {
+  char const * name;
+  uint32_t type;
+  uint64_t config;
+  int fd;
+} counter_t;
+
+
+static counter_t counter[] = {
+  { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, -1 },
+  { "LLC-load-misses", PERF_TYPE_HW_CACHE,
+    PERF_COUNT_HW_CACHE_LL
+    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), -1 },
+  { "dTLB-load-misses", PERF_TYPE_HW_CACHE,
+    PERF_COUNT_HW_CACHE_DTLB
+    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), -1 },
+  { NULL, 0, 0, -1 }
+};
+
+
+static void counters_start (void)
+{
+  struct perf_event_attr attr;
+  counter_t * cc;
+  
+  for (cc = counter; NULL != cc->name; ++cc) {
+    memset (&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = cc->type;
+    attr.config = cc->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cc->fd = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (cc->fd >= 0) {
+      ioctl (cc->fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl (cc->fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+
+static void counters_stop (void)
+{
+  counter_t * cc;
+  long long value;
+  
+  for (cc = counter; NULL != cc->name; ++cc) {
+    value = -1;
+    if (cc->fd >= 0) {
+      ioctl (cc->fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (sizeof(value) != read (cc->fd, &value, sizeof(value))) {
+	value = -1;
+      }
+      close (cc->fd);
+      cc->fd = -1;
+    }
+    printf ("  %12lld", value);
+  }
+}
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static void run (size_t dimx, size_t dimy, size_t tile)
+{
+  estar_grid_conf_t conf;
+  estar_t estar;
+  size_t ii, npops;
+  double t0;
+  
+  estar_grid_conf_default (&conf);
+  conf.tile = tile;
+  estar_init_conf (&estar, dimx, dimy, &conf);
+  
+  // same sprinkling of obstacles for all layouts
+  srand (42);
+  for (ii = 0; ii < dimx * dimy / 50; ++ii) {
+    estar_set_speed (&estar, rand () % dimx, rand () % dimy, 0.0);
+  }
+  estar_set_goal (&estar, 0, dimy / 2);
+  
+  npops = 0;
+  t0 = now ();
+  counters_start ();
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+    ++npops;
+  }
+  counters_stop ();
+  printf ("  %10zu  %8.3f  %4zu\n", npops, now () - t0, tile);
+  
+  estar_fini (&estar);
+}
+
+
+int main (int argc, char ** argv)
+{
+  size_t dimx, dimy;
+  counter_t * cc;
+  int ii;
+  
+  dimx = 16384;
+  dimy = 512;
+  if (argc > 1) {
+    dimx = strtoul (argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    dimy = strtoul (argv[2], NULL, 10);
+  }
+  
+  printf ("# %zu x %zu cells, %zu bytes per cell\n#",
+	  dimx, dimy, sizeof(estar_cell_t));
+  for (cc = counter; NULL != cc->name; ++cc) {
+    printf ("  %12s", cc->name);
+  }
+  printf ("  %10s  %8s  %4s\n", "pops", "seconds", "tile");
+  
+  if (argc > 3) {
+    for (ii = 3; ii < argc; ++ii) {
+      printf (" ");
+      run (dimx, dimy, strtoul (argv[ii], NULL, 10));
+    }
+  }
+  else {
+    printf (" ");
+    run (dimx, dimy, 1);
+    printf (" ");
+    run (dimx, dimy, 8);
+    printf (" ");
+    run (dimx, dimy, 16);
+  }
+  
+  return 0;
+}
@@ -0,0 +1,185 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Compare estar_parallel_propagate() at several thread counts on a
+ * square map with 5 percent random obstacles and the goal in the
+ * center. For each thread count, the initial propagation and a series
+ * of repairs are timed. The repairs alternately put an obstacle right
+ * next to the goal and remove it again, which sends a raise and then
+ * a lower wave across the whole map. The resulting phi is compared
+ * against that of the first thread count. The idle column gives the
+ * fraction of rounds in which a subdomain had nothing to expand, and
+ * the line below each row the cells that each subdomain expanded.
+ *
+ * usage: bench-parallel [-s size] [-t tile] [-w window] [threads ...]
+ */
+
+#include <estar2/parallel.h>
+
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+#include <time.h>
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static uint64_t rng_state;
+
+static uint32_t rng_next (void)
+{
+  rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rng_state >> 33;
+}
+
+
+int main (int argc, char ** argv)
+{
+  static size_t const default_threads[] = { 1, 4, 16, 32 };
+  size_t const nrepairs = 4;
+  estar_grid_conf_t conf;
+  estar_parallel_t par;
+  size_t dim, nthreads, ii, jj, kk, ix, iy, npops, nrounds, nidle, ndiff;
+  double window, t0, tflush, trepair, base;
+  double * phi;
+  size_t * subpops;
+  int opt;
+  
+  dim = 1024;
+  window = 0.0;
+  estar_grid_conf_default (&conf);
+  while (-1 != (opt = getopt (argc, argv, "s:t:w:"))) {
+    switch (opt) {
+    case 's':
+      dim = strtoul (optarg, NULL, 10);
+      break;
+    case 't':
+      conf.tile = strtoul (optarg, NULL, 10);
+      break;
+    case 'w':
+      window = strtod (optarg, NULL);
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-s size] [-t tile] [-w window] [threads ...]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  phi = malloc (dim * dim * sizeof(*phi));
+  subpops = NULL;
+  if (NULL == phi) {
+    errx (EXIT_FAILURE, "malloc");
+  }
+  
+  printf ("# %zu x %zu cells, %ld cpus\n", dim, dim, sysconf (_SC_NPROCESSORS_ONLN));
+  printf ("# %7s  %7s  %10s  %10s  %10s  %8s  %6s  %7s  %8s\n",
+	  "threads", "subdom", "flush", "repair", "pops", "rounds", "idle", "speedup", "differ");
+  base = 0.0;
+  for (ii = 0; ii < (optind < argc ? (size_t) (argc - optind) : 4); ++ii) {
+    nthreads = optind < argc ? strtoul (argv[optind + ii], NULL, 10) : default_threads[ii];
+    estar_parallel_init (&par, dim, dim, nthreads, &conf);
+    if (window > 0.0) {
+      par.window = window;
+    }
+    subpops = realloc (subpops, par.nx * par.ny * sizeof(*subpops));
+    if (NULL == subpops) {
+      errx (EXIT_FAILURE, "realloc");
+    }
+    
+    rng_state = 43;
+    for (jj = 0; jj < dim * dim / 20; ++jj) {
+      estar_parallel_set_speed (&par, rng_next () % dim, rng_next () % dim, 0.0);
+    }
+    estar_parallel_set_goal (&par, dim / 2, dim / 2);
+    t0 = now ();
+    npops = estar_parallel_propagate (&par);
+    nrounds = par.nrounds;
+    tflush = now () - t0;
+    nidle = 0;
+    for (kk = 0; kk < par.nx * par.ny; ++kk) {
+      subpops[kk] = par.sub[kk].npops;
+      nidle += par.sub[kk].nidle;
+    }
+    
+    trepair = 0.0;
+    for (jj = 0; jj < 2 * nrepairs; ++jj) {
+      ix = dim / 2 + 1 + jj / 2;
+      iy = dim / 2;
+      t0 = now ();
+      estar_parallel_set_speed (&par, ix, iy, jj % 2 ? 1.0 : 0.0);
+      npops += estar_parallel_propagate (&par);
+      trepair += now () - t0;
+      nrounds += par.nrounds;
+      for (kk = 0; kk < par.nx * par.ny; ++kk) {
+	subpops[kk] += par.sub[kk].npops;
+	nidle += par.sub[kk].nidle;
+      }
+    }
+    
+    ndiff = 0;
+    for (iy = 0; iy < dim; ++iy) {
+      for (ix = 0; ix < dim; ++ix) {
+	if (0 == ii) {
+	  phi[iy * dim + ix] = estar_parallel_cell (&par, ix, iy)->phi;
+	}
+	else if (phi[iy * dim + ix] != estar_parallel_cell (&par, ix, iy)->phi) {
+	  ++ndiff;
+	}
+      }
+    }
+    if (0 == ii) {
+      base = tflush + trepair;
+    }
+    printf ("  %7zu  %3zu x %-3zu %10.3f  %10.3f  %10zu  %8zu  %5.1f%%  %7.2f  %8zu\n",
+	    nthreads, par.nx, par.ny, tflush, trepair / (2 * nrepairs), npops, nrounds,
+	    0 == nrounds ? 0.0 : 100.0 * nidle / (nrounds * par.nx * par.ny),
+	    base / (tflush + trepair), ndiff);
+    printf ("#   pops per subdomain:");
+    for (kk = 0; kk < par.nx * par.ny; ++kk) {
+      printf (" %zu", subpops[kk]);
+    }
+    printf ("\n");
+    fflush (stdout);
+    estar_parallel_fini (&par);
+  }
+  
+  free (phi);
+  free (subpops);
+  return 0;
+}
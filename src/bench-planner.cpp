@@ -0,0 +1,235 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Compare estar::Planner against estar_t on a square map with random
+ * speeds, 5 percent obstacles and the goal in the center. Each planner
+ * does the initial propagation and a series of repairs that put an
+ * obstacle next to the goal and remove it again. The times are
+ * reported along with the number of cells where phi differs from that
+ * of estar_t. For the variant whose scalar matches the library (double
+ * unless it was built with ESTAR_COMPACT) and which uses BinaryHeap,
+ * there must be no difference at all, otherwise this exits with a
+ * failure.
+ *
+ * usage: bench-planner [-s size]
+ */
+
+#include <estar2/planner.hpp>
+#include <estar2/estar.h>
+
+#include <unistd.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+
+static double now ()
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static std::uint64_t rng_state;
+
+static std::uint32_t rng_next ()
+{
+  rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rng_state >> 33;
+}
+
+
+static size_t const nrepairs = 4;
+
+
+/* The speed of every cell, in the order in which they get set. */
+static std::vector<double> make_speed (size_t dim)
+{
+  std::vector<double> speed (dim * dim);
+  rng_state = 43;
+  for (double & sp : speed) {
+    if (0 == rng_next () % 20) {
+      sp = 0.0;
+    }
+    else {
+      sp = 0.2 + 0.8 * (rng_next () % 1000) / 1000.0;
+    }
+  }
+  speed[(dim / 2) * dim + dim / 2] = 1.0;
+  return speed;
+}
+
+
+static size_t count_diff (std::vector<double> const & lhs, std::vector<double> const & rhs)
+{
+  size_t ndiff = 0;
+  for (size_t ii = 0; ii < lhs.size (); ++ii) {
+    if (lhs[ii] != rhs[ii]) {
+      ++ndiff;
+    }
+  }
+  return ndiff;
+}
+
+
+static void report (char const * name, double tflush, double trepair, size_t ndiff)
+{
+  printf ("  %-36s  %10.3f  %10.4f  %8zu\n", name, tflush, trepair / (2 * nrepairs), ndiff);
+  fflush (stdout);
+}
+
+
+static void run_c (size_t dim, std::vector<double> const & speed, std::vector<double> & phi)
+{
+  estar_t estar;
+  double t0, tflush, trepair;
+  
+  estar_init (&estar, dim, dim);
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      estar_set_speed (&estar, ix, iy, speed[iy * dim + ix]);
+    }
+  }
+  estar_set_goal (&estar, dim / 2, dim / 2);
+  t0 = now ();
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+  }
+  tflush = now () - t0;
+  
+  trepair = 0.0;
+  for (size_t jj = 0; jj < 2 * nrepairs; ++jj) {
+    t0 = now ();
+    estar_set_speed (&estar, dim / 2 + 1 + jj / 2, dim / 2, jj % 2 ? 1.0 : 0.0);
+    while (0 != estar.pq.len) {
+      estar_propagate (&estar);
+    }
+    trepair += now () - t0;
+  }
+  
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      phi[iy * dim + ix] = estar_grid_at (&estar.grid, ix, iy)->phi;
+    }
+  }
+  estar_fini (&estar);
+  report ("estar_t", tflush, trepair, 0);
+}
+
+
+template <typename Planner>
+static bool run_cxx (char const * name, bool exact, size_t dim,
+		     std::vector<double> const & speed, std::vector<double> const & ref)
+{
+  Planner planner (dim, dim);
+  std::vector<double> phi (dim * dim);
+  double t0, tflush, trepair;
+  size_t ndiff;
+  
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      planner.set_speed (ix, iy, speed[iy * dim + ix]);
+    }
+  }
+  planner.set_goal (dim / 2, dim / 2);
+  t0 = now ();
+  planner.flush ();
+  tflush = now () - t0;
+  
+  trepair = 0.0;
+  for (size_t jj = 0; jj < 2 * nrepairs; ++jj) {
+    t0 = now ();
+    planner.set_speed (dim / 2 + 1 + jj / 2, dim / 2, jj % 2 ? 1.0 : 0.0);
+    planner.flush ();
+    trepair += now () - t0;
+  }
+  
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      phi[iy * dim + ix] = planner.at (ix, iy).phi;
+    }
+  }
+  ndiff = count_diff (ref, phi);
+  report (name, tflush, trepair, ndiff);
+  
+  return ! exact || 0 == ndiff;
+}
+
+
+int main (int argc, char ** argv)
+{
+  size_t dim;
+  bool ok, compact;
+  int opt;
+  
+  dim = 1024;
+  while (-1 != (opt = getopt (argc, argv, "s:"))) {
+    switch (opt) {
+    case 's':
+      dim = strtoul (optarg, NULL, 10);
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-s size]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  
+  std::vector<double> const speed = make_speed (dim);
+  std::vector<double> ref (dim * dim);
+  compact = 0 != estar_compact_enabled ();
+  
+  printf ("# %zu x %zu cells, library built %s ESTAR_COMPACT\n",
+	  dim, dim, compact ? "with" : "without");
+  printf ("# %-36s  %10s  %10s  %8s\n", "planner", "flush", "repair", "differ");
+  run_c (dim, speed, ref);
+  
+  using namespace estar;
+  ok = run_cxx<Planner<double, BinaryHeap, RowMajor> >
+    ("Planner<double,Binary,RowMajor>", ! compact, dim, speed, ref);
+  ok = run_cxx<Planner<double, BinaryHeap, Tiled<3> > >
+    ("Planner<double,Binary,Tiled<3>>", ! compact, dim, speed, ref) && ok;
+  ok = run_cxx<Planner<double, QuaternaryHeap, RowMajor> >
+    ("Planner<double,Quaternary,RowMajor>", false, dim, speed, ref) && ok;
+  ok = run_cxx<Planner<float, BinaryHeap, RowMajor> >
+    ("Planner<float,Binary,RowMajor>", compact, dim, speed, ref) && ok;
+  ok = run_cxx<Planner<float, BinaryHeap, Tiled<3> > >
+    ("Planner<float,Binary,Tiled<3>>", compact, dim, speed, ref) && ok;
+  
+  if ( ! ok) {
+    printf ("FAILED: phi differs from estar_t\n");
+    return EXIT_FAILURE;
+  }
+  return 0;
+}
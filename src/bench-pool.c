@@ -0,0 +1,282 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Latency of estar_pool_t under a stream of requests: mostly short
+ * ones on 32 x 32 crops, and every tenth a long one on a 256 x 256
+ * map. The requests arrive at a fixed rate, and for each budget (the
+ * number of expansions per slice, 0 meaning unlimited), the median
+ * and 99th percentile latency are reported over all requests and
+ * over the short ones. For comparison, the first line shows what it
+ * costs to do estar_init() and estar_fini() for each request in a
+ * single thread, without queueing.
+ *
+ * usage: bench-pool [-t threads] [-r rate] [-n requests] [budget ...]
+ */
+
+#include <estar2/pool.h>
+
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <time.h>
+
+
+#define NMAPS 8
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static uint64_t rng_state;
+
+static uint32_t rng_next (void)
+{
+  rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return rng_state >> 33;
+}
+
+
+typedef struct {
+  estar_job_t job;
+  float const * speed;
+  double latency;
+} request_t;
+
+
+static float * short_map[NMAPS];
+static float * long_map[NMAPS];
+
+
+static float * make_map (size_t dim)
+{
+  float * speed;
+  size_t ii;
+  
+  speed = malloc (dim * dim * sizeof(*speed));
+  if (NULL == speed) {
+    errx (EXIT_FAILURE, "malloc");
+  }
+  for (ii = 0; ii < dim * dim; ++ii) {
+    speed[ii] = rng_next () % 10 ? 0.2f + 0.8f * (rng_next () % 1000) / 1000.0f : 0.0f;
+  }
+  speed[(dim / 2) * dim + dim / 2] = 1.0f;
+  return speed;
+}
+
+
+static void setup (estar_t * estar, void * data)
+{
+  request_t * rq = data;
+  estar_set_speed_bulk (estar, rq->speed, rq->job.dimx);
+  estar_set_goal (estar, rq->job.dimx / 2, rq->job.dimy / 2);
+}
+
+
+static void done (estar_t * estar, void * data)
+{
+  request_t * rq = data;
+  rq->latency = now () - rq->job.submitted;
+}
+
+
+static void make_requests (request_t * rq, size_t nrequests)
+{
+  size_t ii;
+  
+  memset (rq, 0, nrequests * sizeof(*rq));
+  for (ii = 0; ii < nrequests; ++ii) {
+    if (0 == ii % 10) {
+      rq[ii].job.dimx = rq[ii].job.dimy = 256;
+      rq[ii].speed = long_map[ii % NMAPS];
+    }
+    else {
+      rq[ii].job.dimx = rq[ii].job.dimy = 32;
+      rq[ii].speed = short_map[ii % NMAPS];
+    }
+    rq[ii].job.setup = setup;
+    rq[ii].job.done = done;
+    rq[ii].job.data = &rq[ii];
+  }
+}
+
+
+static int compare_double (void const * lhs, void const * rhs)
+{
+  double const aa = *(double const *) lhs;
+  double const bb = *(double const *) rhs;
+  return aa < bb ? -1 : aa > bb;
+}
+
+
+/* Median and 99th percentile of the short requests. */
+static void short_latency (request_t const * rq, size_t nrequests, double * p50, double * p99)
+{
+  double * sample;
+  size_t ii, nn;
+  
+  sample = malloc (nrequests * sizeof(*sample));
+  if (NULL == sample) {
+    errx (EXIT_FAILURE, "malloc");
+  }
+  nn = 0;
+  for (ii = 0; ii < nrequests; ++ii) {
+    if (32 == rq[ii].job.dimx) {
+      sample[nn++] = rq[ii].latency;
+    }
+  }
+  qsort (sample, nn, sizeof(*sample), compare_double);
+  *p50 = sample[(nn - 1) / 2];
+  *p99 = sample[(99 * (nn - 1)) / 100];
+  free (sample);
+}
+
+
+/* The same work, done one request after the other without a pool. */
+static void run_plain (request_t * rq, size_t nrequests)
+{
+  estar_t estar;
+  size_t ii;
+  double t0, t1, p50, p99;
+  
+  t0 = now ();
+  for (ii = 0; ii < nrequests; ++ii) {
+    t1 = now ();
+    estar_init (&estar, rq[ii].job.dimx, rq[ii].job.dimy);
+    setup (&estar, &rq[ii]);
+    while (0 != estar.pq.len) {
+      estar_propagate (&estar);
+    }
+    estar_fini (&estar);
+    rq[ii].latency = now () - t1;
+  }
+  short_latency (rq, nrequests, &p50, &p99);
+  printf ("  %8s  %9.0f  %9s  %9s  %9.2f  %9.2f  %9s\n",
+	  "plain", nrequests / (now () - t0), "-", "-", 1e3 * p50, 1e3 * p99, "-");
+}
+
+
+static void run_pool (request_t * rq, size_t nrequests, size_t nthreads,
+		      double rate, size_t budget)
+{
+  estar_pool_t pool;
+  size_t ii;
+  double t0, wake, p50, p99, sp50, sp99;
+  struct timespec ts;
+  
+  estar_pool_init (&pool, nthreads, NULL);
+  pool.budget = 0 == budget ? (size_t) -1 : budget;
+  t0 = now ();
+  for (ii = 0; ii < nrequests; ++ii) {
+    wake = t0 + ii / rate - now ();
+    if (wake > 0.0) {
+      ts.tv_sec = wake;
+      ts.tv_nsec = 1e9 * (wake - ts.tv_sec);
+      nanosleep (&ts, NULL);
+    }
+    estar_pool_submit (&pool, &rq[ii].job);
+  }
+  estar_pool_wait (&pool);
+  
+  estar_pool_latency (&pool, &p50, &p99);
+  short_latency (rq, nrequests, &sp50, &sp99);
+  printf ("  %8zu  %9.0f  %9.2f  %9.2f  %9.2f  %9.2f  %9zu\n",
+	  budget, nrequests / (now () - t0), 1e3 * p50, 1e3 * p99,
+	  1e3 * sp50, 1e3 * sp99, pool.ninstances);
+  fflush (stdout);
+  estar_pool_fini (&pool);
+}
+
+
+int main (int argc, char ** argv)
+{
+  static size_t const default_budget[] = { 0, 4096, 1024, 256 };
+  size_t nthreads, nrequests, ii;
+  request_t * rq;
+  double rate;
+  int opt;
+  
+  nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+  nrequests = 1000;
+  rate = 100.0;
+  while (-1 != (opt = getopt (argc, argv, "t:r:n:"))) {
+    switch (opt) {
+    case 't':
+      nthreads = strtoul (optarg, NULL, 10);
+      break;
+    case 'r':
+      rate = strtod (optarg, NULL);
+      break;
+    case 'n':
+      nrequests = strtoul (optarg, NULL, 10);
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-t threads] [-r rate] [-n requests] [budget ...]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  
+  rng_state = 43;
+  for (ii = 0; ii < NMAPS; ++ii) {
+    short_map[ii] = make_map (32);
+    long_map[ii] = make_map (256);
+  }
+  rq = malloc (nrequests * sizeof(*rq));
+  if (NULL == rq) {
+    errx (EXIT_FAILURE, "malloc");
+  }
+  
+  printf ("# %zu requests at %g/s, %zu threads, latencies in ms\n", nrequests, rate, nthreads);
+  printf ("# %8s  %9s  %9s  %9s  %9s  %9s  %9s\n",
+	  "budget", "req/s", "p50", "p99", "short p50", "short p99", "planners");
+  make_requests (rq, nrequests);
+  run_plain (rq, nrequests);
+  for (ii = 0; ii < (optind < argc ? (size_t) (argc - optind) : 4); ++ii) {
+    make_requests (rq, nrequests);
+    run_pool (rq, nrequests, nthreads, rate,
+	      optind < argc ? strtoul (argv[optind + ii], NULL, 10) : default_budget[ii]);
+  }
+  
+  for (ii = 0; ii < NMAPS; ++ii) {
+    free (short_map[ii]);
+    free (long_map[ii]);
+  }
+  free (rq);
+  return 0;
+}
@@ -34,12 +34,35 @@
 #include <math.h>
 
 
+/* Neighbors used to be told apart by their offset in memory, which
+   only works for row-major grids. The propagator pairs always list the
+   east or west neighbor first, though, and whatever the layout a
+   neighbor to the east or north is stored at a higher address. */
+static int is_xnbor (estar_cell_t * cell, estar_cell_t * nbor)
+{
+  estar_cell_t * buf[9];
+  estar_cell_t ** prop;
+  
+  prop = estar_cell_prop (cell, buf);
+  if (NULL == prop[0]) {
+    return 1;			/* grid is one cell wide or high */
+  }
+  for (; NULL != *prop; prop += 2) {
+    if (nbor == *prop) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
 int estar_cell_calc_gradient (estar_cell_t * cell, double * gx, double * gy)
 {
   estar_cell_t ** nn;
   estar_cell_t * n1;
   estar_cell_t * n2;
-  int direction;
+  int x1;
+  double g1, g2;
   
   n1 = NULL;
   for (nn = cell->nbor; *nn != NULL; ++nn) {
@@ -53,78 +76,40 @@ int estar_cell_calc_gradient (estar_cell_t * cell, double * gx, double * gy)
     return 0;
   }
   
-  direction = n1 - cell;
-  // +1 means right
-  // -1 means left
-  // +dimx means up (grid is arranged like pixels on a screen)
-  // -dimx means down
+  // the gradient component points towards n1 (east and north are
+  // positive, grid is arranged like pixels on a screen)
+  x1 = is_xnbor (cell, n1);
+  g1 = n1 > cell ? cell->rhs - n1->rhs : n1->rhs - cell->rhs;
   
+  // the other component comes from the best neighbor on the other
+  // axis (n1 and the neighbor opposite of it are on the same axis)
   n2 = NULL;
   for (nn = cell->nbor; *nn != NULL; ++nn) {
     if (isfinite ((*nn)->rhs)
-	&& (*nn) != n1
-	&& direction != cell - *nn /* check it is not opposite n1 */
+	&& is_xnbor (cell, *nn) != x1
 	&& (n2 == NULL || (*nn)->rhs < n2->rhs)) {
       n2 = *nn;
     }
   }
-
+  
   if (NULL == n2) {
-    if (direction == -1) {
-      *gx = n1->rhs - cell->rhs; /* some negative value */
-      *gy = 0.0;
-    }
-    else if (direction == 1) {
-      *gx = cell->rhs - n1->rhs; /* some positive value */
-      *gy = 0.0;
-    }
-    else if (direction < 0) {
-      *gx = 0.0;
-      *gy = n1->rhs - cell->rhs; /* some negative value */
-    }
-    else {
-      *gx = 0.0;
-      *gy = cell->rhs - n1->rhs; /* some positive value */
-    }
-    return 1;
+    g2 = 0.0;
   }
-  
-  if (direction == -1) {
-    *gx = n1->rhs - cell->rhs;
-    if (cell - n2 > 0) {
-      *gy = n2->rhs - cell->rhs;
-    }
-    else {
-      *gy = cell->rhs - n2->rhs;
-    }
+  else if (n2 > cell) {
+    g2 = cell->rhs - n2->rhs;
   }
-  else if (direction == 1) {
-    *gx = cell->rhs - n1->rhs;
-    if (cell - n2 > 0) {
-      *gy = n2->rhs - cell->rhs;
-    }
-    else {
-      *gy = cell->rhs - n2->rhs;
-    }
+  else {
+    g2 = n2->rhs - cell->rhs;
   }
-  else if (direction < 0) {
-    if (cell - n2 > 0) {
-      *gx = n2->rhs - cell->rhs;
-    }
-    else {
-      *gx = cell->rhs - n2->rhs;
-    }
-    *gy = n1->rhs - cell->rhs;
+  
+  if (x1) {
+    *gx = g1;
+    *gy = g2;
   }
   else {
-    if (cell - n2 > 0) {
-      *gx = n2->rhs - cell->rhs;
-    }
-    else {
-      *gx = cell->rhs - n2->rhs;
-    }
-    *gy = cell->rhs - n1->rhs;
+    *gx = g2;
+    *gy = g1;
   }
   
-  return 2;
+  return NULL == n2 ? 1 : 2;
 }
@@ -0,0 +1,461 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Headless planner for batch jobs: load a map, set goals, flush, and
+ * write the result.
+ *
+ * The map is either an 8-bit binary PGM file (the pixel value divided
+ * by the maximum value gives the speed, so black is an obstacle and
+ * white is free space) or, with -r WxH, a headerless file of W*H
+ * bytes. With -R, the bytes are occupancy values as in ROS occupancy
+ * grids: 0 is free, 100 is occupied, the speed drops linearly in
+ * between, and anything else (unknown) is an obstacle. Speeds below
+ * the threshold given with -T become obstacles. The file is mapped
+ * into memory and converted a row at a time.
+ *
+ * Coordinates have x pointing right and y pointing up, so the last
+ * row of the file is y = 0. Outputs are written in the row order of
+ * the input, so they can be overlaid on it:
+ *   -o file   phi as raw native-endian float32, infinity for
+ *             unreachable cells and obstacles
+ *   -O file   phi as 8-bit PGM, black at the goals, white for
+ *             infinity, linear in between
+ *   -p file   path from the start cell (-s) to the goal as CSV
+ * The time spent in each stage is printed to stderr.
+ *
+ * usage: estar-cli [-r WxH] [-R] [-T threshold] [-t tile] -g x,y [-g x,y]...
+ *                  [-s x,y] [-o phi.raw] [-O phi.pgm] [-p path.csv] map
+ */
+
+#include <estar2/estar.h>
+#include <estar2/path.h>
+#include <estar2/query.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+#include <math.h>
+#include <time.h>
+
+
+typedef struct {
+  unsigned char const * pixel;	/* first pixel of the top row */
+  size_t dimx, dimy;
+  unsigned maxval;
+} image_t;
+
+
+static double tlast;
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static void stage (char const * name)
+{
+  double tt = now ();
+  fprintf (stderr, "%-10s %10.6f s\n", name, tt - tlast);
+  tlast = tt;
+}
+
+
+static unsigned char const * parse_number (unsigned char const * cc,
+					   unsigned char const * end, size_t * value)
+{
+  // skip whitespace and comments
+  while (cc < end) {
+    if ('#' == *cc) {
+      while (cc < end && '\n' != *cc) {
+	++cc;
+      }
+    }
+    else if (' ' == *cc || '\t' == *cc || '\r' == *cc || '\n' == *cc) {
+      ++cc;
+    }
+    else {
+      break;
+    }
+  }
+  if (cc >= end || *cc < '0' || *cc > '9') {
+    return NULL;
+  }
+  for (*value = 0; cc < end && *cc >= '0' && *cc <= '9'; ++cc) {
+    *value = *value * 10 + *cc - '0';
+  }
+  return cc;
+}
+
+
+static void map_image (image_t * img, char const * fname, size_t rawx, size_t rawy)
+{
+  struct stat st;
+  unsigned char const * data;
+  unsigned char const * cc;
+  size_t maxval;
+  int fd;
+  
+  fd = open (fname, O_RDONLY);
+  if (-1 == fd || -1 == fstat (fd, &st)) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == data) {
+    err (EXIT_FAILURE, "%s: mmap", fname);
+  }
+  close (fd);
+  madvise ((void*) data, st.st_size, MADV_SEQUENTIAL);
+  
+  if (0 != rawx) {
+    img->pixel = data;
+    img->dimx = rawx;
+    img->dimy = rawy;
+    img->maxval = 255;
+  }
+  else {
+    cc = data + 2;
+    if (st.st_size < 2 || 'P' != data[0] || '5' != data[1]
+	|| NULL == (cc = parse_number (cc, data + st.st_size, &img->dimx))
+	|| NULL == (cc = parse_number (cc, data + st.st_size, &img->dimy))
+	|| NULL == (cc = parse_number (cc, data + st.st_size, &maxval))
+	|| 0 == maxval || maxval > 255) {
+      errx (EXIT_FAILURE, "%s: not an 8-bit binary PGM file", fname);
+    }
+    img->pixel = cc + 1;	/* single whitespace after maxval */
+    img->maxval = maxval;
+  }
+  
+  if (0 == img->dimx || 0 == img->dimy
+      || (size_t) (img->pixel - data) + img->dimx * img->dimy > (size_t) st.st_size) {
+    errx (EXIT_FAILURE, "%s: file too short for %zu x %zu pixels",
+	  fname, img->dimx, img->dimy);
+  }
+}
+
+
+/* Both conversions are written as plain loops over a row without
+   branches, so that the compiler can vectorize them. */
+static void convert_intensity (float * speed, unsigned char const * pixel, size_t len,
+			       float scale, float threshold)
+{
+  size_t ii;
+  float ss;
+  for (ii = 0; ii < len; ++ii) {
+    ss = pixel[ii] * scale;
+    speed[ii] = ss < threshold ? 0.0f : ss;
+  }
+}
+
+
+static void convert_occupancy (float * speed, unsigned char const * pixel, size_t len,
+			       float threshold)
+{
+  size_t ii;
+  float ss;
+  for (ii = 0; ii < len; ++ii) {
+    ss = 1.0f - pixel[ii] * 0.01f;
+    speed[ii] = pixel[ii] > 100 || ss < threshold ? 0.0f : ss;
+  }
+}
+
+
+static int parse_xy (char const * arg, size_t * xx, size_t * yy)
+{
+  char * end;
+  *xx = strtoul (arg, &end, 10);
+  if (',' != *end && 'x' != *end) {
+    return -1;
+  }
+  *yy = strtoul (end + 1, &end, 10);
+  return '\0' == *end ? 0 : -1;
+}
+
+
+static void write_phi_raw (estar_t * estar, char const * fname)
+{
+  size_t ix, iy;
+  float * row;
+  FILE * fp;
+  
+  fp = fopen (fname, "wb");
+  row = malloc (sizeof(float) * estar->grid.dimx);
+  if (NULL == fp || NULL == row) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  for (iy = estar->grid.dimy; iy > 0; --iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      row[ix] = estar_grid_at (&estar->grid, ix, iy - 1)->phi;
+    }
+    if (estar->grid.dimx != fwrite (row, sizeof(float), estar->grid.dimx, fp)) {
+      err (EXIT_FAILURE, "%s", fname);
+    }
+  }
+  if (0 != fclose (fp)) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  free (row);
+}
+
+
+static void write_phi_pgm (estar_t * estar, char const * fname)
+{
+  size_t ix, iy;
+  unsigned char * row;
+  double phi, phimax;
+  FILE * fp;
+  
+  phimax = 0.0;
+  for (iy = 0; iy < estar->grid.dimy; ++iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      phi = estar_grid_at (&estar->grid, ix, iy)->phi;
+      if (isfinite (phi) && phi > phimax) {
+	phimax = phi;
+      }
+    }
+  }
+  if (0.0 == phimax) {
+    phimax = 1.0;
+  }
+  
+  fp = fopen (fname, "wb");
+  row = malloc (estar->grid.dimx);
+  if (NULL == fp || NULL == row) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  fprintf (fp, "P5\n# phi, maximum finite value %g\n%zu %zu\n255\n",
+	   phimax, estar->grid.dimx, estar->grid.dimy);
+  for (iy = estar->grid.dimy; iy > 0; --iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      phi = estar_grid_at (&estar->grid, ix, iy - 1)->phi;
+      row[ix] = isfinite (phi) ? (unsigned char) (254.0 * phi / phimax) : 255;
+    }
+    if (estar->grid.dimx != fwrite (row, 1, estar->grid.dimx, fp)) {
+      err (EXIT_FAILURE, "%s", fname);
+    }
+  }
+  if (0 != fclose (fp)) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  free (row);
+}
+
+
+static void write_path (estar_t * estar, size_t sx, size_t sy, char const * fname)
+{
+  size_t const maxpoints = 16 * (estar->grid.dimx + estar->grid.dimy);
+  double * xy;
+  double * phi;
+  size_t ii, npoints;
+  int status;
+  FILE * fp;
+  
+  xy = malloc (2 * maxpoints * sizeof(*xy));
+  phi = malloc (maxpoints * sizeof(*phi));
+  if (NULL == xy || NULL == phi) {
+    errx (EXIT_FAILURE, "%s: out of memory", __func__);
+  }
+  status = estar_trace_path (&estar->grid, sx, sy, xy, maxpoints, &npoints);
+  estar_query (&estar->grid, npoints, xy, phi, NULL);
+  
+  fp = fopen (fname, "w");
+  if (NULL == fp) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  fprintf (fp, "x,y,phi\n");
+  for (ii = 0; ii < npoints; ++ii) {
+    fprintf (fp, "%g,%g,%g\n", xy[2 * ii], xy[2 * ii + 1], phi[ii]);
+  }
+  if (ESTAR_PATH_GOAL != status) {
+    warnx ("%s: path does not reach a goal", fname);
+  }
+  
+  if (0 != fclose (fp)) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  free (xy);
+  free (phi);
+}
+
+
+static void usage (char const * name)
+{
+  fprintf (stderr,
+	   "usage: %s [-r WxH] [-R] [-T threshold] [-t tile] -g x,y [-g x,y]...\n"
+	   "       [-s x,y] [-o phi.raw] [-O phi.pgm] [-p path.csv] map\n",
+	   name);
+  exit (EXIT_FAILURE);
+}
+
+
+int main (int argc, char ** argv)
+{
+  estar_grid_conf_t conf;
+  estar_t estar;
+  image_t img;
+  float * speed;
+  size_t goal[64][2], ngoals, rawx, rawy, sx, sy, iy, ii, npops;
+  char const * raw_out;
+  char const * pgm_out;
+  char const * path_out;
+  float threshold;
+  int opt, occupancy, have_start;
+  
+  estar_grid_conf_default (&conf);
+  ngoals = 0;
+  rawx = 0;
+  rawy = 0;
+  sx = 0;
+  sy = 0;
+  have_start = 0;
+  occupancy = 0;
+  threshold = 0.0f;
+  raw_out = NULL;
+  pgm_out = NULL;
+  path_out = NULL;
+  while (-1 != (opt = getopt (argc, argv, "r:RT:t:g:s:o:O:p:"))) {
+    switch (opt) {
+    case 'r':
+      if (0 != parse_xy (optarg, &rawx, &rawy)) {
+	usage (argv[0]);
+      }
+      break;
+    case 'R':
+      occupancy = 1;
+      break;
+    case 'T':
+      threshold = strtof (optarg, NULL);
+      break;
+    case 't':
+      conf.tile = strtoul (optarg, NULL, 10);
+      break;
+    case 'g':
+      if (ngoals >= sizeof(goal) / sizeof(*goal)
+	  || 0 != parse_xy (optarg, &goal[ngoals][0], &goal[ngoals][1])) {
+	usage (argv[0]);
+      }
+      ++ngoals;
+      break;
+    case 's':
+      if (0 != parse_xy (optarg, &sx, &sy)) {
+	usage (argv[0]);
+      }
+      have_start = 1;
+      break;
+    case 'o':
+      raw_out = optarg;
+      break;
+    case 'O':
+      pgm_out = optarg;
+      break;
+    case 'p':
+      path_out = optarg;
+      break;
+    default:
+      usage (argv[0]);
+    }
+  }
+  if (optind + 1 != argc || 0 == ngoals || (NULL != path_out && ! have_start)) {
+    usage (argv[0]);
+  }
+  
+  tlast = now ();
+  map_image (&img, argv[optind], rawx, rawy);
+  stage ("map");
+  
+  for (ii = 0; ii < ngoals; ++ii) {
+    if (goal[ii][0] >= img.dimx || goal[ii][1] >= img.dimy) {
+      errx (EXIT_FAILURE, "goal %zu,%zu outside of %zu x %zu map",
+	    goal[ii][0], goal[ii][1], img.dimx, img.dimy);
+    }
+  }
+  if (have_start && (sx >= img.dimx || sy >= img.dimy)) {
+    errx (EXIT_FAILURE, "start %zu,%zu outside of %zu x %zu map", sx, sy, img.dimx, img.dimy);
+  }
+  
+  speed = malloc (sizeof(float) * img.dimx * img.dimy);
+  if (NULL == speed) {
+    err (EXIT_FAILURE, "malloc");
+  }
+  for (iy = 0; iy < img.dimy; ++iy) {
+    if (occupancy) {
+      convert_occupancy (speed + iy * img.dimx,
+			 img.pixel + (img.dimy - 1 - iy) * img.dimx, img.dimx, threshold);
+    }
+    else {
+      convert_intensity (speed + iy * img.dimx,
+			 img.pixel + (img.dimy - 1 - iy) * img.dimx, img.dimx,
+			 1.0f / img.maxval, threshold);
+    }
+  }
+  stage ("convert");
+  
+  estar_init_conf (&estar, img.dimx, img.dimy, &conf);
+  stage ("init");
+  
+  estar_set_speed_bulk (&estar, speed, img.dimx);
+  free (speed);
+  stage ("speed");
+  
+  for (ii = 0; ii < ngoals; ++ii) {
+    estar_set_goal (&estar, goal[ii][0], goal[ii][1]);
+  }
+  for (npops = 0; 0 != estar.pq.len; ++npops) {
+    estar_propagate (&estar);
+  }
+  stage ("flush");
+  fprintf (stderr, "%-10s %10zu\n", "pops", npops);
+  
+  if (NULL != raw_out) {
+    write_phi_raw (&estar, raw_out);
+    stage ("phi-raw");
+  }
+  if (NULL != pgm_out) {
+    write_phi_pgm (&estar, pgm_out);
+    stage ("phi-pgm");
+  }
+  if (NULL != path_out) {
+    write_path (&estar, sx, sy, path_out);
+    stage ("path");
+  }
+  
+  estar_fini (&estar);
+  return 0;
+}
@@ -0,0 +1,321 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Replay a log written by estar_record_start() at full speed, and
+ * report the time spent on each epoch. An epoch is a batch of calls
+ * that change the planner (goals, speeds, resets, focus), followed by
+ * the estar_propagate() calls that came after them. With -c, the phi
+ * of all cells is compared to each snapshot taken with
+ * estar_record_phi(), and the exit status is non-zero on mismatch.
+ * With -q, only the summary is printed. The tile size of the grid
+ * layout can be overridden with -t.
+ *
+ * usage: estar-replay [-c] [-q] [-t tile] log
+ */
+
+#include <estar2/estar.h>
+
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+#include <math.h>
+#include <time.h>
+
+
+static FILE * fp;
+static char const * fname;
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+static uint64_t get_le (size_t nbytes)
+{
+  unsigned char buf[8];
+  uint64_t value;
+  size_t ii;
+  
+  if (nbytes != fread (buf, 1, nbytes, fp)) {
+    errx (EXIT_FAILURE, "%s: unexpected end of file", fname);
+  }
+  for (value = 0, ii = nbytes; ii > 0; --ii) {
+    value = (value << 8) | buf[ii - 1];
+  }
+  return value;
+}
+
+
+static double get_f64 (void)
+{
+  uint64_t bits;
+  double value;
+  bits = get_le (8);
+  memcpy (&value, &bits, sizeof(value));
+  return value;
+}
+
+
+typedef struct {
+  size_t id;
+  size_t nchanges;
+  uint64_t npops;
+  double seconds;
+} epoch_t;
+
+
+static void report (epoch_t const * ep, int quiet, epoch_t * total)
+{
+  if (0 == ep->nchanges && 0 == ep->npops) {
+    return;
+  }
+  if ( ! quiet) {
+    printf ("%8zu  %8zu  %12llu  %12.6f\n",
+	    ep->id, ep->nchanges, (unsigned long long) ep->npops, ep->seconds);
+  }
+  ++total->id;
+  total->nchanges += ep->nchanges;
+  total->npops += ep->npops;
+  total->seconds += ep->seconds;
+}
+
+
+/* The cell of a record, which has to lie on the grid of the log. */
+static void get_coords (estar_t const * estar, size_t * ix, size_t * iy)
+{
+  *ix = get_le (4);
+  *iy = get_le (4);
+  if (*ix >= estar->grid.dimx || *iy >= estar->grid.dimy) {
+    errx (EXIT_FAILURE, "%s: cell %zu %zu lies outside the grid", fname, *ix, *iy);
+  }
+}
+
+
+int main (int argc, char ** argv)
+{
+  estar_grid_conf_t conf;
+  estar_t estar;
+  epoch_t epoch, total;
+  char magic[8];
+  unsigned char * roi;
+  int opt, check, quiet, op, in_propagation, mismatch;
+  size_t ix, iy, ii, nepochs, tile;
+  uint64_t count, jj;
+  double speed, phi, t0, maxdiff;
+  
+  check = 0;
+  quiet = 0;
+  tile = 0;
+  while (-1 != (opt = getopt (argc, argv, "cqt:"))) {
+    switch (opt) {
+    case 'c':
+      check = 1;
+      break;
+    case 'q':
+      quiet = 1;
+      break;
+    case 't':
+      tile = strtoul (optarg, NULL, 10);
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-c] [-q] [-t tile] log\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind + 1 != argc) {
+    fprintf (stderr, "usage: %s [-c] [-q] [-t tile] log\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  fname = argv[optind];
+  fp = fopen (fname, "rb");
+  if (NULL == fp) {
+    err (EXIT_FAILURE, "%s", fname);
+  }
+  
+  if (8 != fread (magic, 1, 8, fp) || 0 != memcmp (magic, "ESTARLOG", 8)) {
+    errx (EXIT_FAILURE, "%s: not an estar log", fname);
+  }
+  if (ESTAR_RECORD_VERSION != get_le (4)) {
+    errx (EXIT_FAILURE, "%s: unsupported log version", fname);
+  }
+  estar_grid_conf_default (&conf);
+  conf.tile = get_le (4);
+  if (0 != tile) {
+    conf.tile = tile;
+  }
+  ix = get_le (8);
+  iy = get_le (8);
+  estar_init_conf (&estar, ix, iy, &conf);
+  roi = malloc (ix * iy);
+  if (NULL == roi) {
+    errx (EXIT_FAILURE, "%s: malloc", fname);
+  }
+  if ( ! quiet) {
+    printf ("# %zu x %zu cells, tile %zu\n", ix, iy, conf.tile);
+    printf ("# %6s  %8s  %12s  %12s\n", "epoch", "changes", "pops", "seconds");
+  }
+  
+  memset (&epoch, 0, sizeof(epoch));
+  memset (&total, 0, sizeof(total));
+  nepochs = 0;
+  in_propagation = 0;
+  mismatch = 0;
+  
+  for (op = fgetc (fp); EOF != op && ESTAR_RECORD_END != op; op = fgetc (fp)) {
+    if (ESTAR_RECORD_PROPAGATE != op && ESTAR_RECORD_PHI != op && in_propagation) {
+      report (&epoch, quiet, &total);
+      memset (&epoch, 0, sizeof(epoch));
+      in_propagation = 0;
+    }
+    if (0 == epoch.id) {
+      epoch.id = ++nepochs;
+    }
+    
+    switch (op) {
+    case ESTAR_RECORD_GOAL:
+      get_coords (&estar, &ix, &iy);
+      t0 = now ();
+      estar_set_goal (&estar, ix, iy);
+      epoch.seconds += now () - t0;
+      ++epoch.nchanges;
+      break;
+    case ESTAR_RECORD_SPEED:
+      get_coords (&estar, &ix, &iy);
+      speed = get_f64 ();
+      t0 = now ();
+      estar_set_speed (&estar, ix, iy, speed);
+      epoch.seconds += now () - t0;
+      ++epoch.nchanges;
+      break;
+    case ESTAR_RECORD_COST:
+      get_coords (&estar, &ix, &iy);
+      speed = get_f64 ();
+      t0 = now ();
+      estar_set_cost (&estar, ix, iy, speed);
+      epoch.seconds += now () - t0;
+      ++epoch.nchanges;
+      break;
+    case ESTAR_RECORD_PROPAGATE:
+      count = get_le (8);
+      t0 = now ();
+      for (jj = 0; jj < count; ++jj) {
+	estar_propagate (&estar);
+      }
+      epoch.seconds += now () - t0;
+      epoch.npops += count;
+      in_propagation = 1;
+      break;
+    case ESTAR_RECORD_RESET:
+      t0 = now ();
+      estar_reset (&estar);
+      epoch.seconds += now () - t0;
+      ++epoch.nchanges;
+      break;
+    case ESTAR_RECORD_FOCUS:
+      get_coords (&estar, &ix, &iy);
+      t0 = now ();
+      estar_set_focus (&estar, ix, iy);
+      epoch.seconds += now () - t0;
+      ++epoch.nchanges;
+      break;
+    case ESTAR_RECORD_CLEAR_FOCUS:
+      t0 = now ();
+      estar_clear_focus (&estar);
+      epoch.seconds += now () - t0;
+      ++epoch.nchanges;
+      break;
+    case ESTAR_RECORD_ROI:
+      count = get_le (8);
+      if (count != estar.grid.dimx * estar.grid.dimy) {
+	errx (EXIT_FAILURE, "%s: region of interest of wrong size", fname);
+      }
+      if (count != fread (roi, 1, count, fp)) {
+	errx (EXIT_FAILURE, "%s: unexpected end of file", fname);
+      }
+      t0 = now ();
+      estar_set_roi (&estar, roi, estar.grid.dimx);
+      epoch.seconds += now () - t0;
+      ++epoch.nchanges;
+      break;
+    case ESTAR_RECORD_PHI:
+      count = get_le (8);
+      if (count != estar.grid.dimx * estar.grid.dimy) {
+	errx (EXIT_FAILURE, "%s: phi snapshot of wrong size", fname);
+      }
+      maxdiff = 0.0;
+      for (ii = 0, iy = 0; iy < estar.grid.dimy; ++iy) {
+	for (ix = 0; ix < estar.grid.dimx; ++ix) {
+	  phi = get_f64 ();
+	  if ( ! check) {
+	    continue;
+	  }
+	  if (phi != estar_grid_at (&estar.grid, ix, iy)->phi
+	      && ! (isnan (phi) && isnan (estar_grid_at (&estar.grid, ix, iy)->phi))) {
+	    ++ii;
+	    if (fabs (phi - estar_grid_at (&estar.grid, ix, iy)->phi) > maxdiff) {
+	      maxdiff = fabs (phi - estar_grid_at (&estar.grid, ix, iy)->phi);
+	    }
+	  }
+	}
+      }
+      if (check) {
+	printf ("# phi check: %zu of %llu cells differ, max difference %g\n",
+		ii, (unsigned long long) count, maxdiff);
+	if (0 != ii) {
+	  mismatch = 1;
+	}
+      }
+      break;
+    default:
+      errx (EXIT_FAILURE, "%s: invalid opcode %d", fname, op);
+    }
+  }
+  if (EOF == op) {
+    warnx ("%s: log ends without end marker", fname);
+  }
+  report (&epoch, quiet, &total);
+  
+  printf ("# %zu epochs  %zu changes  %llu pops  %.6f seconds  %.1f pops/sec\n",
+	  total.id, total.nchanges, (unsigned long long) total.npops,
+	  total.seconds, total.npops / total.seconds);
+  
+  free (roi);
+  estar_fini (&estar);
+  fclose (fp);
+  return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -33,16 +33,46 @@
 #include <estar2/estar.h>
 
 #include <math.h>
+#include <float.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <err.h>
 
 
-static double interpolate (double cost, double primary, double secondary)
+/* Number of speeds that estar_set_speed_frame() compares at once, and
+   the number of changed cells it collects before updating them. */
+#define FRAME_CHUNK 64
+#define FRAME_BATCH 256
+
+
+/* Relative slack of estar_check() when it recomputes rhs, which has to
+   cover the rounding of the stored values to estar_real_t. */
+#ifdef ESTAR_COMPACT
+# define CHECK_TOLERANCE (16 * FLT_EPSILON)
+#else
+# define CHECK_TOLERANCE 1e-9
+#endif
+
+
+#ifdef ESTAR_STATS
+# define COUNT(estar, field) (++(estar)->stats.field)
+#else
+# define COUNT(estar, field) /* nop */
+#endif
+
+
+static double interpolate (estar_t * estar,
+			   double cost, double primary, double secondary)
 {
   double tmp;
   
   if (cost <= secondary - primary) {
+    COUNT (estar, non_interpolated);
     return primary + cost;
   }
+  COUNT (estar, interpolated);
   
   // pow(cost,2) could be cached inside estar_set_speed. And so could
   // the other squared terms. That might speed things up, but it would
@@ -56,15 +86,17 @@ static double interpolate (double cost, double primary, double secondary)
 }
 
 
-static void calc_rhs (estar_cell_t * cell, double phimax)
+static void calc_rhs (estar_t * estar, estar_cell_t * cell, double phimax)
 {
+  estar_cell_t * buf[9];
   estar_cell_t ** prop;
   estar_cell_t * primary;
   estar_cell_t * secondary;
   double rr;
   
+  COUNT (estar, calc_rhs);
   cell->rhs = INFINITY;
-  prop = cell->prop;
+  prop = estar_cell_prop (cell, buf);
   while (NULL != *prop) {
     
     primary = *(prop++);
@@ -91,10 +123,11 @@ static void calc_rhs (estar_cell_t * cell, double phimax)
 	|| secondary->pqi != 0
 	|| secondary->phi > phimax
 	|| isinf(secondary->phi)) {
+      COUNT (estar, non_interpolated);
       rr = primary->rhs + cell->cost;
     }
     else {
-      rr = interpolate (cell->cost, primary->phi, secondary->phi);
+      rr = interpolate (estar, cell->cost, primary->phi, secondary->phi);
     }
     
     if (rr < cell->rhs) {
@@ -108,6 +141,7 @@ static void calc_rhs (estar_cell_t * cell, double phimax)
     // secondary sorting above, it could be imagined to create
     // situations where we overlook something. So, just to be on the
     // safe side, let's retry all non-interpolated options.
+    COUNT (estar, fallback);
     for (prop = cell->nbor; *prop != 0; ++prop) {
       rr = (*prop)->phi;
       if (rr < cell->rhs) {
@@ -119,28 +153,256 @@ static void calc_rhs (estar_cell_t * cell, double phimax)
 }
 
 
+static double focus_bias (void * data, estar_cell_t const * cell)
+{
+  estar_t * estar;
+  size_t ix, iy;
+  double dx, dy;
+  
+  estar = data;
+  estar_grid_coords (&estar->grid, cell, &ix, &iy);
+  dx = (double) ix - (double) estar->focus.ix;
+  dy = (double) iy - (double) estar->focus.iy;
+  
+  return estar->focus.km
+    + estar->focus.weight * estar->focus.scale * sqrt (dx * dx + dy * dy);
+}
+
+
+/* Variant of calc_rhs() used in focused mode. There, the queue order
+   is no longer that of the wavefront, so the notion of cells lying
+   "above the wavefront" or being pending on the queue cannot be used
+   to filter neighbors: doing so makes rhs depend on the order of
+   expansion and lets raise and lower waves chase each other around
+   forever. Instead, just like D*-Lite, compute rhs purely from the
+   phi of the neighbors. */
+static void calc_rhs_focused (estar_t * estar, estar_cell_t * cell)
+{
+  estar_cell_t * buf[9];
+  estar_cell_t ** prop;
+  double primary, secondary, rr;
+  
+  COUNT (estar, calc_rhs);
+  cell->rhs = INFINITY;
+  for (prop = estar_cell_prop (cell, buf); NULL != *prop; prop += 2) {
+    primary = prop[0]->flags & ESTAR_FLAG_OBSTACLE ? INFINITY : prop[0]->phi;
+    secondary = prop[1]->flags & ESTAR_FLAG_OBSTACLE ? INFINITY : prop[1]->phi;
+    if (secondary < primary) {
+      rr = primary;
+      primary = secondary;
+      secondary = rr;
+    }
+    if (isinf (primary)) {
+      continue;
+    }
+    if (isinf (secondary)) {
+      COUNT (estar, non_interpolated);
+      rr = primary + cell->cost;
+    }
+    else {
+      rr = interpolate (estar, cell->cost, primary, secondary);
+    }
+    if (rr < cell->rhs) {
+      cell->rhs = rr;
+    }
+  }
+  
+  if (isinf (cell->rhs)) {
+    // grids that are only one cell wide have no propagator pairs
+    COUNT (estar, fallback);
+    for (prop = cell->nbor; *prop != 0; ++prop) {
+      if ((*prop)->phi < cell->rhs) {
+	cell->rhs = (*prop)->phi;
+      }
+    }
+    cell->rhs += cell->cost;
+  }
+}
+
+
+static int enqueue (estar_t * estar, estar_cell_t * cell)
+{
+  if (0 == cell->pqi) {
+    COUNT (estar, pq_insert);
+  }
+  else {
+    COUNT (estar, pq_update);
+  }
+  return estar_pqueue_insert_or_update (&estar->pq, cell);
+}
+
+
+static void dequeue (estar_t * estar, estar_cell_t * cell)
+{
+  if (0 != cell->pqi) {
+    COUNT (estar, pq_remove);
+  }
+  estar_pqueue_remove_or_ignore (&estar->pq, cell);
+}
+
+
+/* The interpolation makes the value of a cell depend on neighbors
+   that lie only marginally closer to the goal, so even a modest
+   heuristic lets the queue expand some cells before their inputs are
+   final. Each of these inversions later sends a small lowering wave
+   across everything downstream. The focus tolerance cuts these waves
+   off once they no longer matter. */
+static int focus_consistent (estar_t * estar, estar_cell_t const * cell)
+{
+  if (NULL == estar->focus.cell) {
+    return 0;
+  }
+  return fabs (cell->phi - cell->rhs) <= estar->focus.tolerance * cell->cost;
+}
+
+
 void estar_init (estar_t * estar, size_t dimx, size_t dimy)
 {
-  estar_grid_init (&estar->grid, dimx, dimy);
+  estar_grid_conf_t conf;
+  estar_grid_conf_default (&conf);
+  estar_init_conf (estar, dimx, dimy, &conf);
+}
+
+
+void estar_init_conf (estar_t * estar, size_t dimx, size_t dimy,
+		      estar_grid_conf_t const * conf)
+{
+  estar_grid_init_conf (&estar->grid, dimx, dimy, conf);
   estar_pqueue_init (&estar->pq, dimx + dimy);
+  estar->focus.cell = NULL;
+  estar->focus.ix = 0;
+  estar->focus.iy = 0;
+  estar->focus.scale = 1.0;	/* estar_grid_init sets all costs to 1 */
+  estar->focus.km = 0.0;
+  estar->focus.weight = 0.5;
+  estar->focus.tolerance = 0.03;
+  memset (&estar->stats, 0, sizeof(estar->stats));
+  estar->profile = NULL;
+  estar->recorder = NULL;
+  estar->frame = NULL;
+  estar->speed_fn = NULL;
+  estar->speed_data = NULL;
+  estar->version = 0;
+  estar->stamp = calloc ((estar->grid.ncells >> ESTAR_STAMP_SHIFT) + 1,
+			 sizeof(*estar->stamp));
+  if (NULL == estar->stamp) {
+    errx (EXIT_FAILURE, __FILE__": %s: calloc", __func__);
+  }
 }
 
 
-void estar_reset (estar_t * estar)
+/* Record that the rhs or phi of a cell changed, see ESTAR_STAMP_SHIFT. */
+static void touch (estar_t * estar, estar_cell_t const * cell)
 {
-  size_t const ncells = estar->grid.dimx * estar->grid.dimy;
-  size_t ii;
-  estar_cell_t * cell;
+  estar_cell_t * const * nbor;
+  unsigned long long const version = ++estar->version;
   
-  for (ii = 0, cell = estar->grid.cell; ii < ncells; ++ii, ++cell) {
+  estar->stamp[(cell - estar->grid.cell) >> ESTAR_STAMP_SHIFT] = version;
+  for (nbor = cell->nbor; NULL != *nbor; ++nbor) {
+    estar->stamp[(*nbor - estar->grid.cell) >> ESTAR_STAMP_SHIFT] = version;
+  }
+}
+
+
+int estar_changed_since (estar_t const * estar, size_t x0, size_t y0,
+			 size_t x1, size_t y1, unsigned long long since)
+{
+  size_t iy, lo, hi;
+  
+  // The cells of one row lie between the grid indices of its first
+  // and last cell in any layout, so checking the stamps of all chunks
+  // in between errs on the safe side.
+  for (iy = y0; iy < y1; ++iy) {
+    lo = estar_grid_index (&estar->grid, x0, iy) >> ESTAR_STAMP_SHIFT;
+    hi = estar_grid_index (&estar->grid, x1 - 1, iy) >> ESTAR_STAMP_SHIFT;
+    for (; lo <= hi; ++lo) {
+      if (estar->stamp[lo] > since) {
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+
+/* Store a new cost, and keep the focus scale and the obstacle flag in
+   line with it. */
+static void apply_cost (estar_t * estar, estar_cell_t * cell, double cost)
+{
+  cell->cost = cost;
+  if (cost < estar->focus.scale) {
+    // The heuristic would no longer be admissible. Start over with
+    // fresh keys, which also makes the accumulated km obsolete.
+    estar->focus.scale = cost;
+    if (NULL != estar->focus.cell) {
+      estar->focus.km = 0.0;
+      estar_pqueue_rekey (&estar->pq);
+    }
+  }
+  if (isinf (cost)) {
+    touch (estar, cell);
+    cell->phi = INFINITY;
+    cell->rhs = INFINITY;
+    cell->flags |= ESTAR_FLAG_OBSTACLE;
+  }
+  else if (cell->flags & ESTAR_FLAG_OBSTACLE) {
+    touch (estar, cell);
+    cell->flags &= ~ESTAR_FLAG_OBSTACLE;
+  }
+}
+
+
+/* Ask the speed source for the cost of a cell that the wavefront
+   reaches for the first time, see estar_set_speed_source(). None of
+   the neighbors can have used the old cost, so there is nothing to
+   update. */
+static void evaluate (estar_t * estar, estar_cell_t * cell)
+{
+  size_t ix, iy;
+  double speed;
+  
+  estar_grid_coords (&estar->grid, cell, &ix, &iy);
+  speed = estar->speed_fn (estar->speed_data, ix, iy);
+  if (NULL != estar->frame) {
+    estar->frame[iy * estar->grid.dimx + ix] = speed <= 0.0 ? 0.0f : speed;
+  }
+  cell->flags &= ~ESTAR_FLAG_LAZY;
+  apply_cost (estar, cell, speed <= 0.0 ? INFINITY : 1.0 / speed);
+}
+
+
+static void reset_cells (estar_grid_t * grid,
+			 estar_cell_t * begin, estar_cell_t * end,
+			 void * data)
+{
+  estar_cell_t * cell;
+  for (cell = begin; cell != end; ++cell) {
     cell->phi = INFINITY;
     cell->rhs = INFINITY;
     cell->key = INFINITY;
     cell->pqi = 0;
     cell->flags &= ~ESTAR_FLAG_GOAL;
   }
+}
+
+
+void estar_reset (estar_t * estar)
+{
+  size_t ii;
   
+  if (NULL != estar->recorder) {
+    estar_record (estar->recorder, ESTAR_RECORD_RESET, 0, 0, 0.0);
+  }
+  estar_grid_parallel (&estar->grid, reset_cells, NULL);
+  ++estar->version;
+  for (ii = 0; ii <= estar->grid.ncells >> ESTAR_STAMP_SHIFT; ++ii) {
+    estar->stamp[ii] = estar->version;
+  }
   estar->pq.len = 0;
+  estar->focus.km = 0.0;
+  if (NULL != estar->profile) {
+    estar->profile->active = 0;
+  }
 }
 
 
@@ -148,25 +410,207 @@ void estar_fini (estar_t * estar)
 {
   estar_grid_fini (&estar->grid);
   estar_pqueue_fini (&estar->pq);
+  free (estar->frame);
+  estar->frame = NULL;
+  free (estar->stamp);
+  estar->stamp = NULL;
+}
+
+
+int estar_reserve (estar_t * estar, size_t cap)
+{
+  return estar_pqueue_reserve (&estar->pq, cap);
 }
 
 
-void estar_set_goal (estar_t * estar, size_t ix, size_t iy)
+int estar_stats_enabled (void)
+{
+#ifdef ESTAR_STATS
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+
+int estar_compact_enabled (void)
+{
+#ifdef ESTAR_COMPACT
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+
+void estar_stats_snapshot (estar_t const * estar, estar_stats_t * stats)
+{
+  *stats = estar->stats;
+}
+
+
+void estar_stats_reset (estar_t * estar)
+{
+  memset (&estar->stats, 0, sizeof(estar->stats));
+}
+
+
+void estar_set_profile (estar_t * estar, estar_profile_t * profile)
+{
+  estar->profile = profile;
+}
+
+
+static void profile_queue (estar_t * estar)
+{
+  if (estar->pq.len > estar->profile->current.peak_queue) {
+    estar->profile->current.peak_queue = estar->pq.len;
+  }
+}
+
+
+/* Called after changes: if they left nothing to propagate, there is
+   no epoch to wait for. */
+static void profile_idle (estar_t * estar)
+{
+  if (NULL != estar->profile && estar->profile->active && 0 == estar->pq.len) {
+    estar_profile_idle (estar->profile);
+  }
+}
+
+
+void estar_memory_usage (estar_t const * estar, estar_memory_t * mem)
+{
+  size_t const ncells = estar->grid.ncells;
+  size_t cells;
+  
+  cells = estar->grid.mapsize;
+  if (0 == cells) {
+    cells = ncells * sizeof(estar_cell_t);
+  }
+  mem->topology
+    = ncells * (sizeof(estar_cell_t) - offsetof(estar_cell_t, nbor));
+  mem->grid = cells - mem->topology;
+  mem->queue = (estar->pq.cap + 1) * sizeof(estar_cell_t*);
+  mem->frame = 0;
+  if (NULL != estar->frame) {
+    mem->frame = sizeof(float) * estar->grid.dimx * estar->grid.dimy;
+  }
+  mem->stamps = ((ncells >> ESTAR_STAMP_SHIFT) + 1) * sizeof(*estar->stamp);
+  mem->total = mem->grid + mem->topology + mem->queue + mem->frame + mem->stamps
+    + sizeof(*estar);
+}
+
+
+int estar_set_goal (estar_t * estar, size_t ix, size_t iy)
 {
   estar_cell_t * goal = estar_grid_at (&estar->grid, ix, iy);
+  int status;
+  if (NULL != estar->recorder) {
+    estar_record (estar->recorder, ESTAR_RECORD_GOAL, ix, iy, 0.0);
+  }
+  if (goal->flags & ESTAR_FLAG_LAZY) {
+    evaluate (estar, goal);
+  }
   goal->rhs = 0.0;
   goal->flags |= ESTAR_FLAG_GOAL;
   goal->flags &= ~ESTAR_FLAG_OBSTACLE;
-  estar_pqueue_insert_or_update (&estar->pq, goal);
+  touch (estar, goal);
+  status = enqueue (estar, goal);
+  if (NULL != estar->profile) {
+    estar_profile_change (estar->profile, ix, iy);
+    profile_queue (estar);
+  }
+  return status;
+}
+
+
+/* Whether the wavefront has not reached the cell or any of its
+   neighbors yet. Changing the cost of such a cell cannot change any
+   rhs, so the updates can be skipped. */
+static int untouched (estar_cell_t const * cell)
+{
+  estar_cell_t * const * nbor;
+  
+  if (0 != cell->pqi || ! isinf (cell->phi) || ! isinf (cell->rhs)
+      || (cell->flags & ESTAR_FLAG_GOAL)) {
+    return 0;
+  }
+  for (nbor = cell->nbor; *nbor != 0; ++nbor) {
+    if ( ! isinf ((*nbor)->phi)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+/* First half of changing the cost of a cell: everything but the
+   updates. Returns zero if the updates can be skipped. The speed is
+   only used to keep the frame of estar_set_speed_frame() in sync. */
+static int set_cost (estar_t * estar, estar_cell_t * cell,
+		     size_t ix, size_t iy, double speed, double cost)
+{
+  int need_update;
+  
+  if (NULL != estar->profile) {
+    estar_profile_change (estar->profile, ix, iy);
+  }
+  if (NULL != estar->frame) {
+    estar->frame[iy * estar->grid.dimx + ix] = speed <= 0.0 ? 0.0f : speed;
+  }
+  
+  // must be decided before phi and rhs get touched below
+  need_update = ! untouched (cell);
+  apply_cost (estar, cell, cost);
+  
+  return need_update;
+}
+
+
+/* Second half of changing the cost of a cell. */
+static int update_around (estar_t * estar, estar_cell_t * cell)
+{
+  estar_cell_t ** nbor;
+  int status;
+  
+  // Keep going after a failure, so that as many cells as possible end
+  // up where they belong. The only possible failure is a full queue.
+  status = estar_update (estar, cell);
+  for (nbor = cell->nbor; *nbor != 0; ++nbor) {
+    if (ESTAR_OK != estar_update (estar, *nbor)) {
+      status = ESTAR_EFULL;
+    }
+  }
+  if (NULL != estar->profile) {
+    profile_queue (estar);
+  }
+  return status;
+}
+
+
+static int change_cost (estar_t * estar, estar_cell_t * cell,
+			size_t ix, size_t iy, double speed, double cost)
+{
+  int status;
+  
+  status = ESTAR_OK;
+  if (set_cost (estar, cell, ix, iy, speed, cost)) {
+    status = update_around (estar, cell);
+  }
+  profile_idle (estar);
+  return status;
 }
 
 
-void estar_set_speed (estar_t * estar, size_t ix, size_t iy, double speed)
+int estar_set_speed (estar_t * estar, size_t ix, size_t iy, double speed)
 {
   double cost;
   estar_cell_t * cell;
-  estar_cell_t ** nbor;
 
+  if (NULL != estar->recorder) {
+    estar_record (estar->recorder, ESTAR_RECORD_SPEED, ix, iy, speed);
+  }
   cell = estar_grid_at (&estar->grid, ix, iy);
   
   // XXXX I'm undecided yet whether this check here makes the most
@@ -182,141 +626,666 @@ void estar_set_speed (estar_t * estar, size_t ix, size_t iy, double speed)
     cost = INFINITY;
   }
   else {
-    cost = 1.0 / speed;
+    cost = (estar_real_t) (1.0 / speed);
   }
   if (cost == cell->cost) {
-    return;
+    return ESTAR_OK;
   }
+  return change_cost (estar, cell, ix, iy, speed, cost);
+}
+
+
+int estar_set_cost (estar_t * estar, size_t ix, size_t iy, double cost)
+{
+  estar_cell_t * cell;
   
-  cell->cost = cost;
-  if (speed <= 0.0) {
-    cell->phi = INFINITY;
+  if (NULL != estar->recorder) {
+    estar_record (estar->recorder, ESTAR_RECORD_COST, ix, iy, cost);
+  }
+  cell = estar_grid_at (&estar->grid, ix, iy);
+  cost = (estar_real_t) cost;
+  if (cost == cell->cost) {
+    return ESTAR_OK;
+  }
+  return change_cost (estar, cell, ix, iy, isinf (cost) ? 0.0 : 1.0 / cost, cost);
+}
+
+
+int estar_set_speed_bulk (estar_t * estar, float const * speed, size_t stride)
+{
+  size_t const dimx = estar->grid.dimx;
+  size_t const dimy = estar->grid.dimy;
+  size_t ix, iy;
+  float const * sp;
+  estar_cell_t * cell;
+  double cost;
+  int status;
+  
+  // Same as calling estar_set_speed() for each cell, minus the call
+  // overhead, the lookup of each cell, and the divisions for cells
+  // that did not change. Row by row, so that the speeds are read
+  // sequentially and the cells tile by tile.
+  status = ESTAR_OK;
+  for (iy = 0; iy < dimy; ++iy) {
+    sp = speed + iy * stride;
+    for (ix = 0; ix < dimx; ++ix) {
+      cell = estar_grid_at (&estar->grid, ix, iy);
+      if (sp[ix] <= 0.0f) {
+	if (isinf (cell->cost)) {
+	  continue;
+	}
+	cost = INFINITY;
+      }
+      else {
+	cost = (estar_real_t) (1.0 / sp[ix]);
+	if (cost == cell->cost) {
+	  continue;
+	}
+      }
+      if (NULL != estar->recorder) {
+	estar_record (estar->recorder, ESTAR_RECORD_SPEED, ix, iy, sp[ix]);
+      }
+      if (ESTAR_OK != change_cost (estar, cell, ix, iy, sp[ix], cost)) {
+	status = ESTAR_EFULL;
+      }
+    }
+  }
+  
+  return status;
+}
+
+
+static int flush_batch (estar_t * estar, estar_cell_t ** batch, size_t len)
+{
+  size_t ii;
+  int status = ESTAR_OK;
+  for (ii = 0; ii < len; ++ii) {
+    if (ESTAR_OK != update_around (estar, batch[ii])) {
+      status = ESTAR_EFULL;
+    }
+  }
+  return status;
+}
+
+
+int estar_set_speed_frame (estar_t * estar, float const * speed)
+{
+  size_t const dimx = estar->grid.dimx;
+  size_t const dimy = estar->grid.dimy;
+  estar_cell_t * batch[FRAME_BATCH];
+  estar_cell_t * cell;
+  size_t ix, iy, x0, x1, nbatch;
+  float const * sp;
+  float * fr;
+  double cost;
+  int status;
+  
+  if (NULL == estar->frame) {
+    estar->frame = malloc (sizeof(float) * dimx * dimy);
+    if (NULL == estar->frame) {
+      return ESTAR_ENOMEM;
+    }
+    for (iy = 0; iy < dimy; ++iy) {
+      for (ix = 0; ix < dimx; ++ix) {
+	cost = estar_grid_at (&estar->grid, ix, iy)->cost;
+	estar->frame[iy * dimx + ix] = isinf (cost) ? 0.0f : 1.0 / cost;
+      }
+    }
+  }
+  
+  // Compare chunks of each row with memcmp(), which is about as fast
+  // as it gets, and only look at the individual cells of chunks that
+  // differ. Changed cells get their new cost right away, but their
+  // updates are collected and done in batches: this way, a cell that
+  // neighbors several changed ones sees all of their new costs.
+  status = ESTAR_OK;
+  nbatch = 0;
+  for (iy = 0; iy < dimy; ++iy) {
+    sp = speed + iy * dimx;
+    fr = estar->frame + iy * dimx;
+    for (x0 = 0; x0 < dimx; x0 = x1) {
+      x1 = x0 + FRAME_CHUNK < dimx ? x0 + FRAME_CHUNK : dimx;
+      if (0 == memcmp (sp + x0, fr + x0, sizeof(float) * (x1 - x0))) {
+	continue;
+      }
+      for (ix = x0; ix < x1; ++ix) {
+	if (sp[ix] == fr[ix]) {
+	  continue;
+	}
+	fr[ix] = sp[ix];
+	cell = estar_grid_at (&estar->grid, ix, iy);
+	cost = sp[ix] <= 0.0f ? INFINITY : (estar_real_t) (1.0 / sp[ix]);
+	if (cost == cell->cost) {
+	  continue;
+	}
+	if (NULL != estar->recorder) {
+	  estar_record (estar->recorder, ESTAR_RECORD_SPEED, ix, iy, sp[ix]);
+	}
+	if (set_cost (estar, cell, ix, iy, sp[ix], cost)) {
+	  batch[nbatch++] = cell;
+	  if (FRAME_BATCH == nbatch) {
+	    if (ESTAR_OK != flush_batch (estar, batch, nbatch)) {
+	      status = ESTAR_EFULL;
+	    }
+	    nbatch = 0;
+	  }
+	}
+      }
+    }
+  }
+  if (ESTAR_OK != flush_batch (estar, batch, nbatch)) {
+    status = ESTAR_EFULL;
+  }
+  profile_idle (estar);
+  
+  return status;
+}
+
+
+int estar_set_speed_source (estar_t * estar, estar_speed_fn speed, void * data)
+{
+  size_t ix, iy;
+  
+  estar->speed_fn = speed;
+  estar->speed_data = data;
+  if (NULL != speed) {
+    return estar_invalidate (estar, 0, 0, estar->grid.dimx, estar->grid.dimy);
+  }
+  for (iy = 0; iy < estar->grid.dimy; ++iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      estar_grid_at (&estar->grid, ix, iy)->flags &= ~ESTAR_FLAG_LAZY;
+    }
+  }
+  return ESTAR_OK;
+}
+
+
+int estar_invalidate (estar_t * estar, size_t x0, size_t y0, size_t x1, size_t y1)
+{
+  estar_cell_t * cell;
+  size_t ix, iy;
+  double speed, cost;
+  int status;
+  
+  if (NULL == estar->speed_fn) {
+    return ESTAR_OK;
+  }
+  if (x1 > estar->grid.dimx) {
+    x1 = estar->grid.dimx;
+  }
+  if (y1 > estar->grid.dimy) {
+    y1 = estar->grid.dimy;
+  }
+  
+  status = ESTAR_OK;
+  for (iy = y0; iy < y1; ++iy) {
+    for (ix = x0; ix < x1; ++ix) {
+      cell = estar_grid_at (&estar->grid, ix, iy);
+      if (cell->flags & ESTAR_FLAG_LAZY) {
+	continue;
+      }
+      // the same reasoning as for skipping updates in set_cost()
+      if (untouched (cell)) {
+	cell->flags |= ESTAR_FLAG_LAZY;
+	continue;
+      }
+      speed = estar->speed_fn (estar->speed_data, ix, iy);
+      cost = speed <= 0.0 ? INFINITY : 1.0 / speed;
+      if (cost != cell->cost
+	  && ESTAR_OK != change_cost (estar, cell, ix, iy, speed, cost)) {
+	status = ESTAR_EFULL;
+      }
+    }
+  }
+  return status;
+}
+
+
+double estar_speed_view (void * data, size_t ix, size_t iy)
+{
+  estar_speed_view_t const * view = data;
+  return view->speed[iy * view->stride + ix];
+}
+
+
+/* Move a cell into or out of the region of interest, see
+   estar_set_roi(). */
+static int set_outside (estar_t * estar, estar_cell_t * cell, int outside)
+{
+  if (outside == ! ! (cell->flags & ESTAR_FLAG_OUTSIDE)) {
+    return ESTAR_OK;
+  }
+  // the flag is part of what estar_changed_since() covers
+  touch (estar, cell);
+  if ( ! outside) {
+    cell->flags &= ~ESTAR_FLAG_OUTSIDE;
+    if (untouched (cell)) {
+      return ESTAR_OK;
+    }
+    return estar_update (estar, cell);
+  }
+  cell->flags |= ESTAR_FLAG_OUTSIDE;
+  if (cell->flags & ESTAR_FLAG_GOAL) {
+    return ESTAR_OK;
+  }
+  if (isinf (cell->phi)) {
+    // no neighbor can have used it yet
     cell->rhs = INFINITY;
-    cell->flags |= ESTAR_FLAG_OBSTACLE;
+    dequeue (estar, cell);
+    return ESTAR_OK;
   }
-  else {
-    cell->flags &= ~ESTAR_FLAG_OBSTACLE;
+  cell->phi = INFINITY;
+  cell->rhs = INFINITY;
+  return update_around (estar, cell);
+}
+
+
+int estar_set_roi (estar_t * estar, unsigned char const * mask, size_t stride)
+{
+  size_t ix, iy;
+  int status;
+  
+  status = ESTAR_OK;
+  for (iy = 0; iy < estar->grid.dimy; ++iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      if (ESTAR_OK != set_outside (estar, estar_grid_at (&estar->grid, ix, iy),
+				   NULL != mask && 0 == mask[iy * stride + ix])) {
+	status = ESTAR_EFULL;
+      }
+    }
   }
+  if (NULL != estar->recorder) {
+    estar_record_roi (estar);
+  }
+  return status;
+}
+
+
+int estar_set_roi_box (estar_t * estar, size_t x0, size_t y0, size_t x1, size_t y1)
+{
+  size_t ix, iy;
+  int status;
   
-  estar_update (estar, cell);
-  for (nbor = cell->nbor; *nbor != 0; ++nbor) {
-    estar_update (estar, *nbor);
+  status = ESTAR_OK;
+  for (iy = 0; iy < estar->grid.dimy; ++iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      if (ESTAR_OK != set_outside (estar, estar_grid_at (&estar->grid, ix, iy),
+				   ix < x0 || ix >= x1 || iy < y0 || iy >= y1)) {
+	status = ESTAR_EFULL;
+      }
+    }
+  }
+  if (NULL != estar->recorder) {
+    estar_record_roi (estar);
   }
+  return status;
 }
 
 
-void estar_update (estar_t * estar, estar_cell_t * cell)
+int estar_update (estar_t * estar, estar_cell_t * cell)
 {
+  double rhs;
+  
+  if ((cell->flags & (ESTAR_FLAG_OUTSIDE | ESTAR_FLAG_GOAL)) == ESTAR_FLAG_OUTSIDE) {
+    dequeue (estar, cell);
+    return ESTAR_OK;
+  }
+  
+  if (cell->flags & ESTAR_FLAG_LAZY) {
+    evaluate (estar, cell);
+  }
+  
   /* XXXX check whether obstacles actually can end up being
      updated. Possibly due to effects of estar_set_speed? */
   if (cell->flags & ESTAR_FLAG_OBSTACLE) {
-    estar_pqueue_remove_or_ignore (&estar->pq, cell);
-    return;
+    dequeue (estar, cell);
+    return ESTAR_OK;
   }
   
   /* Make sure that goal cells remain at their rhs, which is supposed
      to be fixed and only serve as source for propagation, never as
-     sink. */
-  if ( ! (cell->flags & ESTAR_FLAG_GOAL)) {
-    calc_rhs (cell, estar_pqueue_topkey (&estar->pq));
+     sink. The same goes for ghost cells, whose rhs mirrors a cell
+     owned by another planner. */
+  if ( ! (cell->flags & (ESTAR_FLAG_GOAL | ESTAR_FLAG_GHOST))) {
+    rhs = cell->rhs;
+    if (NULL == estar->focus.cell) {
+      calc_rhs (estar, cell, estar_pqueue_topkey (&estar->pq));
+    }
+    else {
+      calc_rhs_focused (estar, cell);
+    }
+    if (rhs != cell->rhs) {
+      touch (estar, cell);
+    }
   }
   
-  if (cell->phi != cell->rhs) {
-    estar_pqueue_insert_or_update (&estar->pq, cell);
-  }
-  else {
-    estar_pqueue_remove_or_ignore (&estar->pq, cell);
+  if (cell->phi != cell->rhs && ! focus_consistent (estar, cell)) {
+    return enqueue (estar, cell);
   }
+  dequeue (estar, cell);
+  return ESTAR_OK;
 }
 
 
-void estar_propagate (estar_t * estar)
+int estar_propagate (estar_t * estar)
 {
   estar_cell_t * cell;
   estar_cell_t ** nbor;
+  int status;
   
+  if (NULL != estar->recorder) {
+    estar_record_propagate (estar->recorder);
+  }
   cell = estar_pqueue_extract (&estar->pq);
   if (NULL == cell) {
-    return;
+    return ESTAR_OK;
+  }
+  COUNT (estar, pq_extract);
+  
+  // In focused mode, the key may be outdated because the query cell
+  // moved since the cell was queued. Just like D*-Lite, put it back
+  // with its current key and try again later.
+  if (NULL != estar->focus.cell
+      && cell->key < estar_pqueue_calc_key (&estar->pq, cell)) {
+    return enqueue (estar, cell);
   }
   
   // The chunk below could be placed into a function called expand,
   // but it is not needed anywhere else.
   
+  // phi changes either way
+  status = ESTAR_OK;
+  estar->stamp[(cell - estar->grid.cell) >> ESTAR_STAMP_SHIFT] = ++estar->version;
   if (cell->phi > cell->rhs) {
+    COUNT (estar, lower);
+    if (NULL != estar->profile) {
+      ++estar->profile->current.lowered;
+    }
     cell->phi = cell->rhs;
     for (nbor = cell->nbor; *nbor != 0; ++nbor) {
-      estar_update (estar, *nbor);
+      if (ESTAR_OK != estar_update (estar, *nbor)) {
+	status = ESTAR_EFULL;
+      }
     }
   }
   else {
+    COUNT (estar, raise);
+    if (NULL != estar->profile) {
+      ++estar->profile->current.raised;
+    }
     cell->phi = INFINITY;
     for (nbor = cell->nbor; *nbor != 0; ++nbor) {
-      estar_update (estar, *nbor);
+      if (ESTAR_OK != estar_update (estar, *nbor)) {
+	status = ESTAR_EFULL;
+      }
+    }
+    if (ESTAR_OK != estar_update (estar, cell)) {
+      status = ESTAR_EFULL;
+    }
+  }
+  
+  if (NULL != estar->profile) {
+    profile_queue (estar);
+    if (0 == estar->pq.len) {
+      estar_profile_finish (estar->profile);
     }
-    estar_update (estar, cell);
   }
+  
+  return status;
 }
 
 
-int estar_check (estar_t * estar, char const * pfx)
+void estar_set_focus (estar_t * estar, size_t ix, size_t iy)
+{
+  double dx, dy;
+  
+  if (NULL != estar->recorder) {
+    estar_record (estar->recorder, ESTAR_RECORD_FOCUS, ix, iy, 0.0);
+  }
+  if (NULL == estar->focus.cell) {
+    estar->focus.cell = estar_grid_at (&estar->grid, ix, iy);
+    estar->focus.ix = ix;
+    estar->focus.iy = iy;
+    estar->focus.km = 0.0;
+    estar->pq.bias = focus_bias;
+    estar->pq.bias_data = estar;
+    estar_pqueue_rekey (&estar->pq);
+    return;
+  }
+  
+  dx = (double) ix - (double) estar->focus.ix;
+  dy = (double) iy - (double) estar->focus.iy;
+  estar->focus.km
+    += estar->focus.weight * estar->focus.scale * sqrt (dx * dx + dy * dy);
+  estar->focus.cell = estar_grid_at (&estar->grid, ix, iy);
+  estar->focus.ix = ix;
+  estar->focus.iy = iy;
+  estar->pq.bias_data = estar;	/* in case estar has been moved */
+}
+
+
+int estar_clear_focus (estar_t * estar)
 {
+  size_t const ncells = estar->grid.ncells;
+  size_t ii;
+  estar_cell_t * cell;
   int status;
-  size_t ii, jj, kk;
   
-  status = 0;
+  if (NULL != estar->recorder) {
+    estar_record (estar->recorder, ESTAR_RECORD_CLEAR_FOCUS, 0, 0, 0.0);
+  }
+  if (NULL == estar->focus.cell) {
+    return ESTAR_OK;
+  }
+  estar->focus.cell = NULL;
+  estar->focus.km = 0.0;
+  estar->pq.bias = NULL;
+  estar->pq.bias_data = NULL;
+  estar_pqueue_rekey (&estar->pq);
   
-  for (ii = 0; ii < estar->grid.dimx; ++ii) {
-    for (jj = 0; jj < estar->grid.dimy; ++jj) {
-      estar_cell_t * cell;
-      cell = estar_grid_at (&estar->grid, ii, jj);
-      
-      if (cell->rhs == cell->phi) {
-	// consistent
-	if (0 != cell->pqi) {
-	  printf ("%sconsistent cell should not be on queue\n", pfx);
-	  status |= 1;
-	}
-      }
-      else {
-	// inconsistent
-	if (0 == cell->pqi) {
-	  printf ("%sinconsistent cell should be on queue\n", pfx);
-	  status |= 2;
-	}
-      }
-      
-      if (0 == cell->pqi) {
-	// not on queue
-	for (kk = 1; kk <= estar->pq.len; ++kk) {
-	  if (cell == estar->pq.heap[kk]) {
-	    printf ("%scell with pqi == 0 should not be on queue\n", pfx);
-	    status |= 4;
-	    break;
-	  }
-	}
+  // pick up the cells that were left within the focus tolerance
+  status = ESTAR_OK;
+  for (ii = 0, cell = estar->grid.cell; ii < ncells; ++ii, ++cell) {
+    if (cell->phi != cell->rhs && 0 == cell->pqi
+	&& ! (cell->flags & ESTAR_FLAG_OBSTACLE)) {
+      if (ESTAR_OK != enqueue (estar, cell)) {
+	status = ESTAR_EFULL;
       }
-      else {
-	// on queue
-	for (kk = 1; kk <= estar->pq.len; ++kk) {
-	  if (cell == estar->pq.heap[kk]) {
-	    break;
-	  }
-	}
-	if (kk > estar->pq.len) {
-	  printf ("%scell with pqi != 0 should be on queue\n", pfx);
-	  status |= 8;
-	}
+    }
+  }
+  return status;
+}
+
+
+int estar_focus_done (estar_t * estar)
+{
+  estar_cell_t * cell;
+  
+  cell = estar->focus.cell;
+  if (NULL == cell) {
+    return 0 == estar->pq.len;
+  }
+  if (0 != cell->pqi) {
+    return 0;
+  }
+  return estar_pqueue_topkey (&estar->pq) >= estar_pqueue_calc_key (&estar->pq, cell);
+}
+
+
+static int report (char const * pfx, estar_t * estar, estar_cell_t const * cell,
+		   int bit, char const * msg)
+{
+  size_t ix, iy;
+  if (NULL != pfx) {
+    estar_grid_coords (&estar->grid, cell, &ix, &iy);
+    printf ("%s[%zu %zu] %s\n", pfx, ix, iy, msg);
+  }
+  return bit;
+}
+
+
+/* The checks that can be done for a single queue slot in constant
+   time: back-pointer, heap order with respect to the parent, and the
+   key itself. */
+static int check_slot (estar_t * estar, size_t kk, char const * pfx)
+{
+  estar_cell_t * cell = estar->pq.heap[kk];
+  int status = 0;
+  double key;
+  
+  if (cell < estar->grid.cell || cell >= estar->grid.cell + estar->grid.ncells) {
+    if (NULL != pfx) {
+      printf ("%squeue slot %zu does not point into the grid\n", pfx, kk);
+    }
+    return ESTAR_CHECK_PQI;
+  }
+  if (0 == cell->pqi) {
+    status |= report (pfx, estar, cell, ESTAR_CHECK_NOT_QUEUED,
+		      "cell with pqi == 0 should not be on queue");
+  }
+  else if (kk != cell->pqi) {
+    status |= report (pfx, estar, cell, ESTAR_CHECK_PQI, "inconsistent pqi");
+  }
+  if (kk > 1 && estar->pq.heap[kk / 2]->key > cell->key) {
+    status |= report (pfx, estar, cell, ESTAR_CHECK_HEAP,
+		      "key is smaller than that of its heap parent");
+  }
+  // In focused mode, keys may be outdated lower bounds (see
+  // estar_propagate), otherwise they have to be exact.
+  key = estar_pqueue_calc_key (&estar->pq, cell);
+  if (NULL == estar->focus.cell ? key != cell->key : key < cell->key) {
+    status |= report (pfx, estar, cell, ESTAR_CHECK_KEY, "wrong key");
+  }
+  return status;
+}
+
+
+/* The checks that can be done for a single cell in constant time. */
+static int check_cell (estar_t * estar, estar_cell_t * cell, char const * pfx)
+{
+  estar_cell_t ** nbor;
+  int status = 0;
+  double rhs, bound;
+  
+  if (cell->rhs == cell->phi || focus_consistent (estar, cell)) {
+    if (0 != cell->pqi) {
+      status |= report (pfx, estar, cell, ESTAR_CHECK_CONSISTENT,
+			"consistent cell should not be on queue");
+    }
+  }
+  else if (0 == cell->pqi) {
+    status |= report (pfx, estar, cell, ESTAR_CHECK_INCONSISTENT,
+		      "inconsistent cell should be on queue");
+  }
+  
+  if (0 != cell->pqi
+      && (cell->pqi > estar->pq.len || cell != estar->pq.heap[cell->pqi])) {
+    status |= report (pfx, estar, cell, ESTAR_CHECK_QUEUED,
+		      "cell with pqi != 0 should be on queue");
+  }
+  
+  // Once everything has been propagated, rhs must be what the
+  // neighbors say. Obstacles and goals have fixed values instead.
+  // Note that rhs may end up slightly above the recomputed value:
+  // calc_rhs() ignores neighbors above the top of the queue, which
+  // can skip an interpolation that would have become possible later
+  // on. It can never exceed the non-interpolated value from the best
+  // neighbor though, so that is the upper bound.
+  if (cell->flags & ESTAR_FLAG_OBSTACLE) {
+    if ( ! isinf (cell->phi) || ! isinf (cell->rhs)) {
+      status |= report (pfx, estar, cell, ESTAR_CHECK_RHS,
+			"obstacle should be at infinity");
+    }
+  }
+  else if (cell->flags & ESTAR_FLAG_GOAL) {
+    if (0.0 != cell->rhs) {
+      status |= report (pfx, estar, cell, ESTAR_CHECK_RHS, "goal rhs should be zero");
+    }
+  }
+  else if (cell->flags & ESTAR_FLAG_OUTSIDE) {
+    if ( ! isinf (cell->phi) || ! isinf (cell->rhs)) {
+      status |= report (pfx, estar, cell, ESTAR_CHECK_RHS,
+			"cell outside the region of interest should be at infinity");
+    }
+  }
+  else if (cell->flags & ESTAR_FLAG_GHOST) {
+    /* its rhs is up to the owner */
+  }
+  else if (0 == estar->pq.len && NULL == estar->focus.cell) {
+    estar_stats_t const stats = estar->stats;
+    rhs = cell->rhs;
+    calc_rhs (estar, cell, INFINITY);
+    if (rhs + CHECK_TOLERANCE * fabs (rhs) < cell->rhs
+	|| (isinf (rhs) && ! isinf (cell->rhs))) {
+      status |= report (pfx, estar, cell, ESTAR_CHECK_RHS,
+			"rhs is below what the neighbors allow");
+    }
+    cell->rhs = rhs;
+    estar->stats = stats;
+    bound = INFINITY;
+    for (nbor = cell->nbor; NULL != *nbor; ++nbor) {
+      if ((*nbor)->phi < bound) {
+	bound = (*nbor)->phi;
       }
     }
+    bound += cell->cost;
+    if (rhs > bound + CHECK_TOLERANCE * bound) {
+      status |= report (pfx, estar, cell, ESTAR_CHECK_RHS,
+			"rhs is above what the best neighbor allows");
+    }
   }
   
-  for (ii = 1; ii <= estar->pq.len; ++ii) {
-    if (estar->pq.heap[ii]->pqi != ii) {
-      printf ("%sinconsistent pqi\n", pfx);
-      estar_dump_queue (estar, pfx);
-      status |= 16;
-      break;
+  return status;
+}
+
+
+int estar_check (estar_t * estar, char const * pfx)
+{
+  int status;
+  size_t ii, jj, kk;
+  
+  // One pass over the queue and one over the grid. Heap slots that
+  // point to cells with a different pqi are caught in the former,
+  // cells with a pqi that points to some other heap slot (or outside
+  // of the queue) in the latter, so no cell needs to be looked up.
+  status = 0;
+  for (kk = 1; kk <= estar->pq.len; ++kk) {
+    status |= check_slot (estar, kk, pfx);
+  }
+  for (jj = 0; jj < estar->grid.dimy; ++jj) {
+    for (ii = 0; ii < estar->grid.dimx; ++ii) {
+      status |= check_cell (estar, estar_grid_at (&estar->grid, ii, jj), pfx);
+    }
+  }
+  
+  if ((status & ESTAR_CHECK_PQI) && NULL != pfx) {
+    estar_dump_queue (estar, pfx);
+  }
+  
+  return status;
+}
+
+
+int estar_check_sampled (estar_t * estar, size_t nsamples,
+			 unsigned long long * rng, char const * pfx)
+{
+  int status;
+  size_t ii, kk;
+  
+  status = 0;
+  for (kk = 1; kk <= 3 && kk <= estar->pq.len; ++kk) {
+    status |= check_slot (estar, kk, pfx);
+  }
+  for (ii = 0; ii < nsamples; ++ii) {
+    // Knuth's MMIX LCG, the upper bits are good enough for this
+    *rng = *rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    status |= check_cell (estar,
+			  estar_grid_at (&estar->grid,
+					 (*rng >> 32) % estar->grid.dimx,
+					 (*rng >> 11) % estar->grid.dimy),
+			  pfx);
+    if (estar->pq.len > 0) {
+      status |= check_slot (estar, 1 + (*rng >> 40) % estar->pq.len, pfx);
     }
   }
   
@@ -326,13 +1295,12 @@ int estar_check (estar_t * estar, char const * pfx)
 
 void estar_dump_queue (estar_t * estar, char const * pfx)
 {
-  size_t ii;
+  size_t ii, ix, iy;
   for (ii = 1; ii <= estar->pq.len; ++ii) {
+    estar_grid_coords (&estar->grid, estar->pq.heap[ii], &ix, &iy);
     printf ("%s[%zu %zu]  pqi:  %zu  key: %g  phi: %g  rhs: %g\n",
-	    pfx,
-	    (estar->pq.heap[ii] - estar->grid.cell) % estar->grid.dimx,
-	    (estar->pq.heap[ii] - estar->grid.cell) / estar->grid.dimx,
-	    estar->pq.heap[ii]->pqi, estar->pq.heap[ii]->key,
+	    pfx, ix, iy,
+	    (size_t) estar->pq.heap[ii]->pqi, estar->pq.heap[ii]->key,
 	    estar->pq.heap[ii]->phi, estar->pq.heap[ii]->rhs);
   }
 }
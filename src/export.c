@@ -0,0 +1,332 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/export.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <err.h>
+
+
+#define HEADER_SIZE (8 + 4 + 4 + 8 + 8 + 8 + 8 + 1 + 4)
+
+
+static unsigned char * put_u16 (unsigned char * pp, uint16_t value)
+{
+  pp[0] = value & 0xff;
+  pp[1] = value >> 8;
+  return pp + 2;
+}
+
+
+static unsigned char * put_u32 (unsigned char * pp, uint32_t value)
+{
+  size_t ii;
+  for (ii = 0; ii < 4; ++ii, value >>= 8) {
+    pp[ii] = value & 0xff;
+  }
+  return pp + 4;
+}
+
+
+static unsigned char * put_u64 (unsigned char * pp, uint64_t value)
+{
+  size_t ii;
+  for (ii = 0; ii < 8; ++ii, value >>= 8) {
+    pp[ii] = value & 0xff;
+  }
+  return pp + 8;
+}
+
+
+static unsigned char * put_f64 (unsigned char * pp, double value)
+{
+  uint64_t bits;
+  memcpy (&bits, &value, sizeof(bits));
+  return put_u64 (pp, bits);
+}
+
+
+static uint16_t get_u16 (unsigned char const * pp)
+{
+  return pp[0] | (uint16_t) pp[1] << 8;
+}
+
+
+static uint32_t get_u32 (unsigned char const * pp)
+{
+  return pp[0] | (uint32_t) pp[1] << 8 | (uint32_t) pp[2] << 16 | (uint32_t) pp[3] << 24;
+}
+
+
+static uint64_t get_u64 (unsigned char const * pp)
+{
+  return get_u32 (pp) | (uint64_t) get_u32 (pp + 4) << 32;
+}
+
+
+static double get_f64 (unsigned char const * pp)
+{
+  uint64_t bits = get_u64 (pp);
+  double value;
+  memcpy (&value, &bits, sizeof(value));
+  return value;
+}
+
+
+static uint16_t quantize (double phi, double scale)
+{
+  double qq;
+  if (isinf (phi)) {
+    return ESTAR_EXPORT_INF;
+  }
+  qq = phi * scale + 0.5;
+  if (qq >= ESTAR_EXPORT_MAX) {
+    return ESTAR_EXPORT_MAX;
+  }
+  return (uint16_t) qq;
+}
+
+
+void estar_export_init (estar_export_t * exp, size_t dimx, size_t dimy,
+			size_t tile, double resolution)
+{
+  size_t ncells, ii;
+  
+  if (0 == tile || tile > 0xffff) {
+    errx (EXIT_FAILURE, __FILE__": %s: tile size %zu is not within 1 to 65535",
+	  __func__, tile);
+  }
+  exp->dimx = dimx;
+  exp->dimy = dimy;
+  exp->tile = tile;
+  exp->tdimx = (dimx + tile - 1) / tile;
+  exp->tdimy = (dimy + tile - 1) / tile;
+  exp->resolution = resolution;
+  ncells = exp->tdimx * exp->tdimy * tile * tile;
+  exp->prev = malloc ((ncells + tile * tile) * sizeof(*exp->prev));
+  // room for a key frame, so that no frame ever needs more
+  exp->cap = HEADER_SIZE + exp->tdimx * exp->tdimy * (4 + 2 * tile * tile);
+  exp->buf = malloc (exp->cap);
+  if (NULL == exp->prev || NULL == exp->buf) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  exp->value = exp->prev + ncells;
+  for (ii = 0; ii < ncells; ++ii) {
+    exp->prev[ii] = ESTAR_EXPORT_INF;
+  }
+  exp->len = 0;
+  exp->seq = 0;
+  exp->since = 0;
+}
+
+
+void estar_export_fini (estar_export_t * exp)
+{
+  free (exp->prev);
+  free (exp->buf);
+  exp->prev = NULL;
+  exp->value = NULL;
+  exp->buf = NULL;
+}
+
+
+size_t estar_export_frame (estar_export_t * exp, estar_t const * estar, int key)
+{
+  size_t const tile = exp->tile;
+  size_t const area = tile * tile;
+  double const scale = 1.0 / exp->resolution;
+  uint16_t * const value = exp->value;
+  unsigned char * pp;
+  unsigned char * count;
+  uint16_t * prev;
+  size_t tx, ty, x0, x1, y0, y1, ix, iy, ii, ntiles;
+  
+  if (0 == exp->seq) {
+    key = 1;
+  }
+  pp = exp->buf;
+  memcpy (pp, "ESTARPHI", 8);
+  pp = put_u32 (pp + 8, ESTAR_EXPORT_VERSION);
+  pp = put_u32 (pp, tile);
+  pp = put_u64 (pp, exp->dimx);
+  pp = put_u64 (pp, exp->dimy);
+  pp = put_f64 (pp, exp->resolution);
+  pp = put_u64 (pp, exp->seq);
+  *(pp++) = key ? 'K' : 'D';
+  count = pp;
+  pp += 4;
+  
+  ntiles = 0;
+  for (ty = 0; ty < exp->tdimy; ++ty) {
+    y0 = ty * tile;
+    y1 = y0 + tile < exp->dimy ? y0 + tile : exp->dimy;
+    for (tx = 0; tx < exp->tdimx; ++tx) {
+      x0 = tx * tile;
+      x1 = x0 + tile < exp->dimx ? x0 + tile : exp->dimx;
+      if ( ! key && ! estar_changed_since (estar, x0, y0, x1, y1, exp->since)) {
+	continue;
+      }
+      
+      for (ii = 0; ii < area; ++ii) {
+	value[ii] = ESTAR_EXPORT_INF;
+      }
+      for (iy = y0; iy < y1; ++iy) {
+	ii = (iy - y0) * tile;
+	for (ix = x0; ix < x1; ++ix, ++ii) {
+	  value[ii] = quantize (estar_grid_at (&estar->grid, ix, iy)->phi, scale);
+	}
+      }
+      prev = exp->prev + (ty * exp->tdimx + tx) * area;
+      if ( ! key && 0 == memcmp (value, prev, area * sizeof(*value))) {
+	continue;
+      }
+      
+      memcpy (prev, value, area * sizeof(*value));
+      pp = put_u32 (pp, ty * exp->tdimx + tx);
+      for (ii = 0; ii < area; ++ii) {
+	pp = put_u16 (pp, value[ii]);
+      }
+      ++ntiles;
+    }
+  }
+  put_u32 (count, ntiles);
+  
+  ++exp->seq;
+  exp->since = estar->version;
+  exp->len = pp - exp->buf;
+  return exp->len;
+}
+
+
+void estar_import_init (estar_import_t * imp)
+{
+  memset (imp, 0, sizeof(*imp));
+}
+
+
+void estar_import_fini (estar_import_t * imp)
+{
+  free (imp->value);
+  imp->value = NULL;
+  imp->valid = 0;
+}
+
+
+int estar_import_frame (estar_import_t * imp, void const * frame, size_t len)
+{
+  unsigned char const * const start = frame;
+  unsigned char const * pp;
+  size_t tile, dimx, dimy, tdimx, tdimy, area, ntiles, index, ii, jj;
+  double resolution;
+  uint64_t seq;
+  int key;
+  
+  if (len < HEADER_SIZE || 0 != memcmp (start, "ESTARPHI", 8)
+      || ESTAR_EXPORT_VERSION != get_u32 (start + 8)) {
+    imp->valid = 0;
+    return -1;
+  }
+  tile = get_u32 (start + 12);
+  dimx = get_u64 (start + 16);
+  dimy = get_u64 (start + 24);
+  resolution = get_f64 (start + 32);
+  seq = get_u64 (start + 40);
+  key = 'K' == start[48];
+  ntiles = get_u32 (start + 49);
+  // limits that keep the arithmetic below from overflowing
+  if (0 == tile || tile > 0xffff || 0 == dimx || 0 == dimy
+      || dimx > 1 << 24 || dimy > 1 << 24) {
+    imp->valid = 0;
+    return -1;
+  }
+  tdimx = (dimx + tile - 1) / tile;
+  tdimy = (dimy + tile - 1) / tile;
+  area = tile * tile;
+  
+  // check everything before touching the values
+  if ((len - HEADER_SIZE) % (4 + 2 * area) != 0
+      || (len - HEADER_SIZE) / (4 + 2 * area) != ntiles
+      || (key && ntiles != tdimx * tdimy)
+      || ( ! key && ('D' != start[48] || ! imp->valid || seq != imp->seq + 1
+		     || tile != imp->tile || dimx != imp->dimx || dimy != imp->dimy
+		     || resolution != imp->resolution))) {
+    imp->valid = 0;
+    return -1;
+  }
+  for (ii = 0, pp = start + HEADER_SIZE; ii < ntiles; ++ii, pp += 4 + 2 * area) {
+    if (get_u32 (pp) >= tdimx * tdimy) {
+      imp->valid = 0;
+      return -1;
+    }
+  }
+  
+  if (key && (NULL == imp->value || tile != imp->tile
+	      || dimx != imp->dimx || dimy != imp->dimy)) {
+    free (imp->value);
+    imp->value = malloc (tdimx * tdimy * area * sizeof(*imp->value));
+    if (NULL == imp->value) {
+      errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+    }
+  }
+  imp->tile = tile;
+  imp->dimx = dimx;
+  imp->dimy = dimy;
+  imp->tdimx = tdimx;
+  imp->tdimy = tdimy;
+  imp->resolution = resolution;
+  imp->seq = seq;
+  imp->valid = 1;
+  
+  for (ii = 0, pp = start + HEADER_SIZE; ii < ntiles; ++ii) {
+    index = get_u32 (pp);
+    pp += 4;
+    for (jj = 0; jj < area; ++jj, pp += 2) {
+      imp->value[index * area + jj] = get_u16 (pp);
+    }
+  }
+  
+  return 0;
+}
+
+
+double estar_import_phi (estar_import_t const * imp, size_t ix, size_t iy)
+{
+  size_t const tile = imp->tile;
+  uint16_t const qq = imp->value[((iy / tile) * imp->tdimx + ix / tile) * tile * tile
+				 + (iy % tile) * tile + ix % tile];
+  if (ESTAR_EXPORT_INF == qq) {
+    return INFINITY;
+  }
+  return qq * imp->resolution;
+}
@@ -31,6 +31,7 @@
  */
 
 #include <estar2/estar.h>
+#include <estar2/path.h>
 
 #include <gtk/gtk.h>
 #include <err.h>
@@ -272,58 +273,25 @@ gint cb_phi_expose (GtkWidget * ww,
   
   cell = estar_grid_at (&estar.grid, STARTX, STARTY);
   if (0 == cell->pqi && cell->rhs <= maxknown) {
-    double px, py, dd, dmax, ds;
-    px = STARTX;
-    py = STARTY;
-    dmax = 1.3 * cell->rhs;
+    static double path[2 * 4 * DIMX * DIMY];
+    size_t npoints;
     
-    ds = 0.1;
-    for (dd = 0.0; dd <= dmax; dd += ds) {
-      double gx, gy, gg;
-      int ix, iy;
-      if (0 == estar_cell_calc_gradient (cell, &gx, &gy)) {
-	break;
-      }
-      gg = sqrt(pow(gx, 2.0) + pow(gy, 2.0));
-      gx *= ds / gg;
-      gy *= ds / gg;
-      
-      cairo_set_line_width (cr, 2.0);
-      if (fmod(dd, 2.0) < 1.0) {
+    estar_trace_path (&estar.grid, STARTX, STARTY, path, 4 * DIMX * DIMY, &npoints);
+    cairo_set_line_width (cr, 2.0);
+    for (ii = 1; ii < npoints; ++ii) {
+      if (0 == ii % 2) {
 	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
       }
       else {
 	cairo_set_source_rgb (cr, 0.0, 0.0, 0.0);
       }
-      cairo_move_to(cr, w_phi_x0 + (px + 0.5) * w_phi_sx, w_phi_y0 + (py + 0.5) * w_phi_sy);
-      px += gx;
-      py += gy;
-      cairo_line_to(cr, w_phi_x0 + (px + 0.5) * w_phi_sx, w_phi_y0 + (py + 0.5) * w_phi_sy);
+      cairo_move_to (cr,
+		     w_phi_x0 + (path[2 * ii - 2] + 0.5) * w_phi_sx,
+		     w_phi_y0 + (path[2 * ii - 1] + 0.5) * w_phi_sy);
+      cairo_line_to (cr,
+		     w_phi_x0 + (path[2 * ii] + 0.5) * w_phi_sx,
+		     w_phi_y0 + (path[2 * ii + 1] + 0.5) * w_phi_sy);
       cairo_stroke (cr);
-      
-      ix = (int) rint(px);
-      iy = (int) rint(py);
-      if (ix < 0 || ix >= DIMX || iy < 0 || iy >= DIMY) {
-	break;
-      }
-      cell = estar_grid_at (&estar.grid, ix, iy);
-      if (cell->flags & ESTAR_FLAG_GOAL) {
-	break;
-      }
-
-      /* cairo_set_line_width (cr, 1.0); */
-      /* if (fmod(dd, 2.0) < 1.0) { */
-      /* 	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0); */
-      /* } */
-      /* else { */
-      /* 	cairo_set_source_rgb (cr, 0.0, 0.0, 0.0); */
-      /* } */
-      /* cairo_rectangle (cr, */
-      /* 		       w_phi_x0 + (ix + 0.1) * w_phi_sx, */
-      /* 		       w_phi_y0 + (iy + 0.9) * w_phi_sy, */
-      /* 		       0.8 * w_phi_sx, */
-      /* 		       - 0.8 * w_phi_sy); */
-      /* cairo_stroke (cr); */
     }
   }
   
@@ -30,93 +30,330 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE
 #include <estar2/grid.h>
 
 #include <stdlib.h>
 #include <err.h>
 #include <math.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 
 
-void estar_grid_init (estar_grid_t * grid, size_t dimx, size_t dimy)
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+
+typedef struct {
+  estar_grid_t * grid;
+  size_t begin, end;		/* range of cells, aligned to rows of tiles */
+  estar_grid_fn_t fn;
+  void * data;
+} chunk_t;
+
+
+void estar_grid_conf_default (estar_grid_conf_t * conf)
 {
-  size_t ix, iy;
-  estar_cell_t * cell;
-  estar_cell_t ** nbor;
+  conf->tile = 1;
+  conf->nthreads = 1;
+  conf->pages = ESTAR_PAGES_DEFAULT;
+}
+
+
+static void * alloc_cells (estar_grid_t * grid, int pages)
+{
+  size_t const size = sizeof(estar_cell_t) * grid->ncells;
+  void * ptr;
   
-  grid->cell = malloc (sizeof(estar_cell_t) * dimx * dimy);
-  if (NULL == grid->cell) {
-    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  grid->mapsize = 0;
+  if (ESTAR_PAGES_DEFAULT == pages) {
+    return malloc (size);
   }
-  grid->dimx = dimx;
-  grid->dimy = dimy;
   
-  for (ix = 0; ix < dimx; ++ix) {
-    for (iy = 0; iy < dimy; ++iy) {
-      cell = estar_grid_at(grid, ix, iy);
-
-      cell->cost = 1.0;
-      cell->phi = INFINITY;
-      cell->rhs = INFINITY;
-      cell->key = INFINITY;
-      cell->pqi = 0;
-      cell->flags = 0;
-
-      nbor = cell->nbor;
-      if (ix > 0) {		/* west */
-	*(nbor++) = cell - 1;
-      }
-      if (ix < dimx - 1) {	/* east */
-	*(nbor++) = cell + 1;
+  grid->mapsize = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  
+#ifdef MAP_HUGETLB
+  if (ESTAR_PAGES_HUGETLB == pages) {
+    ptr = mmap (NULL, grid->mapsize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (MAP_FAILED != ptr) {
+      return ptr;
+    }
+    // no (or not enough) reserved huge pages, try transparent ones
+  }
+#endif
+  
+  ptr = mmap (NULL, grid->mapsize, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == ptr) {
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  madvise (ptr, grid->mapsize, MADV_HUGEPAGE);
+#endif
+  return ptr;
+}
+
+
+static void * run_chunk (void * arg)
+{
+  chunk_t * chunk = arg;
+  chunk->fn (chunk->grid,
+	     chunk->grid->cell + chunk->begin,
+	     chunk->grid->cell + chunk->end,
+	     chunk->data);
+  return NULL;
+}
+
+
+static int nth_cpu (cpu_set_t const * allowed, size_t nn)
+{
+  int cpu;
+  for (cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET (cpu, allowed) && 0 == nn--) {
+      return cpu;
+    }
+  }
+  return -1;
+}
+
+
+void estar_grid_parallel (estar_grid_t * grid, estar_grid_fn_t fn, void * data)
+{
+  chunk_t chunk[ESTAR_GRID_MAXTHREADS];
+  pthread_t thread[ESTAR_GRID_MAXTHREADS];
+  int started[ESTAR_GRID_MAXTHREADS];
+  size_t nthreads, rowsize, ncpu, ii;
+  cpu_set_t allowed, cpu;
+  pthread_attr_t attr;
+  
+  nthreads = grid->nthreads < grid->tdimy ? grid->nthreads : grid->tdimy;
+  if (nthreads > ESTAR_GRID_MAXTHREADS) {
+    nthreads = ESTAR_GRID_MAXTHREADS;
+  }
+  if (nthreads <= 1) {
+    fn (grid, grid->cell, grid->cell + grid->ncells, data);
+    return;
+  }
+  
+  rowsize = grid->ncells / grid->tdimy;
+  for (ii = 0; ii < nthreads; ++ii) {
+    chunk[ii].grid = grid;
+    chunk[ii].begin = grid->tdimy * ii / nthreads * rowsize;
+    chunk[ii].end = grid->tdimy * (ii + 1) / nthreads * rowsize;
+    chunk[ii].fn = fn;
+    chunk[ii].data = data;
+  }
+  
+  // Pin every chunk, the first one included, to a CPU we are allowed
+  // to run on, so that later calls work on memory of the NUMA node
+  // which first touched it during initialization. The chunks get
+  // spread evenly over the allowed CPUs instead of taking the first
+  // few, which covers all nodes when CPUs are numbered node by node
+  // (as Linux usually does). Without affinity information, the
+  // calling thread takes the first chunk unpinned.
+  if (0 != sched_getaffinity (0, sizeof(allowed), &allowed)) {
+    CPU_ZERO (&allowed);
+  }
+  ncpu = CPU_COUNT (&allowed);
+  
+  started[0] = 0;
+  for (ii = 0 < ncpu ? 0 : 1; ii < nthreads; ++ii) {
+    pthread_attr_init (&attr);
+    if (ncpu > 0) {
+      CPU_ZERO (&cpu);
+      CPU_SET (nth_cpu (&allowed, ii * ncpu / nthreads), &cpu);
+      pthread_attr_setaffinity_np (&attr, sizeof(cpu), &cpu);
+    }
+    started[ii] = 0 == pthread_create (&thread[ii], &attr, run_chunk, &chunk[ii]);
+    if ( ! started[ii]) {
+      run_chunk (&chunk[ii]);	/* just do it ourselves */
+    }
+    pthread_attr_destroy (&attr);
+  }
+  if (0 == ncpu) {
+    run_chunk (&chunk[0]);
+  }
+  for (ii = 0; ii < nthreads; ++ii) {
+    if (started[ii]) {
+      pthread_join (thread[ii], NULL);
+    }
+  }
+}
+
+
+static void init_cells (estar_grid_t * grid,
+			estar_cell_t * begin, estar_cell_t * end,
+			void * data)
+{
+  size_t const dimx = grid->dimx;
+  size_t const dimy = grid->dimy;
+  size_t const tile = (size_t) 1 << grid->tshift;
+  size_t ix, iy, lx, ly;
+  estar_cell_t * cell;
+  estar_cell_t ** nbor;
+  
+  // Walk the cells in the order in which they are stored, so that
+  // each page gets written in one go (and by the thread that will
+  // later work on it). The indices are stepped along incrementally.
+  estar_grid_coords (grid, begin, &ix, &iy);
+  lx = ix & (tile - 1);
+  ly = iy & (tile - 1);
+  for (cell = begin; cell != end; ++cell) {
+    if (cell != begin) {
+      ++ix;
+      if (++lx == tile) {
+	lx = 0;
+	ix -= tile;
+	++iy;
+	if (++ly == tile) {
+	  ly = 0;
+	  ix += tile;
+	  iy -= tile;
+	  if (ix >= grid->tdimx << grid->tshift) {
+	    ix = 0;
+	    iy += tile;
+	  }
+	}
       }
-      if (iy > 0) {		/* south */
-	*(nbor++) = cell - dimx;
+    }
+    
+    cell->phi = INFINITY;
+    cell->rhs = INFINITY;
+    cell->key = INFINITY;
+    cell->pqi = 0;
+    
+    // Cells that only serve to pad the last row and column of tiles
+    // are never referenced by any neighbor, but initialize them
+    // anyway so that code which simply iterates over all allocated
+    // cells need not care about them.
+    if (ix >= dimx || iy >= dimy) {
+      cell->cost = INFINITY;
+      cell->flags = ESTAR_FLAG_OBSTACLE;
+      cell->nbor[0] = 0;
+#ifdef ESTAR_COMPACT
+      cell->nxnbor = 0;
+#else
+      cell->prop[0] = 0;
+#endif
+      continue;
+    }
+    
+    cell->cost = 1.0;
+    cell->flags = 0;
+    
+    nbor = cell->nbor;
+    if (ix > 0) {		/* west */
+      *(nbor++) = estar_grid_at(grid, ix - 1, iy);
+    }
+    if (ix < dimx - 1) {	/* east */
+      *(nbor++) = estar_grid_at(grid, ix + 1, iy);
+    }
+    if (iy > 0) {		/* south */
+      *(nbor++) = estar_grid_at(grid, ix, iy - 1);
+    }
+    if (iy < dimy - 1) {	/* north */
+      *(nbor++) = estar_grid_at(grid, ix, iy + 1);
+    }
+    *nbor = 0;
+    
+#ifdef ESTAR_COMPACT
+    cell->nxnbor = (ix > 0) + (ix < dimx - 1);
+#else
+    nbor = cell->prop;
+    if (ix > 0) {
+      if (iy > 0) {		/* south-west */
+	*(nbor++) = estar_grid_at(grid, ix - 1, iy);
+	*(nbor++) = estar_grid_at(grid, ix, iy - 1);
       }
-      if (iy < dimy - 1) {	/* north */
-	*(nbor++) = cell + dimx;
+      if (iy < dimy - 1) {	/* north-west */
+	*(nbor++) = estar_grid_at(grid, ix - 1, iy);
+	*(nbor++) = estar_grid_at(grid, ix, iy + 1);
       }
-      *nbor = 0;
-      
-      nbor = cell->prop;
-      if (ix > 0) {
-	if (iy > 0) {		/* south-west */
-	  *(nbor++) = cell - 1;
-	  *(nbor++) = cell - dimx;
-	}
-	if (iy < dimy - 1) {	/* north-west */
-	  *(nbor++) = cell - 1;
-	  *(nbor++) = cell + dimx;
-	}
+    }
+    if (ix < dimx - 1) {
+      if (iy > 0) {		/* south-east */
+	*(nbor++) = estar_grid_at(grid, ix + 1, iy);
+	*(nbor++) = estar_grid_at(grid, ix, iy - 1);
       }
-      if (ix < dimx - 1) {
-	if (iy > 0) {		/* south-east */
-	  *(nbor++) = cell + 1;
-	  *(nbor++) = cell - dimx;
-	}
-	if (iy < dimy - 1) {	/* north-east */
-	  *(nbor++) = cell + 1;
-	  *(nbor++) = cell + dimx;
-	}
+      if (iy < dimy - 1) {	/* north-east */
+	*(nbor++) = estar_grid_at(grid, ix + 1, iy);
+	*(nbor++) = estar_grid_at(grid, ix, iy + 1);
       }
-      *nbor = 0;
     }
+    *nbor = 0;
+#endif
+  }
+}
+
+
+void estar_grid_init (estar_grid_t * grid, size_t dimx, size_t dimy)
+{
+  estar_grid_conf_t conf;
+  estar_grid_conf_default (&conf);
+  estar_grid_init_conf (grid, dimx, dimy, &conf);
+}
+
+
+void estar_grid_init_conf (estar_grid_t * grid, size_t dimx, size_t dimy,
+			   estar_grid_conf_t const * conf)
+{
+  size_t tile;
+  
+  for (grid->tshift = 0, tile = 1; tile < conf->tile; tile <<= 1) {
+    ++grid->tshift;
+  }
+  if (tile != conf->tile) {
+    errx (EXIT_FAILURE, __FILE__": %s: tile size %zu is not a power of two",
+	  __func__, conf->tile);
   }
+  
+  if (0 == dimx || 0 == dimy) {
+    errx (EXIT_FAILURE, __FILE__": %s: empty grid", __func__);
+  }
+  grid->tdimx = (dimx + tile - 1) >> grid->tshift;
+  grid->tdimy = (dimy + tile - 1) >> grid->tshift;
+  grid->ncells = grid->tdimx * grid->tdimy * tile * tile;
+#ifdef ESTAR_COMPACT
+  if (grid->ncells >= (size_t) UINT32_MAX) {
+    errx (EXIT_FAILURE, __FILE__": %s: %zu cells are too many for compact cells",
+	  __func__, grid->ncells);
+  }
+#endif
+  grid->cell = alloc_cells (grid, conf->pages);
+  if (NULL == grid->cell) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  grid->dimx = dimx;
+  grid->dimy = dimy;
+  grid->nthreads = conf->nthreads;
+  if (grid->nthreads > ESTAR_GRID_MAXTHREADS) {
+    grid->nthreads = ESTAR_GRID_MAXTHREADS;
+  }
+  
+  estar_grid_parallel (grid, init_cells, NULL);
 }
 
 
 void estar_grid_fini (estar_grid_t * grid)
 {
-  free (grid->cell);
+  if (0 == grid->mapsize) {
+    free (grid->cell);
+  }
+  else {
+    munmap (grid->cell, grid->mapsize);
+  }
   grid->dimx = 0;
   grid->dimy = 0;
+  grid->ncells = 0;
 }
 
 
 void estar_grid_dump_cell (estar_grid_t * grid, estar_cell_t const * cell, char const * pfx)
 {
   size_t ix, iy;
-  ix = (cell - grid->cell) % grid->dimx;
-  iy = (cell - grid->cell) / grid->dimx;
+  estar_grid_coords (grid, cell, &ix, &iy);
   printf ("%s[%3zu  %3zu]  k: %4g  r: %4g  p: %4g\n",
 	  pfx, ix, iy, cell->key, cell->rhs, cell->phi);
 }
@@ -0,0 +1,143 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Binary min-heap on the key of the nodes, which also keep their own
+   index into the heap in pqi (zero meaning "not on the heap"), so that
+   they can be updated and removed in place. Index zero of the heap is
+   unused. Shared by the planners over 2D cells and over voxels: define
+   HEAP_NODE to the node type before including this file, which only
+   has static functions. */
+
+#ifndef HEAP_NODE
+# error "define HEAP_NODE before including heap.h"
+#endif
+
+
+static void swap (HEAP_NODE ** aa, HEAP_NODE ** bb)
+{
+  size_t ti;
+  HEAP_NODE *tc;
+  ti = (*aa)->pqi;
+  (*aa)->pqi = (*bb)->pqi;
+  (*bb)->pqi = ti;
+  tc = (*aa);
+  (*aa) = (*bb);
+  (*bb) = tc;
+}
+
+
+static void bubble_up (HEAP_NODE ** heap, size_t index)
+{
+  size_t parent;
+  parent = index / 2;
+  while ((parent > 0) && (heap[index]->key < heap[parent]->key)) {
+    swap (&heap[index], &heap[parent]);
+    index = parent;
+    parent = index / 2;
+  }
+}
+
+
+static void bubble_down (HEAP_NODE ** heap, size_t len, size_t index)
+{
+  size_t child, target;
+  
+  target = index;
+  while (1) {
+    child = 2 * index;
+    if (child <= len && heap[child]->key < heap[target]->key) {
+      target = child;
+    }
+    ++child;
+    if (child <= len && heap[child]->key < heap[target]->key) {
+      target = child;
+    }
+    if (index == target) {
+      break;
+    }
+    swap (&heap[target], &heap[index]);
+    index = target;
+  }
+}
+
+
+/* Restore the heap property after the key of a node on the heap
+   changed. */
+static void heap_update (HEAP_NODE ** heap, size_t len, HEAP_NODE * node)
+{
+  // could probably make it more efficient by only bubbling down when
+  // the bubble up did not change node->pqi
+  bubble_up (heap, node->pqi);
+  bubble_down (heap, len, node->pqi);
+}
+
+
+/* Append a node at index len, which the heap must have room for. */
+static void heap_insert (HEAP_NODE ** heap, size_t len, HEAP_NODE * node)
+{
+  heap[len] = node;
+  node->pqi = len;		/* initialize pqi */
+  bubble_up (heap, len);
+}
+
+
+/* Take a node that is on the heap off it, and return the new length. */
+static size_t heap_remove (HEAP_NODE ** heap, size_t len, HEAP_NODE * node)
+{
+  if (node->pqi != len) {
+    heap[node->pqi] = heap[len];
+    heap[node->pqi]->pqi = node->pqi; /* keep pqi consistent! */
+    // The node that took the place of the removed one comes from
+    // another branch of the heap, so it can be smaller than the new
+    // parent as well as bigger than the new children.
+    bubble_up (heap, node->pqi);
+    bubble_down (heap, len - 1, node->pqi);
+  }
+  node->pqi = 0;		/* mark node as not on heap */
+  return len - 1;
+}
+
+
+/* Take the top node off a heap that is not empty, and return it. */
+static HEAP_NODE * heap_extract (HEAP_NODE ** heap, size_t len)
+{
+  HEAP_NODE * node;
+  
+  node = heap[1];
+  node->pqi = 0;		/* mark node as not on heap */
+  if (len > 1) {
+    heap[1] = heap[len];
+    heap[1]->pqi = 1;		/* keep pqi consistent */
+    bubble_down (heap, len - 1, 1);
+  }
+  return node;
+}
@@ -0,0 +1,378 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/parallel.h>
+
+#include <stdlib.h>
+#include <math.h>
+#include <err.h>
+#include <pthread.h>
+
+
+typedef struct estar_worker_s {
+  estar_parallel_t * par;
+  estar_sub_t * sub;
+  pthread_t thread;
+} worker_t;
+
+
+static void * serve (void * arg);
+
+
+static size_t find (size_t const * split, size_t nn, size_t ii)
+{
+  size_t lo, hi, mid;
+  
+  // split[lo] <= ii < split[hi]
+  lo = 0;
+  hi = nn;
+  while (hi - lo > 1) {
+    mid = (lo + hi) / 2;
+    if (split[mid] <= ii) {
+      lo = mid;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+static estar_sub_t * owner (estar_parallel_t const * par, size_t ix, size_t iy)
+{
+  return &par->sub[find (par->ysplit, par->ny, iy) * par->nx
+		   + find (par->xsplit, par->nx, ix)];
+}
+
+
+static void init_sub (estar_parallel_t * par, size_t jx, size_t jy,
+		      estar_grid_conf_t const * conf)
+{
+  estar_sub_t * const sub = &par->sub[jy * par->nx + jx];
+  estar_cell_t * cell;
+  size_t dimx, dimy, ix, iy, gx, gy;
+  
+  sub->ox0 = par->xsplit[jx];
+  sub->ox1 = par->xsplit[jx + 1];
+  sub->oy0 = par->ysplit[jy];
+  sub->oy1 = par->ysplit[jy + 1];
+  sub->x0 = sub->ox0 - (jx > 0);
+  sub->y0 = sub->oy0 - (jy > 0);
+  dimx = sub->ox1 + (jx < par->nx - 1) - sub->x0;
+  dimy = sub->oy1 + (jy < par->ny - 1) - sub->y0;
+  estar_init_conf (&sub->estar, dimx, dimy, conf);
+  
+  sub->ghost = malloc (2 * (dimx + dimy) * 2 * sizeof(*sub->ghost));
+  if (NULL == sub->ghost) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  sub->nghosts = 0;
+  for (iy = 0; iy < dimy; ++iy) {
+    for (ix = 0; ix < dimx; ++ix) {
+      gx = sub->x0 + ix;
+      gy = sub->y0 + iy;
+      if (gx >= sub->ox0 && gx < sub->ox1 && gy >= sub->oy0 && gy < sub->oy1) {
+	continue;
+      }
+      // The corners of the border are not neighbors of any owned
+      // cell. They get flagged as well, but mirror nothing and stay
+      // at infinity.
+      cell = estar_grid_at (&sub->estar.grid, ix, iy);
+      cell->flags |= ESTAR_FLAG_GHOST;
+      if ((gx >= sub->ox0 && gx < sub->ox1) || (gy >= sub->oy0 && gy < sub->oy1)) {
+	sub->ghost[2 * sub->nghosts] = cell;
+	++sub->nghosts;
+      }
+    }
+  }
+  sub->topkey = INFINITY;
+  sub->npops = 0;
+  sub->nidle = 0;
+}
+
+
+void estar_parallel_init (estar_parallel_t * par, size_t dimx, size_t dimy,
+			  size_t nthreads, estar_grid_conf_t const * conf)
+{
+  estar_grid_conf_t subconf;
+  estar_sub_t * sub;
+  size_t ii, jj, gx, gy;
+  
+  if (0 == nthreads) {
+    nthreads = 1;
+  }
+  for (par->ny = 1, ii = 1; ii * ii <= nthreads; ++ii) {
+    if (0 == nthreads % ii) {
+      par->ny = ii;
+    }
+  }
+  par->nx = nthreads / par->ny;
+  if (dimy < dimx) {
+    ii = par->nx;
+    par->nx = par->ny;
+    par->ny = ii;
+  }
+  if (par->nx > dimx || par->ny > dimy) {
+    errx (EXIT_FAILURE, __FILE__": %s: %zu x %zu grid is too small for %zu subdomains",
+	  __func__, dimx, dimy, nthreads);
+  }
+  
+  par->dimx = dimx;
+  par->dimy = dimy;
+  par->xsplit = malloc ((par->nx + 1) * sizeof(*par->xsplit));
+  par->ysplit = malloc ((par->ny + 1) * sizeof(*par->ysplit));
+  par->sub = malloc (nthreads * sizeof(*par->sub));
+  if (NULL == par->xsplit || NULL == par->ysplit || NULL == par->sub) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  for (ii = 0; ii <= par->nx; ++ii) {
+    par->xsplit[ii] = dimx * ii / par->nx;
+  }
+  for (ii = 0; ii <= par->ny; ++ii) {
+    par->ysplit[ii] = dimy * ii / par->ny;
+  }
+  
+  subconf = *conf;
+  subconf.nthreads = 1;
+  for (jj = 0; jj < par->ny; ++jj) {
+    for (ii = 0; ii < par->nx; ++ii) {
+      init_sub (par, ii, jj, &subconf);
+    }
+  }
+  
+  // with all subdomains in place, look up what the ghosts mirror
+  for (ii = 0; ii < nthreads; ++ii) {
+    sub = &par->sub[ii];
+    for (jj = 0; jj < sub->nghosts; ++jj) {
+      estar_grid_coords (&sub->estar.grid, sub->ghost[2 * jj], &gx, &gy);
+      gx += sub->x0;
+      gy += sub->y0;
+      sub->ghost[2 * jj + 1] = estar_parallel_cell (par, gx, gy);
+    }
+  }
+  
+  par->window = 0.5;
+  par->nrounds = 0;
+  
+  // The workers wait at the barrier for the next propagation, or for
+  // estar_parallel_fini() to tell them to quit.
+  par->quit = 0;
+  par->scale = 1.0;
+  par->worker = malloc (nthreads * sizeof(*par->worker));
+  if (NULL == par->worker) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  if (nthreads > 1) {
+    pthread_barrier_init (&par->barrier, NULL, nthreads);
+  }
+  for (ii = 0; ii < nthreads; ++ii) {
+    par->worker[ii].par = par;
+    par->worker[ii].sub = &par->sub[ii];
+    if (ii > 0 && 0 != pthread_create (&par->worker[ii].thread, NULL, serve, &par->worker[ii])) {
+      errx (EXIT_FAILURE, __FILE__": %s: pthread_create", __func__);
+    }
+  }
+}
+
+
+void estar_parallel_fini (estar_parallel_t * par)
+{
+  size_t const nsubs = par->nx * par->ny;
+  size_t ii;
+  
+  if (nsubs > 1) {
+    par->quit = 1;
+    pthread_barrier_wait (&par->barrier);
+    for (ii = 1; ii < nsubs; ++ii) {
+      pthread_join (par->worker[ii].thread, NULL);
+    }
+    pthread_barrier_destroy (&par->barrier);
+  }
+  free (par->worker);
+  par->worker = NULL;
+  
+  for (ii = 0; ii < nsubs; ++ii) {
+    estar_fini (&par->sub[ii].estar);
+    free (par->sub[ii].ghost);
+  }
+  free (par->sub);
+  free (par->xsplit);
+  free (par->ysplit);
+  par->sub = NULL;
+  par->xsplit = NULL;
+  par->ysplit = NULL;
+}
+
+
+int estar_parallel_set_goal (estar_parallel_t * par, size_t ix, size_t iy)
+{
+  estar_sub_t * const sub = owner (par, ix, iy);
+  return estar_set_goal (&sub->estar, ix - sub->x0, iy - sub->y0);
+}
+
+
+int estar_parallel_set_speed (estar_parallel_t * par, size_t ix, size_t iy, double speed)
+{
+  estar_sub_t * const sub = owner (par, ix, iy);
+  return estar_set_speed (&sub->estar, ix - sub->x0, iy - sub->y0, speed);
+}
+
+
+estar_cell_t * estar_parallel_cell (estar_parallel_t const * par, size_t ix, size_t iy)
+{
+  estar_sub_t const * const sub = owner (par, ix, iy);
+  return estar_grid_at (&sub->estar.grid, ix - sub->x0, iy - sub->y0);
+}
+
+
+/* Copy the phi of the mirrored cells into the ghosts and queue those
+   that changed. Only ever writes to the subdomain itself, and the
+   cells it reads are not written by anyone while this runs. */
+static void pull (estar_sub_t * sub)
+{
+  estar_cell_t * ghost;
+  estar_cell_t const * cell;
+  size_t ii;
+  
+  for (ii = 0; ii < sub->nghosts; ++ii) {
+    ghost = sub->ghost[2 * ii];
+    cell = sub->ghost[2 * ii + 1];
+    if (ghost->rhs != cell->phi) {
+      ghost->rhs = cell->phi;
+      estar_update (&sub->estar, ghost);
+    }
+  }
+  sub->topkey = 0 == sub->estar.pq.len ? INFINITY : estar_pqueue_topkey (&sub->estar.pq);
+}
+
+
+/* One propagation, in the thread of the given subdomain. */
+static void work (worker_t const * wk)
+{
+  estar_parallel_t * const par = wk->par;
+  estar_sub_t * const sub = wk->sub;
+  estar_t * const estar = &sub->estar;
+  double bound;
+  size_t ii, npops;
+  
+  // The topkey of every subdomain is published before the barrier
+  // that ends a round and only read after it, and it is not written
+  // again before the barrier in the middle of the next round, by
+  // which time every thread is done reading. After the last round,
+  // the threads only read topkeys that nobody writes until the
+  // barrier at the start of the next propagation.
+  pull (sub);
+  pthread_barrier_wait (&par->barrier);
+  for (;;) {
+    bound = INFINITY;
+    for (ii = 0; ii < par->nx * par->ny; ++ii) {
+      if (par->sub[ii].topkey < bound) {
+	bound = par->sub[ii].topkey;
+      }
+    }
+    if (isinf (bound)) {
+      break;
+    }
+    if (sub == par->sub) {
+      ++par->nrounds;
+    }
+    bound += par->window * par->scale;
+    
+    for (npops = 0; 0 != estar->pq.len && estar_pqueue_topkey (&estar->pq) <= bound; ++npops) {
+      estar_propagate (estar);
+    }
+    sub->npops += npops;
+    if (0 == npops) {
+      ++sub->nidle;
+    }
+    pthread_barrier_wait (&par->barrier);
+    pull (sub);
+    pthread_barrier_wait (&par->barrier);
+  }
+}
+
+
+/* Body of the worker threads. Whatever the caller of
+   estar_parallel_propagate() or estar_parallel_fini() wrote before
+   the barrier is visible after it. */
+static void * serve (void * arg)
+{
+  worker_t const * const wk = arg;
+  
+  for (;;) {
+    pthread_barrier_wait (&wk->par->barrier);
+    if (wk->par->quit) {
+      break;
+    }
+    work (wk);
+  }
+  return NULL;
+}
+
+
+size_t estar_parallel_propagate (estar_parallel_t * par)
+{
+  size_t const nsubs = par->nx * par->ny;
+  size_t ii, npops;
+  double scale;
+  
+  par->nrounds = 0;
+  if (1 == nsubs) {
+    for (npops = 0; 0 != par->sub->estar.pq.len; ++npops) {
+      estar_propagate (&par->sub->estar);
+    }
+    par->sub->npops = npops;
+    par->sub->nidle = 0;
+    return npops;
+  }
+  
+  scale = INFINITY;
+  for (ii = 0; ii < nsubs; ++ii) {
+    if (par->sub[ii].estar.focus.scale < scale) {
+      scale = par->sub[ii].estar.focus.scale;
+    }
+    par->sub[ii].npops = 0;
+    par->sub[ii].nidle = 0;
+  }
+  par->scale = scale;
+  
+  // wake up the workers, and take the first subdomain ourselves
+  pthread_barrier_wait (&par->barrier);
+  work (&par->worker[0]);
+  
+  npops = 0;
+  for (ii = 0; ii < nsubs; ++ii) {
+    npops += par->sub[ii].npops;
+  }
+  return npops;
+}
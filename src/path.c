@@ -0,0 +1,350 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/path.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <err.h>
+
+
+/* How far past a cell boundary each point gets placed, in cells. */
+#define EPSILON 1e-6
+
+
+/* Where the points go. Only the path cache keeps more than xy: the
+   values that the step from each point depends on, see step(). */
+typedef struct {
+  double * xy;
+  double * deps;
+} sink_t;
+
+
+/* Returned by step() when there is one. */
+#define STEP -1
+
+
+/* The cell whose center is nearest to xy, or NULL outside the grid. */
+static estar_cell_t * nearest (estar_grid_t const * grid, double const * xy)
+{
+  long const ix = lrint (xy[0]);
+  long const iy = lrint (xy[1]);
+  if (ix < 0 || ix >= (long) grid->dimx || iy < 0 || iy >= (long) grid->dimy) {
+    return NULL;
+  }
+  return estar_grid_at (grid, ix, iy);
+}
+
+
+/* The rhs and gradient of a cell. The gradient is left at zero if
+   there is none. */
+static void look (estar_cell_t * cell, double * rhs, double * grad)
+{
+  grad[0] = 0.0;
+  grad[1] = 0.0;
+  if (NULL == cell) {
+    *rhs = INFINITY;
+  }
+  else {
+    *rhs = cell->rhs;
+    if ( ! isinf (cell->rhs) && 0 == estar_cell_calc_gradient (cell, &grad[0], &grad[1])) {
+      grad[0] = 0.0;
+      grad[1] = 0.0;
+    }
+  }
+}
+
+
+/* Where a straight line along the gradient leaves the cell around xy.
+   Returns the axis of the boundary it crosses there. */
+static int leave (double const * xy, double const * grad, double len, double * to)
+{
+  double tt, tmax;
+  int axis, cross;
+  
+  tmax = INFINITY;
+  cross = 0;
+  for (axis = 0; axis < 2; ++axis) {
+    if (grad[axis] > 0.0) {
+      tt = (rint (xy[axis]) + 0.5 - xy[axis]) * len / grad[axis];
+    }
+    else if (grad[axis] < 0.0) {
+      tt = (rint (xy[axis]) - 0.5 - xy[axis]) * len / grad[axis];
+    }
+    else {
+      continue;
+    }
+    if (tt < tmax) {
+      tmax = tt;
+      cross = axis;
+    }
+  }
+  tmax += EPSILON;
+  to[0] = xy[0] + tmax * grad[0] / len;
+  to[1] = xy[1] + tmax * grad[1] / len;
+  return cross;
+}
+
+
+/* Find the next point after xy. Returns STEP and sets to if there is
+   one, otherwise ESTAR_PATH_GOAL or ESTAR_PATH_STUCK. The result only
+   depends on xy and on the values stored in deps, which is what the
+   path cache checks: the rhs of this cell, the next one, the one
+   beside it, and of the neighbors of this cell, and the gradients of
+   this cell and the next one. */
+static int step (estar_grid_t const * grid, double const * xy, double * to, double * deps)
+{
+  double * const rhs = deps;
+  double * const grad = deps + 7;
+  estar_cell_t * cell;
+  estar_cell_t * best;
+  double side[2], len, plen, slide;
+  size_t ii, ix, iy;
+  int aa, bb;
+  
+  cell = nearest (grid, xy);
+  look (cell, &rhs[0], &grad[0]);
+  for (ii = 1; ii < 7; ++ii) {
+    rhs[ii] = INFINITY;
+  }
+  grad[2] = grad[3] = 0.0;
+  if (NULL == cell || isinf (rhs[0])) {
+    return ESTAR_PATH_STUCK;
+  }
+  if (cell->flags & ESTAR_FLAG_GOAL) {
+    return ESTAR_PATH_GOAL;
+  }
+  
+  len = sqrt (grad[0] * grad[0] + grad[1] * grad[1]);
+  if (len > 0.0) {
+    aa = leave (xy, grad, len, to);
+    look (nearest (grid, to), &rhs[1], &grad[2]);
+    if (grad[aa] * grad[2 + aa] >= 0.0 && ! isinf (rhs[1])) {
+      if (rhs[1] < rhs[0]) {
+	return STEP;
+      }
+    }
+    else {
+      // The gradient of the next cell points right back, so the path
+      // has run into a valley along the boundary between the two.
+      // Slide along it (on this side) to the cell beside this one, in
+      // the mean direction of the two gradients. Obstacles, cells at
+      // infinity, and the edge of the grid are walls to slide along.
+      bb = 1 - aa;
+      plen = sqrt (grad[2] * grad[2] + grad[3] * grad[3]);
+      slide = grad[bb] / len;
+      if (plen > 0.0) {
+	slide += grad[2 + bb] / plen;
+      }
+      if (0.0 != slide) {
+	side[aa] = grad[aa] > 0.0
+	  ? rint (xy[aa]) + 0.5 - EPSILON : rint (xy[aa]) - 0.5 + EPSILON;
+	side[bb] = slide > 0.0
+	  ? rint (xy[bb]) + 0.5 + EPSILON : rint (xy[bb]) - 0.5 - EPSILON;
+	best = nearest (grid, side);
+	rhs[2] = NULL == best ? INFINITY : best->rhs;
+	if (rhs[2] < rhs[0]) {
+	  to[0] = side[0];
+	  to[1] = side[1];
+	  return STEP;
+	}
+      }
+    }
+  }
+  
+  // Where following the gradient does not lead any further down (which
+  // happens in narrow passages), go to the center of the neighbor with
+  // the lowest rhs. There always is a lower one, so this cannot loop.
+  best = NULL;
+  for (ii = 0; NULL != cell->nbor[ii]; ++ii) {
+    rhs[3 + ii] = cell->nbor[ii]->rhs;
+    if (NULL == best || rhs[3 + ii] < best->rhs) {
+      best = cell->nbor[ii];
+    }
+  }
+  if (NULL == best || best->rhs >= rhs[0]) {
+    return ESTAR_PATH_STUCK;
+  }
+  estar_grid_coords (grid, best, &ix, &iy);
+  to[0] = ix;
+  to[1] = iy;
+  return STEP;
+}
+
+
+/* Continue from point ii, which has already been stored. */
+static int trace (estar_grid_t const * grid, sink_t const * sink,
+		  size_t ii, size_t maxpoints, size_t * npoints)
+{
+  double to[2], deps[ESTAR_PATH_NDEPS];
+  int status;
+  
+  for (;;) {
+    status = step (grid, &sink->xy[2 * ii], to, deps);
+    if (NULL != sink->deps) {
+      memcpy (&sink->deps[ESTAR_PATH_NDEPS * ii], deps, sizeof(deps));
+    }
+    if (STEP != status) {
+      break;
+    }
+    if (ii + 1 >= maxpoints) {
+      status = ESTAR_PATH_FULL;
+      break;
+    }
+    ++ii;
+    sink->xy[2 * ii] = to[0];
+    sink->xy[2 * ii + 1] = to[1];
+  }
+  
+  *npoints = ii + 1;
+  return status;
+}
+
+
+static int trace_from (estar_grid_t const * grid, double x, double y,
+		       sink_t const * sink, size_t maxpoints, size_t * npoints)
+{
+  if (0 == maxpoints) {
+    *npoints = 0;
+    return ESTAR_PATH_FULL;
+  }
+  sink->xy[0] = x;
+  sink->xy[1] = y;
+  return trace (grid, sink, 0, maxpoints, npoints);
+}
+
+
+/* Whether the cell of point ii or one of its neighbors has changed
+   since the path was traced, judging by the stamps. Everything the
+   step from the point depends on lies in there, gradients included,
+   because a change of rhs also stamps the neighbors. */
+static int touched (estar_t const * estar, estar_path_t const * path, size_t ii)
+{
+  long const ix = lrint (path->xy[2 * ii]);
+  long const iy = lrint (path->xy[2 * ii + 1]);
+  if (ix < 0 || ix >= (long) estar->grid.dimx || iy < 0 || iy >= (long) estar->grid.dimy) {
+    return 0;
+  }
+  return estar_changed_since (estar, ix > 0 ? ix - 1 : 0, iy > 0 ? iy - 1 : 0,
+			      ix + 2 < (long) estar->grid.dimx ? ix + 2 : estar->grid.dimx,
+			      iy + 2 < (long) estar->grid.dimy ? iy + 2 : estar->grid.dimy,
+			      path->version);
+}
+
+
+/* Whether the step from point ii would still be the same. */
+static int unchanged (estar_grid_t const * grid, estar_path_t const * path, size_t ii)
+{
+  double to[2], deps[ESTAR_PATH_NDEPS];
+  
+  step (grid, &path->xy[2 * ii], to, deps);
+  return 0 == memcmp (deps, &path->deps[ESTAR_PATH_NDEPS * ii], sizeof(deps));
+}
+
+
+int estar_trace_path (estar_grid_t const * grid, double x, double y,
+		      double * xy, size_t maxpoints, size_t * npoints)
+{
+  sink_t sink;
+  
+  memset (&sink, 0, sizeof(sink));
+  sink.xy = xy;
+  return trace_from (grid, x, y, &sink, maxpoints, npoints);
+}
+
+
+void estar_path_init (estar_path_t * path, size_t maxpoints)
+{
+  path->xy = malloc (sizeof(double) * (2 + ESTAR_PATH_NDEPS) * (maxpoints + 1));
+  if (NULL == path->xy) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  path->deps = path->xy + 2 * (maxpoints + 1);
+  path->npoints = 0;
+  path->maxpoints = maxpoints;
+  path->status = ESTAR_PATH_STUCK;
+  path->version = 0;
+  path->nsteps = 0;
+}
+
+
+void estar_path_fini (estar_path_t * path)
+{
+  free (path->xy);
+  path->xy = NULL;
+}
+
+
+int estar_path_update (estar_path_t * path, estar_t const * estar, double x, double y)
+{
+  estar_grid_t const * grid = &estar->grid;
+  sink_t sink;
+  size_t ii;
+  
+  sink.xy = path->xy;
+  sink.deps = path->deps;
+  
+  if (0 == path->npoints || x != path->xy[0] || y != path->xy[1]) {
+    path->status = trace_from (grid, x, y, &sink, path->maxpoints, &path->npoints);
+    path->nsteps = path->npoints;
+    path->version = estar->version;
+    return path->status;
+  }
+  
+  path->nsteps = 0;
+  if (estar->version == path->version) {
+    return path->status;
+  }
+  
+  // The status comes from the step of the last point (its goal flag
+  // shows in its rhs), so it stays the same unless that point gets
+  // touched as well.
+  for (ii = 0; ii < path->npoints; ++ii) {
+    if ( ! touched (estar, path, ii)) {
+      continue;
+    }
+    if (ii == path->npoints - 1) {
+      break;
+    }
+    ++path->nsteps;
+    if ( ! unchanged (grid, path, ii)) {
+      break;
+    }
+  }
+  path->version = estar->version;
+  if (ii < path->npoints) {
+    path->status = trace (grid, &sink, ii, path->maxpoints, &path->npoints);
+    path->nsteps += path->npoints - ii;
+  }
+  return path->status;
+}
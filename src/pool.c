@@ -0,0 +1,451 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/pool.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include <time.h>
+
+
+static double now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+
+typedef struct {
+  estar_pool_t * pool;
+  size_t index;
+} worker_t;
+
+
+static void push_back (estar_job_t ** head, estar_job_t ** tail, estar_job_t * job)
+{
+  job->next = NULL;
+  job->prev = *tail;
+  if (NULL != *tail) {
+    (*tail)->next = job;
+  }
+  else {
+    *head = job;
+  }
+  *tail = job;
+}
+
+
+static estar_job_t * pop_front (estar_job_t ** head, estar_job_t ** tail)
+{
+  estar_job_t * job = *head;
+  if (NULL != job) {
+    *head = job->next;
+    if (NULL != *head) {
+      (*head)->prev = NULL;
+    }
+    else {
+      *tail = NULL;
+    }
+  }
+  return job;
+}
+
+
+static estar_job_t * pop_back (estar_job_t ** head, estar_job_t ** tail)
+{
+  estar_job_t * job = *tail;
+  if (NULL != job) {
+    *tail = job->prev;
+    if (NULL != *tail) {
+      (*tail)->next = NULL;
+    }
+    else {
+      *head = NULL;
+    }
+  }
+  return job;
+}
+
+
+/* Wake up one sleeping worker for one more job that can run. Must be
+   called with the pool mutex held. */
+static void signal_work (estar_pool_t * pool)
+{
+  ++pool->seq;
+  pthread_cond_signal (&pool->work);
+}
+
+
+/* Hands out a planner for a job that is about to start, preferably a
+   recycled one. Called without holding the pool mutex, except for
+   the free list itself. */
+static estar_pool_instance_t * acquire (estar_pool_t * pool, size_t dimx, size_t dimy)
+{
+  estar_pool_instance_t ** pp;
+  estar_pool_instance_t * inst;
+  
+  pthread_mutex_lock (&pool->mutex);
+  for (pp = &pool->free; NULL != *pp; pp = &(*pp)->next) {
+    if ((*pp)->estar.grid.dimx == dimx && (*pp)->estar.grid.dimy == dimy) {
+      break;
+    }
+  }
+  inst = *pp;
+  if (NULL != inst) {
+    *pp = inst->next;
+    --pool->nfree;
+  }
+  else {
+    ++pool->ninstances;
+  }
+  pthread_mutex_unlock (&pool->mutex);
+  
+  if (NULL != inst) {
+    // estar_reset() keeps all of this, but it belongs to the last
+    // job. Its recorder and profile may be gone already, so they get
+    // dropped before anything can write to them.
+    inst->estar.recorder = NULL;
+    estar_set_profile (&inst->estar, NULL);
+    estar_reset (&inst->estar);
+    estar_clear_focus (&inst->estar);
+    estar_set_roi (&inst->estar, NULL, 0);
+    estar_set_speed_source (&inst->estar, NULL, NULL);
+  }
+  else {
+    inst = malloc (sizeof(*inst));
+    if (NULL == inst) {
+      errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+    }
+    estar_init_conf (&inst->estar, dimx, dimy, &pool->conf);
+  }
+  inst->next = NULL;
+  
+  return inst;
+}
+
+
+/* The next job for a worker: a new one from the inbox if there is
+   room for it, a started one from its own deque, or one stolen from
+   another deque, in that order. Returns NULL if there is none. */
+static estar_job_t * take (estar_pool_t * pool, size_t index)
+{
+  estar_pool_deque_t * dq;
+  estar_job_t * job;
+  size_t ii;
+  
+  job = NULL;
+  pthread_mutex_lock (&pool->mutex);
+  if (pool->active < pool->max_active) {
+    job = pop_front (&pool->inbox_head, &pool->inbox_tail);
+    if (NULL != job) {
+      ++pool->active;
+    }
+  }
+  pthread_mutex_unlock (&pool->mutex);
+  if (NULL != job) {
+    job->inst = acquire (pool, job->dimx, job->dimy);
+    job->setup (&job->inst->estar, job->data);
+    return job;
+  }
+  
+  dq = &pool->deque[index];
+  pthread_mutex_lock (&dq->mutex);
+  job = pop_front (&dq->head, &dq->tail);
+  pthread_mutex_unlock (&dq->mutex);
+  if (NULL != job) {
+    return job;
+  }
+  
+  for (ii = 1; ii < pool->nthreads; ++ii) {
+    dq = &pool->deque[(index + ii) % pool->nthreads];
+    pthread_mutex_lock (&dq->mutex);
+    job = pop_back (&dq->head, &dq->tail);
+    pthread_mutex_unlock (&dq->mutex);
+    if (NULL != job) {
+      return job;
+    }
+  }
+  
+  return NULL;
+}
+
+
+/* Put a planner on the free list, and return the least recently used
+   one if that makes the list longer than max_free. Must be called
+   with the pool mutex held. */
+static estar_pool_instance_t * recycle (estar_pool_t * pool, estar_pool_instance_t * inst)
+{
+  estar_pool_instance_t ** pp;
+  
+  inst->next = pool->free;
+  pool->free = inst;
+  if (++pool->nfree <= pool->max_free) {
+    return NULL;
+  }
+  for (pp = &pool->free; NULL != (*pp)->next; pp = &(*pp)->next) {
+    /* find the last one */
+  }
+  inst = *pp;
+  *pp = NULL;
+  --pool->nfree;
+  --pool->ninstances;
+  return inst;
+}
+
+
+/* Runs one slice of a job, and either finishes it or puts it back on
+   the deque of the worker. */
+static void run (estar_pool_t * pool, size_t index, estar_job_t * job)
+{
+  estar_t * estar = &job->inst->estar;
+  estar_pool_instance_t * evicted;
+  estar_pool_deque_t * dq;
+  size_t nn;
+  double latency;
+  int more;
+  
+  for (nn = 0; nn < pool->budget && 0 != estar->pq.len; ++nn) {
+    estar_propagate (estar);
+  }
+  job->npops += nn;
+  ++job->nslices;
+  
+  if (0 != estar->pq.len) {
+    dq = &pool->deque[index];
+    pthread_mutex_lock (&dq->mutex);
+    push_back (&dq->head, &dq->tail, job);
+    more = dq->head != job;
+    pthread_mutex_unlock (&dq->mutex);
+    pthread_mutex_lock (&pool->mutex);
+    if (more || (NULL != pool->inbox_head && pool->active < pool->max_active)) {
+      signal_work (pool);
+    }
+    pthread_mutex_unlock (&pool->mutex);
+    return;
+  }
+  
+  job->done (estar, job->data);
+  latency = now () - job->submitted;
+  
+  // The room this makes for another job from the inbox is taken by
+  // this worker itself.
+  pthread_mutex_lock (&pool->mutex);
+  evicted = recycle (pool, job->inst);
+  job->inst = NULL;
+  pool->latency[pool->nlatency++ % ESTAR_POOL_NLATENCY] = latency;
+  --pool->active;
+  --pool->pending;
+  if (0 == pool->pending) {
+    pthread_cond_broadcast (&pool->idle);
+  }
+  pthread_mutex_unlock (&pool->mutex);
+  
+  if (NULL != evicted) {
+    estar_fini (&evicted->estar);
+    free (evicted);
+  }
+}
+
+
+static void * work (void * arg)
+{
+  worker_t * wk = arg;
+  estar_pool_t * pool = wk->pool;
+  estar_job_t * job;
+  unsigned long seq;
+  
+  for (;;) {
+    pthread_mutex_lock (&pool->mutex);
+    seq = pool->seq;
+    if (pool->quit) {
+      pthread_mutex_unlock (&pool->mutex);
+      break;
+    }
+    pthread_mutex_unlock (&pool->mutex);
+    
+    job = take (pool, wk->index);
+    if (NULL != job) {
+      run (pool, wk->index, job);
+      continue;
+    }
+    
+    // Nothing to do. Sleep until somebody signals, unless that
+    // already happened while we were looking.
+    pthread_mutex_lock (&pool->mutex);
+    while (seq == pool->seq && ! pool->quit) {
+      pthread_cond_wait (&pool->work, &pool->mutex);
+    }
+    pthread_mutex_unlock (&pool->mutex);
+  }
+  
+  free (wk);
+  return NULL;
+}
+
+
+void estar_pool_init (estar_pool_t * pool, size_t nthreads,
+		      estar_grid_conf_t const * conf)
+{
+  worker_t * wk;
+  size_t ii;
+  
+  if (0 == nthreads) {
+    nthreads = 1;
+  }
+  memset (pool, 0, sizeof(*pool));
+  pool->nthreads = nthreads;
+  pool->budget = 1024;
+  pool->max_active = 2 * nthreads;
+  pool->max_free = pool->max_active;
+  if (NULL != conf) {
+    pool->conf = *conf;
+  }
+  else {
+    estar_grid_conf_default (&pool->conf);
+  }
+  pthread_mutex_init (&pool->mutex, NULL);
+  pthread_cond_init (&pool->work, NULL);
+  pthread_cond_init (&pool->idle, NULL);
+  
+  pool->thread = malloc (nthreads * sizeof(*pool->thread));
+  pool->deque = calloc (nthreads, sizeof(*pool->deque));
+  if (NULL == pool->thread || NULL == pool->deque) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  for (ii = 0; ii < nthreads; ++ii) {
+    pthread_mutex_init (&pool->deque[ii].mutex, NULL);
+  }
+  for (ii = 0; ii < nthreads; ++ii) {
+    wk = malloc (sizeof(*wk));
+    if (NULL == wk) {
+      errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+    }
+    wk->pool = pool;
+    wk->index = ii;
+    if (0 != pthread_create (&pool->thread[ii], NULL, work, wk)) {
+      errx (EXIT_FAILURE, __FILE__": %s: pthread_create", __func__);
+    }
+  }
+}
+
+
+void estar_pool_fini (estar_pool_t * pool)
+{
+  estar_pool_instance_t * inst;
+  size_t ii;
+  
+  estar_pool_wait (pool);
+  pthread_mutex_lock (&pool->mutex);
+  pool->quit = 1;
+  pthread_cond_broadcast (&pool->work);
+  pthread_mutex_unlock (&pool->mutex);
+  for (ii = 0; ii < pool->nthreads; ++ii) {
+    pthread_join (pool->thread[ii], NULL);
+    pthread_mutex_destroy (&pool->deque[ii].mutex);
+  }
+  
+  while (NULL != pool->free) {
+    inst = pool->free;
+    pool->free = inst->next;
+    estar_fini (&inst->estar);
+    free (inst);
+  }
+  free (pool->thread);
+  free (pool->deque);
+  pthread_cond_destroy (&pool->idle);
+  pthread_cond_destroy (&pool->work);
+  pthread_mutex_destroy (&pool->mutex);
+}
+
+
+void estar_pool_submit (estar_pool_t * pool, estar_job_t * job)
+{
+  job->inst = NULL;
+  job->submitted = now ();
+  job->npops = 0;
+  job->nslices = 0;
+  
+  pthread_mutex_lock (&pool->mutex);
+  push_back (&pool->inbox_head, &pool->inbox_tail, job);
+  ++pool->pending;
+  signal_work (pool);
+  pthread_mutex_unlock (&pool->mutex);
+}
+
+
+void estar_pool_wait (estar_pool_t * pool)
+{
+  pthread_mutex_lock (&pool->mutex);
+  while (0 != pool->pending) {
+    pthread_cond_wait (&pool->idle, &pool->mutex);
+  }
+  pthread_mutex_unlock (&pool->mutex);
+}
+
+
+static int compare_double (void const * lhs, void const * rhs)
+{
+  double const aa = *(double const *) lhs;
+  double const bb = *(double const *) rhs;
+  return aa < bb ? -1 : aa > bb;
+}
+
+
+void estar_pool_latency (estar_pool_t * pool, double * p50, double * p99)
+{
+  double sample[ESTAR_POOL_NLATENCY];
+  size_t nn;
+  
+  pthread_mutex_lock (&pool->mutex);
+  nn = pool->nlatency < ESTAR_POOL_NLATENCY ? pool->nlatency : ESTAR_POOL_NLATENCY;
+  memcpy (sample, pool->latency, nn * sizeof(*sample));
+  pthread_mutex_unlock (&pool->mutex);
+  
+  if (0 == nn) {
+    *p50 = 0.0;
+    *p99 = 0.0;
+    return;
+  }
+  qsort (sample, nn, sizeof(*sample), compare_double);
+  *p50 = sample[(nn - 1) / 2];
+  *p99 = sample[(99 * (nn - 1)) / 100];
+}
+
+
+void estar_pool_clear_latency (estar_pool_t * pool)
+{
+  pthread_mutex_lock (&pool->mutex);
+  pool->nlatency = 0;
+  pthread_mutex_unlock (&pool->mutex);
+}
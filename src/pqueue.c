@@ -42,52 +42,8 @@
 #define CALC_KEY(cell) ((cell)->rhs < (cell)->phi ? (cell)->rhs : (cell)->phi)
 
 
-static void swap (estar_cell_t ** aa, estar_cell_t ** bb)
-{
-  size_t ti;
-  estar_cell_t *tc;
-  ti = (*aa)->pqi;
-  (*aa)->pqi = (*bb)->pqi;
-  (*bb)->pqi = ti;
-  tc = (*aa);
-  (*aa) = (*bb);
-  (*bb) = tc;
-}
-
-
-static void bubble_up (estar_cell_t ** heap, size_t index)
-{
-  size_t parent;
-  parent = index / 2;
-  while ((parent > 0) && (heap[index]->key < heap[parent]->key)) {
-    swap (&heap[index], &heap[parent]);
-    index = parent;
-    parent = index / 2;
-  }
-}
-
-
-static void bubble_down (estar_cell_t ** heap, size_t len, size_t index)
-{
-  size_t child, target;
-  
-  target = index;
-  while (1) {
-    child = 2 * index;
-    if (child <= len && heap[child]->key < heap[target]->key) {
-      target = child;
-    }
-    ++child;
-    if (child <= len && heap[child]->key < heap[target]->key) {
-      target = child;
-    }
-    if (index == target) {
-      break;
-    }
-    swap (&heap[target], &heap[index]);
-    index = target;
-  }
-}
+#define HEAP_NODE estar_cell_t
+#include "heap.h"
 
 
 void estar_pqueue_init (estar_pqueue_t * pq, size_t cap)
@@ -98,6 +54,10 @@ void estar_pqueue_init (estar_pqueue_t * pq, size_t cap)
   }
   pq->len = 0;
   pq->cap = cap;
+  pq->mincap = cap;
+  pq->fixed = 0;
+  pq->bias = NULL;
+  pq->bias_data = NULL;
 }
 
 
@@ -109,6 +69,47 @@ void estar_pqueue_fini (estar_pqueue_t * pq)
 }
 
 
+int estar_pqueue_reserve (estar_pqueue_t * pq, size_t cap)
+{
+  estar_cell_t ** heap;
+  
+  if (cap > pq->cap) {
+    heap = realloc (pq->heap, sizeof(estar_cell_t*) * (cap+1));
+    if (NULL == heap) {
+      return ESTAR_ENOMEM;
+    }
+    pq->heap = heap;
+    pq->cap = cap;
+  }
+  pq->fixed = 1;
+  return ESTAR_OK;
+}
+
+
+static void shrink (estar_pqueue_t * pq)
+{
+  size_t cap;
+  estar_cell_t ** heap;
+  
+  // Leave a gap between the fill levels at which we grow and shrink,
+  // so that a queue hovering around some size does not keep getting
+  // reallocated. After halving, it takes twice the current number of
+  // cells before the next growth.
+  if (pq->fixed || pq->cap <= pq->mincap || pq->len >= pq->cap / 4) {
+    return;
+  }
+  cap = pq->cap / 2;
+  if (cap < pq->mincap) {
+    cap = pq->mincap;
+  }
+  heap = realloc (pq->heap, sizeof(estar_cell_t*) * (cap+1));
+  if (NULL != heap) {		/* otherwise just keep the bigger one */
+    pq->heap = heap;
+    pq->cap = cap;
+  }
+}
+
+
 double estar_pqueue_topkey (estar_pqueue_t * pq)
 {
   if (pq->len > 0) {
@@ -118,18 +119,39 @@ double estar_pqueue_topkey (estar_pqueue_t * pq)
 }
 
 
-void estar_pqueue_insert_or_update (estar_pqueue_t * pq, estar_cell_t * cell)
+double estar_pqueue_calc_key (estar_pqueue_t * pq, estar_cell_t const * cell)
+{
+  if (NULL == pq->bias) {
+    return CALC_KEY(cell);
+  }
+  // rounded to what the cell can store, so that callers can compare
+  // it to keys on the queue
+  return (estar_real_t) (CALC_KEY(cell) + pq->bias (pq->bias_data, cell));
+}
+
+
+void estar_pqueue_rekey (estar_pqueue_t * pq)
+{
+  size_t ii;
+  
+  for (ii = 1; ii <= pq->len; ++ii) {
+    pq->heap[ii]->key = estar_pqueue_calc_key (pq, pq->heap[ii]);
+  }
+  for (ii = pq->len / 2; ii > 0; --ii) {
+    bubble_down (pq->heap, pq->len, ii);
+  }
+}
+
+
+int estar_pqueue_insert_or_update (estar_pqueue_t * pq, estar_cell_t * cell)
 {
   size_t len;
   estar_cell_t ** heap;
   
   if (0 != cell->pqi) {
-    cell->key = CALC_KEY(cell);
-    // could probably make it more efficient by only bubbling down when
-    // the bubble up did not change cell->pqi
-    bubble_up (pq->heap, cell->pqi);
-    bubble_down (pq->heap, pq->len, cell->pqi);
-    return;
+    cell->key = estar_pqueue_calc_key (pq, cell);
+    heap_update (pq->heap, pq->len, cell);
+    return ESTAR_OK;
   }
   
   // grow heap, realloc if necessary
@@ -138,6 +160,9 @@ void estar_pqueue_insert_or_update (estar_pqueue_t * pq, estar_cell_t * cell)
   if (len <= pq->cap) {
     heap = pq->heap;
   }
+  else if (pq->fixed) {
+    return ESTAR_EFULL;
+  }
   else {
     size_t cap;
     cap = 2 * pq->cap;
@@ -152,10 +177,10 @@ void estar_pqueue_insert_or_update (estar_pqueue_t * pq, estar_cell_t * cell)
   
   // append cell to heap and bubble up
   
-  cell->key = CALC_KEY(cell);
-  heap[len] = cell;
-  cell->pqi = len;		/* initialize pqi */
-  bubble_up (heap, len);
+  cell->key = estar_pqueue_calc_key (pq, cell);
+  heap_insert (heap, len, cell);
+  
+  return ESTAR_OK;
 }
 
 
@@ -167,11 +192,8 @@ void estar_pqueue_remove_or_ignore (estar_pqueue_t * pq, estar_cell_t * cell)
     return;
   }
   
-  pq->heap[cell->pqi] = pq->heap[pq->len];
-  pq->heap[cell->pqi]->pqi = cell->pqi; /* keep pqi consistent! */
-  --pq->len;
-  bubble_down (pq->heap, pq->len, cell->pqi);
-  cell->pqi = 0;		/* mark cell as not on queue */
+  pq->len = heap_remove (pq->heap, pq->len, cell);
+  shrink (pq);
 }
 
 
@@ -183,20 +205,9 @@ estar_cell_t * estar_pqueue_extract (estar_pqueue_t * pq)
     return NULL;
   }
   
-  cell = pq->heap[1];
-  cell->pqi = 0;		/* mark cell as not on queue */
-  
-  if (1 == pq->len) {
-    pq->len = 0;
-    return cell;
-  }
-  
-  pq->heap[1] = pq->heap[pq->len];
-  pq->heap[1]->pqi = 1;		/* keep pqi consistent */
+  cell = heap_extract (pq->heap, pq->len);
   --pq->len;
-  // here would be a good place to shrink the heap
-  
-  bubble_down (pq->heap, pq->len, 1);
+  shrink (pq);
   
   return cell;
 }
@@ -0,0 +1,249 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/profile.h>
+
+#include <string.h>
+#include <time.h>
+
+
+#define SUB ((uint64_t) 1 << ESTAR_HIST_SUB_BITS)
+
+
+static uint64_t now_nsec (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+void estar_hist_init (estar_hist_t * hist)
+{
+  memset (hist, 0, sizeof(*hist));
+  hist->min = UINT64_MAX;
+}
+
+
+size_t estar_hist_bucket (uint64_t value)
+{
+  size_t shift;
+  
+  if (value < 2 * SUB) {
+    return value;
+  }
+  // shift the value such that it lies in [SUB, 2*SUB)
+  shift = 63 - __builtin_clzll (value) - ESTAR_HIST_SUB_BITS;
+  return (shift << ESTAR_HIST_SUB_BITS) + (value >> shift);
+}
+
+
+uint64_t estar_hist_bucket_low (size_t bucket)
+{
+  size_t shift;
+  
+  if (bucket < 2 * SUB) {
+    return bucket;
+  }
+  shift = (bucket >> ESTAR_HIST_SUB_BITS) - 1;
+  return (SUB + (bucket & (SUB - 1))) << shift;
+}
+
+
+void estar_hist_record (estar_hist_t * hist, uint64_t value)
+{
+  ++hist->count[estar_hist_bucket (value)];
+  ++hist->total;
+  if (value < hist->min) {
+    hist->min = value;
+  }
+  if (value > hist->max) {
+    hist->max = value;
+  }
+  hist->sum += value;
+}
+
+
+uint64_t estar_hist_quantile (estar_hist_t const * hist, double q)
+{
+  uint64_t rank, seen;
+  size_t ii;
+  
+  if (0 == hist->total) {
+    return 0;
+  }
+  rank = q * (hist->total - 1);
+  for (ii = 0, seen = 0; ii < ESTAR_HIST_NBUCKETS; ++ii) {
+    seen += hist->count[ii];
+    if (seen > rank) {
+      return estar_hist_bucket_low (ii);
+    }
+  }
+  return hist->max;		/* not reached */
+}
+
+
+void estar_profile_init (estar_profile_t * profile)
+{
+  estar_hist_init (&profile->raised);
+  estar_hist_init (&profile->lowered);
+  estar_hist_init (&profile->peak_queue);
+  estar_hist_init (&profile->nsec);
+  memset (&profile->current, 0, sizeof(profile->current));
+  memset (&profile->worst, 0, sizeof(profile->worst));
+  profile->active = 0;
+  profile->nepochs = 0;
+  profile->t0 = 0;
+  profile->on_epoch = NULL;
+  profile->on_epoch_data = NULL;
+}
+
+
+void estar_profile_change (estar_profile_t * profile, size_t ix, size_t iy)
+{
+  estar_epoch_t * ep = &profile->current;
+  
+  if ( ! profile->active) {
+    profile->active = 1;
+    profile->t0 = now_nsec ();
+    memset (ep, 0, sizeof(*ep));
+    ep->id = profile->nepochs + 1;
+    ep->xmin = ix;
+    ep->xmax = ix;
+    ep->ymin = iy;
+    ep->ymax = iy;
+  }
+  ++ep->nchanges;
+  if (ix < ep->xmin) {
+    ep->xmin = ix;
+  }
+  if (ix > ep->xmax) {
+    ep->xmax = ix;
+  }
+  if (iy < ep->ymin) {
+    ep->ymin = iy;
+  }
+  if (iy > ep->ymax) {
+    ep->ymax = iy;
+  }
+}
+
+
+void estar_profile_finish (estar_profile_t * profile)
+{
+  estar_epoch_t * ep = &profile->current;
+  
+  if ( ! profile->active) {
+    return;
+  }
+  profile->active = 0;
+  ep->nsec = now_nsec () - profile->t0;
+  ++profile->nepochs;
+  
+  estar_hist_record (&profile->raised, ep->raised);
+  estar_hist_record (&profile->lowered, ep->lowered);
+  estar_hist_record (&profile->peak_queue, ep->peak_queue);
+  estar_hist_record (&profile->nsec, ep->nsec);
+  if (1 == profile->nepochs || ep->raised > profile->worst.raised) {
+    profile->worst = *ep;
+  }
+  
+  if (NULL != profile->on_epoch) {
+    profile->on_epoch (profile->on_epoch_data, ep);
+  }
+}
+
+
+void estar_profile_idle (estar_profile_t * profile)
+{
+  if (0 == profile->current.raised && 0 == profile->current.lowered) {
+    profile->active = 0;
+  }
+  else {
+    estar_profile_finish (profile);
+  }
+}
+
+
+static void write_hist (estar_hist_t const * hist, char const * name, FILE * fp)
+{
+  size_t ii;
+  char const * sep;
+  
+  fprintf (fp, "    \"%s\": {\n", name);
+  fprintf (fp, "      \"count\": %llu, \"min\": %llu, \"max\": %llu, \"mean\": %.3f,\n",
+	   (unsigned long long) hist->total,
+	   (unsigned long long) (hist->total ? hist->min : 0),
+	   (unsigned long long) hist->max,
+	   hist->total ? hist->sum / hist->total : 0.0);
+  fprintf (fp, "      \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu,\n",
+	   (unsigned long long) estar_hist_quantile (hist, 0.5),
+	   (unsigned long long) estar_hist_quantile (hist, 0.9),
+	   (unsigned long long) estar_hist_quantile (hist, 0.99),
+	   (unsigned long long) estar_hist_quantile (hist, 0.999));
+  fprintf (fp, "      \"buckets\": [");
+  sep = "";
+  for (ii = 0; ii < ESTAR_HIST_NBUCKETS; ++ii) {
+    if (0 != hist->count[ii]) {
+      fprintf (fp, "%s[%llu, %llu]", sep,
+	       (unsigned long long) estar_hist_bucket_low (ii),
+	       (unsigned long long) hist->count[ii]);
+      sep = ", ";
+    }
+  }
+  fprintf (fp, "]\n    }");
+}
+
+
+int estar_profile_write_json (estar_profile_t const * profile, FILE * fp)
+{
+  estar_epoch_t const * ww = &profile->worst;
+  
+  fprintf (fp, "{\n  \"epochs\": %llu,\n  \"histograms\": {\n",
+	   (unsigned long long) profile->nepochs);
+  write_hist (&profile->raised, "raised", fp);
+  fprintf (fp, ",\n");
+  write_hist (&profile->lowered, "lowered", fp);
+  fprintf (fp, ",\n");
+  write_hist (&profile->peak_queue, "peak_queue", fp);
+  fprintf (fp, ",\n");
+  write_hist (&profile->nsec, "nsec", fp);
+  fprintf (fp, "\n  },\n");
+  fprintf (fp, "  \"worst\": { \"id\": %llu, \"changes\": %zu,"
+	   " \"bbox\": [%zu, %zu, %zu, %zu],\n"
+	   "    \"raised\": %zu, \"lowered\": %zu, \"peak_queue\": %zu, \"nsec\": %llu }\n}\n",
+	   (unsigned long long) ww->id, ww->nchanges,
+	   ww->xmin, ww->ymin, ww->xmax, ww->ymax,
+	   ww->raised, ww->lowered, ww->peak_queue, (unsigned long long) ww->nsec);
+  
+  return ferror (fp) ? -1 : 0;
+}
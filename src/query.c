@@ -0,0 +1,313 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/query.h>
+#include <math.h>
+
+
+/* Number of points whose cells are looked up before any of them gets
+   interpolated. Large enough to keep plenty of cache misses in
+   flight, small enough for the lookups to stay in L1. */
+#define BLOCK 64
+
+#ifdef __GNUC__
+# define PREFETCH(addr) __builtin_prefetch (addr)
+#else
+# define PREFETCH(addr)
+#endif
+
+
+/* Cells do not have to be looked up one by one: the one at the lower
+   left of the square a point falls into is found from its coordinates,
+   and the other three are at fixed offsets from it (which depend on
+   whether the square straddles a tile boundary). */
+typedef struct {
+  size_t base[BLOCK], offx[BLOCK], offy[BLOCK];
+  double fx[BLOCK], fy[BLOCK];	/* position within the square, in [0, 1] */
+  int outside[BLOCK];
+  double p00[BLOCK], p10[BLOCK], p01[BLOCK], p11[BLOCK];
+  double gx[BLOCK], gy[BLOCK];
+} block_t;
+
+
+static void lookup (estar_grid_t const * grid, double const * xy, size_t nn, block_t * blk)
+{
+  // local copies, as the stores into the block might alias the grid
+  size_t const dimx = grid->dimx;
+  size_t const dimy = grid->dimy;
+  size_t const tdimx = grid->tdimx;
+  estar_cell_t const * const cell = grid->cell;
+  size_t const ts = grid->tshift;
+  size_t const tm = ((size_t) 1 << ts) - 1;
+  size_t const tsize = (size_t) 1 << (2 * ts);
+  size_t const stepx = dimx > 1 ? 1 : 0;
+  size_t const stepy = dimy > 1 ? 1 : 0;
+  double const xmax = dimx - 1.0;
+  double const ymax = dimy - 1.0;
+  double xx, yy;
+  size_t jj, x0, y0;
+  
+  for (jj = 0; jj < nn; ++jj) {
+    xx = xy[2 * jj];
+    yy = xy[2 * jj + 1];
+    // written such that the compiler can avoid branches, which also
+    // keeps infinite and NaN coordinates on the grid
+    blk->outside[jj] = ! ((xx >= -0.5) & (xx < xmax + 0.5)
+			  & (yy >= -0.5) & (yy < ymax + 0.5));
+    xx = xx > 0.0 ? xx : 0.0;
+    yy = yy > 0.0 ? yy : 0.0;
+    xx = xx < xmax ? xx : xmax;
+    yy = yy < ymax ? yy : ymax;
+    
+    // on the last row or column, use the square that ends there
+    x0 = (long) xx;
+    y0 = (long) yy;
+    x0 -= (x0 == dimx - 1) & stepx;
+    y0 -= (y0 == dimy - 1) & stepy;
+    blk->fx[jj] = xx - x0;
+    blk->fy[jj] = yy - y0;
+    
+    blk->base[jj] = (((y0 >> ts) * tdimx + (x0 >> ts)) << (2 * ts))
+      | ((y0 & tm) << ts) | (x0 & tm);
+    blk->offx[jj] = stepx * ((x0 & tm) != tm ? 1 : tsize - tm);
+    blk->offy[jj] = stepy * ((y0 & tm) != tm ? tm + 1 : tdimx * tsize - (tm << ts));
+    PREFETCH (&cell[blk->base[jj]].phi);
+    PREFETCH (&cell[blk->base[jj] + blk->offx[jj]].phi);
+    PREFETCH (&cell[blk->base[jj] + blk->offy[jj]].phi);
+    PREFETCH (&cell[blk->base[jj] + blk->offx[jj] + blk->offy[jj]].phi);
+  }
+}
+
+
+static void gather (estar_grid_t const * grid, size_t nn, block_t * blk)
+{
+  estar_cell_t const * cell;
+  size_t jj;
+  
+  for (jj = 0; jj < nn; ++jj) {
+    cell = &grid->cell[blk->base[jj]];
+    blk->p00[jj] = cell->phi;
+    blk->p10[jj] = cell[blk->offx[jj]].phi;
+    blk->p01[jj] = cell[blk->offy[jj]].phi;
+    blk->p11[jj] = cell[blk->offx[jj] + blk->offy[jj]].phi;
+  }
+}
+
+
+/* Free of branches, so that the compiler can vectorize it. Squares
+   with an infinite corner produce garbage here, which fixup()
+   replaces. */
+static void interpolate (size_t nn, block_t * blk, double * phi)
+{
+  double dx0, dx1, aa, bb;
+  size_t jj;
+  
+  for (jj = 0; jj < nn; ++jj) {
+    dx0 = blk->p10[jj] - blk->p00[jj];
+    dx1 = blk->p11[jj] - blk->p01[jj];
+    aa = blk->p00[jj] + blk->fx[jj] * dx0;
+    bb = blk->p01[jj] + blk->fx[jj] * dx1;
+    phi[jj] = aa + blk->fy[jj] * (bb - aa);
+    blk->gx[jj] = - (dx0 + blk->fy[jj] * (dx1 - dx0));
+    blk->gy[jj] = - (bb - aa);
+  }
+}
+
+
+static size_t fixup (estar_grid_t const * grid, size_t nn, block_t * blk, double * phi)
+{
+  estar_cell_t * cell;
+  size_t jj, nfinite;
+  
+  nfinite = nn;
+  for (jj = 0; jj < nn; ++jj) {
+    if (blk->outside[jj]) {
+      phi[jj] = INFINITY;
+      blk->gx[jj] = 0.0;
+      blk->gy[jj] = 0.0;
+      --nfinite;
+    }
+    else if (isinf (blk->p00[jj] + blk->p10[jj] + blk->p01[jj] + blk->p11[jj])) {
+      cell = &grid->cell[blk->base[jj]
+			 + (blk->fx[jj] > 0.5) * blk->offx[jj]
+			 + (blk->fy[jj] > 0.5) * blk->offy[jj]];
+      phi[jj] = cell->phi;
+      if (isinf (cell->phi)
+	  || 0 == estar_cell_calc_gradient (cell, &blk->gx[jj], &blk->gy[jj])) {
+	blk->gx[jj] = 0.0;
+	blk->gy[jj] = 0.0;
+      }
+      if (isinf (cell->phi)) {
+	--nfinite;
+      }
+    }
+  }
+  return nfinite;
+}
+
+
+size_t estar_query (estar_grid_t const * grid, size_t npoints,
+		    double const * xy, double * phi, double * grad)
+{
+  block_t blk;
+  size_t ii, jj, nn, nfinite;
+  
+  nfinite = 0;
+  for (ii = 0; ii < npoints; ii += nn) {
+    nn = npoints - ii < BLOCK ? npoints - ii : BLOCK;
+    lookup (grid, xy + 2 * ii, nn, &blk);
+    gather (grid, nn, &blk);
+    interpolate (nn, &blk, phi + ii);
+    nfinite += fixup (grid, nn, &blk, phi + ii);
+    if (NULL != grad) {
+      for (jj = 0; jj < nn; ++jj) {
+	grad[2 * (ii + jj)] = blk.gx[jj];
+	grad[2 * (ii + jj) + 1] = blk.gy[jj];
+      }
+    }
+  }
+  
+  return nfinite;
+}
+
+
+/* Longest run of cells that can share a stamp. */
+#define RUN ((size_t) 1 << ESTAR_STAMP_SHIFT)
+
+
+/* Gradients of a run of nn cells, given the rhs values of the row
+   (with the west neighbor of the first cell at row[0] and the east
+   neighbor of the last one at row[nn + 1]) and of the rows to the
+   south and north. Missing neighbors are at infinity. This follows
+   estar_cell_calc_gradient(), which picks the lowest neighbor (the
+   first one in W, E, S, N order on ties) if it is below the cell, and
+   the lowest finite one on the other axis, but without branches.
+   Cells at infinity get zero instead of the infinite components that
+   estar_cell_calc_gradient() would give them. */
+static void gradient_run (size_t nn, double const * row,
+			  double const * south, double const * north,
+			  double * gx, double * gy)
+{
+  double cc, ww, ee, ss, no, mx, my, best, dx, dy;
+  int xaxis, ok;
+  size_t jj;
+  
+  for (jj = 0; jj < nn; ++jj) {
+    cc = row[jj + 1];
+    ww = row[jj];
+    ee = row[jj + 2];
+    ss = south[jj];
+    no = north[jj];
+    mx = ee < ww ? ee : ww;
+    my = no < ss ? no : ss;
+    dx = ee < ww ? cc - ee : ww - cc;
+    dy = no < ss ? cc - no : ss - cc;
+    xaxis = mx <= my;
+    best = xaxis ? mx : my;
+    ok = (best < cc) & (cc < INFINITY);
+    gx[jj] = ok & (xaxis | (mx < INFINITY)) ? dx : 0.0;
+    gy[jj] = ok & ( ! xaxis | (my < INFINITY)) ? dy : 0.0;
+  }
+}
+
+
+static void gather_rhs (estar_cell_t const * cell, size_t nn, double * rhs)
+{
+  size_t jj;
+  for (jj = 0; jj < nn; ++jj) {
+    rhs[jj] = cell[jj].rhs;
+  }
+}
+
+
+size_t estar_compute_gradient_field (estar_t const * estar,
+				     size_t x0, size_t y0,
+				     size_t width, size_t height,
+				     double * gx, double * gy, size_t stride,
+				     unsigned long long * since)
+{
+  estar_grid_t const * const grid = &estar->grid;
+  size_t const ts = grid->tshift;
+  size_t const tm = ((size_t) 1 << ts) - 1;
+  unsigned long long const old = NULL == since ? 0 : *since;
+  double row[RUN + 2], south[RUN], north[RUN];
+  size_t ix, iy, idx, nn, off, ncomputed;
+  
+  ncomputed = 0;
+  for (iy = y0; iy < y0 + height; ++iy) {
+    for (ix = x0; ix < x0 + width; ix += nn) {
+      // stay within a row of a tile and a stamp chunk, so that all
+      // cells of the run are next to each other and share a stamp
+      idx = estar_grid_index (grid, ix, iy);
+      nn = x0 + width - ix;
+      if (0 != ts && nn > tm + 1 - (ix & tm)) {
+	nn = tm + 1 - (ix & tm);
+      }
+      if (nn > RUN - (idx & (RUN - 1))) {
+	nn = RUN - (idx & (RUN - 1));
+      }
+      if (0 != old && estar->stamp[idx >> ESTAR_STAMP_SHIFT] <= old) {
+	continue;
+      }
+      
+      row[0] = ix > 0 ? estar_grid_at (grid, ix - 1, iy)->rhs : INFINITY;
+      gather_rhs (&grid->cell[idx], nn, row + 1);
+      row[nn + 1] = ix + nn < grid->dimx
+	? estar_grid_at (grid, ix + nn, iy)->rhs : INFINITY;
+      if (iy > 0) {
+	gather_rhs (estar_grid_at (grid, ix, iy - 1), nn, south);
+      }
+      else {
+	for (off = 0; off < nn; ++off) {
+	  south[off] = INFINITY;
+	}
+      }
+      if (iy + 1 < grid->dimy) {
+	gather_rhs (estar_grid_at (grid, ix, iy + 1), nn, north);
+      }
+      else {
+	for (off = 0; off < nn; ++off) {
+	  north[off] = INFINITY;
+	}
+      }
+      
+      off = (iy - y0) * stride + (ix - x0);
+      gradient_run (nn, row, south, north, gx + off, gy + off);
+      ncomputed += nn;
+    }
+  }
+  
+  if (NULL != since) {
+    *since = estar->version;
+  }
+  return ncomputed;
+}
@@ -0,0 +1,226 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+
+#include <string.h>
+#include <math.h>
+
+
+static void put_u32 (estar_recorder_t * rec, uint32_t value)
+{
+  unsigned char buf[4];
+  size_t ii;
+  for (ii = 0; ii < sizeof(buf); ++ii, value >>= 8) {
+    buf[ii] = value & 0xff;
+  }
+  if (sizeof(buf) != fwrite (buf, 1, sizeof(buf), rec->fp)) {
+    rec->error = 1;
+  }
+}
+
+
+static void put_u64 (estar_recorder_t * rec, uint64_t value)
+{
+  unsigned char buf[8];
+  size_t ii;
+  for (ii = 0; ii < sizeof(buf); ++ii, value >>= 8) {
+    buf[ii] = value & 0xff;
+  }
+  if (sizeof(buf) != fwrite (buf, 1, sizeof(buf), rec->fp)) {
+    rec->error = 1;
+  }
+}
+
+
+static void put_f64 (estar_recorder_t * rec, double value)
+{
+  uint64_t bits;
+  memcpy (&bits, &value, sizeof(bits));
+  put_u64 (rec, bits);
+}
+
+
+static void put_op (estar_recorder_t * rec, int op)
+{
+  if (EOF == fputc (op, rec->fp)) {
+    rec->error = 1;
+  }
+}
+
+
+static void flush_propagate (estar_recorder_t * rec)
+{
+  if (0 != rec->npropagate) {
+    put_op (rec, ESTAR_RECORD_PROPAGATE);
+    put_u64 (rec, rec->npropagate);
+    rec->npropagate = 0;
+  }
+}
+
+
+void estar_record (estar_recorder_t * rec, int op, size_t ix, size_t iy, double value)
+{
+  flush_propagate (rec);
+  put_op (rec, op);
+  switch (op) {
+  case ESTAR_RECORD_GOAL:
+  case ESTAR_RECORD_FOCUS:
+    put_u32 (rec, ix);
+    put_u32 (rec, iy);
+    break;
+  case ESTAR_RECORD_SPEED:
+  case ESTAR_RECORD_COST:
+    put_u32 (rec, ix);
+    put_u32 (rec, iy);
+    put_f64 (rec, value);
+    break;
+  }
+}
+
+
+void estar_record_propagate (estar_recorder_t * rec)
+{
+  ++rec->npropagate;
+}
+
+
+/* The region of interest as the mask of estar_set_roi(): 1 inside,
+   0 outside. */
+static void put_roi (estar_recorder_t * rec, estar_t const * estar)
+{
+  size_t ix, iy;
+  int inside;
+  
+  flush_propagate (rec);
+  put_op (rec, ESTAR_RECORD_ROI);
+  put_u64 (rec, estar->grid.dimx * estar->grid.dimy);
+  for (iy = 0; iy < estar->grid.dimy; ++iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      inside = ! (estar_grid_at (&estar->grid, ix, iy)->flags & ESTAR_FLAG_OUTSIDE);
+      if (EOF == fputc (inside, rec->fp)) {
+	rec->error = 1;
+      }
+    }
+  }
+}
+
+
+int estar_record_start (estar_t * estar, estar_recorder_t * rec, FILE * fp)
+{
+  size_t ix, iy;
+  estar_cell_t * cell;
+  int outside;
+  
+  rec->fp = fp;
+  rec->npropagate = 0;
+  rec->error = 0;
+  
+  if (8 != fwrite ("ESTARLOG", 1, 8, fp)) {
+    rec->error = 1;
+  }
+  put_u32 (rec, ESTAR_RECORD_VERSION);
+  put_u32 (rec, (uint32_t) 1 << estar->grid.tshift);
+  put_u64 (rec, estar->grid.dimx);
+  put_u64 (rec, estar->grid.dimy);
+  
+  // Costs that were set before recording started. They are stored
+  // as they are, because going back to 1/cost as a speed can end up
+  // one ulp away from the original. Goals and values are not
+  // captured, so the replay only matches the original if recording
+  // starts before the first goal is set.
+  outside = 0;
+  for (iy = 0; iy < estar->grid.dimy; ++iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      cell = estar_grid_at (&estar->grid, ix, iy);
+      if (1.0 != cell->cost) {
+	estar_record (rec, ESTAR_RECORD_COST, ix, iy, cell->cost);
+      }
+      if (cell->flags & ESTAR_FLAG_OUTSIDE) {
+	outside = 1;
+      }
+    }
+  }
+  if (outside) {
+    put_roi (rec, estar);
+  }
+  
+  estar->recorder = rec;
+  return rec->error ? -1 : 0;
+}
+
+
+int estar_record_phi (estar_t * estar)
+{
+  estar_recorder_t * rec = estar->recorder;
+  size_t ix, iy;
+  
+  if (NULL == rec) {
+    return -1;
+  }
+  flush_propagate (rec);
+  put_op (rec, ESTAR_RECORD_PHI);
+  put_u64 (rec, estar->grid.dimx * estar->grid.dimy);
+  for (iy = 0; iy < estar->grid.dimy; ++iy) {
+    for (ix = 0; ix < estar->grid.dimx; ++ix) {
+      put_f64 (rec, estar_grid_at (&estar->grid, ix, iy)->phi);
+    }
+  }
+  return rec->error ? -1 : 0;
+}
+
+
+int estar_record_roi (estar_t * estar)
+{
+  if (NULL == estar->recorder) {
+    return -1;
+  }
+  put_roi (estar->recorder, estar);
+  return estar->recorder->error ? -1 : 0;
+}
+
+
+int estar_record_stop (estar_t * estar)
+{
+  estar_recorder_t * rec = estar->recorder;
+  
+  if (NULL == rec) {
+    return -1;
+  }
+  flush_propagate (rec);
+  put_op (rec, ESTAR_RECORD_END);
+  if (0 != fflush (rec->fp)) {
+    rec->error = 1;
+  }
+  estar->recorder = NULL;
+  return rec->error ? -1 : 0;
+}
@@ -0,0 +1,292 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/shm.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <err.h>
+
+
+/* Producer and consumers synchronize like a seqlock, with the GCC
+   atomic builtins (which clang has as well) on the shared counters. */
+
+
+static size_t align (size_t offset)
+{
+  return (offset + 63) & ~(size_t) 63;
+}
+
+
+static void map_arrays (estar_shm_t * shm, void * base)
+{
+  char * const bytes = base;
+  shm->header = base;
+  shm->version = (uint64_t *) (bytes + shm->header->version);
+  shm->phi = (double *) (bytes + shm->header->phi);
+  shm->rhs = (double *) (bytes + shm->header->rhs);
+  shm->flags = (uint8_t *) (bytes + shm->header->flags);
+}
+
+
+static char * copy_name (char const * name)
+{
+  char * copy = strdup (name);
+  if (NULL == copy) {
+    errx (EXIT_FAILURE, __FILE__": %s: strdup", __func__);
+  }
+  return copy;
+}
+
+
+int estar_shm_create (estar_shm_t * shm, char const * name,
+		      size_t dimx, size_t dimy, size_t tile)
+{
+  estar_shm_header_t hdr;
+  size_t ncells, ii, ix, iy;
+  void * base;
+  int fd;
+  
+  if (0 == tile) {
+    errno = EINVAL;
+    return -1;
+  }
+  memset (&hdr, 0, sizeof(hdr));
+  hdr.tile = tile;
+  hdr.dimx = dimx;
+  hdr.dimy = dimy;
+  hdr.tdimx = (dimx + tile - 1) / tile;
+  hdr.tdimy = (dimy + tile - 1) / tile;
+  ncells = hdr.tdimx * hdr.tdimy * tile * tile;
+  hdr.version = align (sizeof(hdr));
+  hdr.phi = align (hdr.version + hdr.tdimx * hdr.tdimy * sizeof(uint64_t));
+  hdr.rhs = align (hdr.phi + ncells * sizeof(double));
+  hdr.flags = align (hdr.rhs + ncells * sizeof(double));
+  hdr.size = align (hdr.flags + ncells);
+  
+  fd = shm_open (name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (-1 == fd) {
+    return -1;
+  }
+  if (0 != ftruncate (fd, hdr.size)) {
+    close (fd);
+    shm_unlink (name);
+    return -1;
+  }
+  base = mmap (NULL, hdr.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (MAP_FAILED == base) {
+    shm_unlink (name);
+    return -1;
+  }
+  
+  memcpy (base, &hdr, sizeof(hdr));
+  memset (shm, 0, sizeof(*shm));
+  map_arrays (shm, base);
+  shm->name = copy_name (name);
+  shm->producer = 1;
+  for (ii = 0; ii < ncells; ++ii) {
+    shm->phi[ii] = INFINITY;
+    shm->rhs[ii] = INFINITY;
+    shm->flags[ii] = ESTAR_FLAG_OBSTACLE;
+  }
+  for (iy = 0; iy < dimy; ++iy) {
+    for (ix = 0; ix < dimx; ++ix) {
+      shm->flags[estar_shm_index (shm->header, ix, iy)] = 0;
+    }
+  }
+  // consumers check the magic number last
+  __atomic_store_n (&shm->header->magic, ESTAR_SHM_MAGIC, __ATOMIC_RELEASE);
+  
+  return 0;
+}
+
+
+int estar_shm_open (estar_shm_t * shm, char const * name)
+{
+  estar_shm_header_t const * hdr;
+  struct stat st;
+  void * base;
+  int fd;
+  
+  fd = shm_open (name, O_RDONLY, 0);
+  if (-1 == fd) {
+    return -1;
+  }
+  if (0 != fstat (fd, &st)) {
+    close (fd);
+    return -1;
+  }
+  if ((size_t) st.st_size < sizeof(*hdr)) {
+    close (fd);
+    errno = EINVAL;
+    return -1;
+  }
+  base = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (MAP_FAILED == base) {
+    return -1;
+  }
+  hdr = base;
+  if (ESTAR_SHM_MAGIC != __atomic_load_n (&hdr->magic, __ATOMIC_ACQUIRE)
+      || hdr->size != (uint64_t) st.st_size) {
+    munmap (base, st.st_size);
+    errno = EINVAL;
+    return -1;
+  }
+  
+  memset (shm, 0, sizeof(*shm));
+  map_arrays (shm, base);
+  shm->name = copy_name (name);
+  
+  return 0;
+}
+
+
+void estar_shm_close (estar_shm_t * shm)
+{
+  munmap (shm->header, shm->header->size);
+  if (shm->producer) {
+    shm_unlink (shm->name);
+  }
+  free (shm->name);
+  shm->name = NULL;
+  shm->header = NULL;
+}
+
+
+size_t estar_shm_publish (estar_shm_t * shm, estar_t const * estar)
+{
+  estar_shm_header_t * const hdr = shm->header;
+  size_t const tile = hdr->tile;
+  estar_cell_t const * cell;
+  size_t tx, ty, x0, x1, y0, y1, ix, iy, base, ii, nwritten;
+  uint64_t * version;
+  uint64_t seq;
+  
+  seq = hdr->seq;
+  __atomic_store_n (&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+  nwritten = 0;
+  for (ty = 0; ty < hdr->tdimy; ++ty) {
+    y0 = ty * tile;
+    y1 = y0 + tile < hdr->dimy ? y0 + tile : hdr->dimy;
+    for (tx = 0; tx < hdr->tdimx; ++tx) {
+      x0 = tx * tile;
+      x1 = x0 + tile < hdr->dimx ? x0 + tile : hdr->dimx;
+      if (shm->published && ! estar_changed_since (estar, x0, y0, x1, y1, shm->since)) {
+	continue;
+      }
+      
+      version = &shm->version[ty * hdr->tdimx + tx];
+      __atomic_store_n (version, *version + 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence (__ATOMIC_RELEASE);
+      base = (ty * hdr->tdimx + tx) * tile * tile;
+      for (iy = y0; iy < y1; ++iy) {
+	ii = base + (iy - y0) * tile;
+	for (ix = x0; ix < x1; ++ix, ++ii) {
+	  cell = estar_grid_at (&estar->grid, ix, iy);
+	  shm->phi[ii] = cell->phi;
+	  shm->rhs[ii] = cell->rhs;
+	  shm->flags[ii] = cell->flags;
+	}
+      }
+      __atomic_store_n (version, *version + 1, __ATOMIC_RELEASE);
+      ++nwritten;
+    }
+  }
+  __atomic_store_n (&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+  
+  shm->since = estar->version;
+  shm->published = 1;
+  
+  return nwritten;
+}
+
+
+uint64_t estar_shm_tile_begin (estar_shm_t const * shm, size_t tx, size_t ty)
+{
+  uint64_t const * const version = &shm->version[ty * shm->header->tdimx + tx];
+  uint64_t vv;
+  
+  for (;;) {
+    vv = __atomic_load_n (version, __ATOMIC_ACQUIRE);
+    if (0 == (vv & 1)) {
+      return vv;
+    }
+    sched_yield ();
+  }
+}
+
+
+int estar_shm_tile_end (estar_shm_t const * shm, size_t tx, size_t ty, uint64_t version)
+{
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  return version == __atomic_load_n (&shm->version[ty * shm->header->tdimx + tx],
+				     __ATOMIC_RELAXED);
+}
+
+
+uint64_t estar_shm_read_tile (estar_shm_t const * shm, size_t tx, size_t ty,
+			      double * phi, double * rhs, uint8_t * flags)
+{
+  size_t const area = shm->header->tile * shm->header->tile;
+  size_t const base = (ty * shm->header->tdimx + tx) * area;
+  uint64_t version;
+  
+  do {
+    version = estar_shm_tile_begin (shm, tx, ty);
+    if (NULL != phi) {
+      memcpy (phi, shm->phi + base, area * sizeof(*phi));
+    }
+    if (NULL != rhs) {
+      memcpy (rhs, shm->rhs + base, area * sizeof(*rhs));
+    }
+    if (NULL != flags) {
+      memcpy (flags, shm->flags + base, area * sizeof(*flags));
+    }
+  } while ( ! estar_shm_tile_end (shm, tx, ty, version));
+  
+  return version;
+}
+
+
+uint64_t estar_shm_seq (estar_shm_t const * shm)
+{
+  return __atomic_load_n (&shm->header->seq, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,218 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+
+#define DIMX 67
+#define DIMY 59
+#define NFRAMES 4
+
+
+static void set_each (estar_t * estar, float const * speed)
+{
+  size_t ix, iy;
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      estar_set_speed (estar, ix, iy, speed[iy * DIMX + ix]);
+    }
+  }
+}
+
+
+static int check_queue (estar_t * bulk, estar_t * each, char const * what)
+{
+  if (bulk->pq.len != each->pq.len) {
+    printf ("  ERROR %s: %zu queued with bulk speeds, %zu with single ones\n",
+	    what, bulk->pq.len, each->pq.len);
+    return 1;
+  }
+  return 0;
+}
+
+
+/* estar_set_speed_bulk() has to leave the planner in the same state as
+   calling estar_set_speed() for each cell in row-major order, also
+   when the frames arrive while the wavefront is still moving. */
+static int check_bulk (void)
+{
+  static float speed[DIMX * DIMY];
+  estar_t bulk, each;
+  size_t ii, jj;
+  char what[64];
+  int status;
+  
+  srand (36);
+  test_random_speeds (speed, DIMX * DIMY, 5);
+  speed[(DIMY / 2) * DIMX + DIMX / 3] = 1.0f;
+  speed[(DIMY / 2) * DIMX + DIMX / 3 + 1] = 0.5f;
+  estar_init (&bulk, DIMX, DIMY);
+  estar_init (&each, DIMX, DIMY);
+  estar_set_speed_bulk (&bulk, speed, DIMX);
+  set_each (&each, speed);
+  estar_set_goal (&bulk, DIMX / 3, DIMY / 2);
+  estar_set_goal (&each, DIMX / 3, DIMY / 2);
+  
+  status = 0;
+  for (ii = 0; ii < NFRAMES && 0 == status; ++ii) {
+    for (jj = 0; jj < 200 * (ii + 1); ++jj) {
+      estar_propagate (&bulk);
+      estar_propagate (&each);
+    }
+    snprintf (what, sizeof(what), "before frame %zu", ii);
+    status = test_compare_phi (&bulk, &each, 0.0, what)
+      || check_queue (&bulk, &each, what);
+    
+    // Obstacles become free and free cells obstacles, among them the
+    // neighbor of the goal, which already has a finite value by now.
+    for (jj = 0; jj < DIMX * DIMY / 10; ++jj) {
+      speed[rand () % (DIMX * DIMY)] = rand () % 3 ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0;
+    }
+    speed[(DIMY / 2) * DIMX + DIMX / 3 + 1] = ii % 2 ? 0.5f : 0.0f;
+    if (0 == ii && ! isfinite (estar_grid_at (&bulk.grid, DIMX / 3 + 1, DIMY / 2)->phi)) {
+      printf ("  ERROR the cell next to the goal has no value yet\n");
+      status = 1;
+    }
+    estar_set_speed_bulk (&bulk, speed, DIMX);
+    set_each (&each, speed);
+  }
+  
+  test_flush (&bulk);
+  test_flush (&each);
+  if (0 == status) {
+    status = test_compare_phi (&bulk, &each, 0.0, "after the last frame");
+  }
+  
+  estar_fini (&bulk);
+  estar_fini (&each);
+  return status;
+}
+
+
+/* Run estar-cli (built next to this program) on a small PGM map, and
+   compare the phi it writes with that of the same map planned here. */
+static int check_cli (char const * argv0)
+{
+  static unsigned char pixel[DIMX * DIMY];
+  static float speed[DIMX * DIMY];
+  static float phi[DIMX * DIMY];
+  char map[] = "/tmp/test-bulk-map-XXXXXX";
+  char out[] = "/tmp/test-bulk-phi-XXXXXX";
+  char cmd[1024];
+  char const * slash;
+  estar_t estar;
+  size_t ii, ix, iy, ndiff;
+  FILE * fp;
+  int fd, status;
+  
+  for (ii = 0; ii < DIMX * DIMY; ++ii) {
+    pixel[ii] = rand () % 5 ? 50 + rand () % 206 : 0;
+  }
+  fd = mkstemp (map);
+  if (-1 == fd || NULL == (fp = fdopen (fd, "wb"))) {
+    printf ("  ERROR cannot create %s\n", map);
+    return 1;
+  }
+  fprintf (fp, "P5\n%d %d\n255\n", DIMX, DIMY);
+  fwrite (pixel, 1, sizeof(pixel), fp);
+  fclose (fp);
+  fd = mkstemp (out);
+  if (-1 != fd) {
+    close (fd);
+  }
+  
+  slash = strrchr (argv0, '/');
+  snprintf (cmd, sizeof(cmd), "%.*sestar-cli -g %d,%d -o %s %s 2>/dev/null",
+	    NULL == slash ? 2 : (int) (slash - argv0 + 1),
+	    NULL == slash ? "./" : argv0, DIMX / 2, DIMY / 4, out, map);
+  status = 0;
+  fp = NULL;
+  if (0 != system (cmd)) {
+    printf ("  ERROR %s failed\n", cmd);
+    status = 1;
+  }
+  else if (NULL == (fp = fopen (out, "rb"))
+	   || sizeof(phi) / sizeof(*phi) != fread (phi, sizeof(*phi), DIMX * DIMY, fp)) {
+    printf ("  ERROR cannot read %s\n", out);
+    status = 1;
+  }
+  if (NULL != fp) {
+    fclose (fp);
+  }
+  unlink (map);
+  unlink (out);
+  if (0 != status) {
+    return status;
+  }
+  
+  // The first row of the file is the top of the map.
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      speed[iy * DIMX + ix] = pixel[(DIMY - 1 - iy) * DIMX + ix] * (1.0f / 255);
+    }
+  }
+  estar_init (&estar, DIMX, DIMY);
+  estar_set_speed_bulk (&estar, speed, DIMX);
+  estar_set_goal (&estar, DIMX / 2, DIMY / 4);
+  test_flush (&estar);
+  ndiff = 0;
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      if (phi[(DIMY - 1 - iy) * DIMX + ix] != (float) estar_grid_at (&estar.grid, ix, iy)->phi) {
+	++ndiff;
+      }
+    }
+  }
+  estar_fini (&estar);
+  if (0 != ndiff) {
+    printf ("  ERROR estar-cli: %zu cells differ\n", ndiff);
+    return 1;
+  }
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  if (0 != check_bulk () || 0 != check_cli (argv[0])) {
+    return 1;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,150 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+#define DIMX 31
+#define DIMY 29
+#define NSAMPLES 20000
+
+
+/* Both checks have to report the expected bit, and nothing else. With
+   NSAMPLES far above the number of cells, the sampled one cannot
+   realistically miss the broken cell. */
+static int expect (estar_t * estar, int bit, char const * what)
+{
+  unsigned long long rng = 17;
+  int full, sampled;
+  
+  full = estar_check (estar, NULL);
+  sampled = estar_check_sampled (estar, NSAMPLES, &rng, NULL);
+  if (full != bit || sampled != bit) {
+    printf ("  ERROR %s: estar_check() gives %d and estar_check_sampled() %d instead of %d\n",
+	    what, full, sampled, bit);
+    return 1;
+  }
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  static float speed[DIMX * DIMY];
+  estar_t estar;
+  estar_cell_t * cell;
+  estar_cell_t * tmp;
+  double phi, key;
+  int status;
+  
+  srand (31);
+  test_random_speeds (speed, DIMX * DIMY, 6);
+  speed[(DIMY / 2) * DIMX + DIMX / 2] = 1.0;
+  estar_init (&estar, DIMX, DIMY);
+  estar_set_speed_bulk (&estar, speed, DIMX);
+  estar_set_goal (&estar, 3, 3);
+  test_flush (&estar);
+  status = expect (&estar, 0, "converged");
+  
+  // corrupt a cell in the middle, one way at a time
+  cell = estar_grid_at (&estar.grid, DIMX / 2, DIMY / 2);
+  phi = cell->phi;
+  if (0 == status) {
+    // leaves phi alone, so only the upper bound can catch it
+    cell->rhs = phi + 10.0 * cell->cost;
+    status = expect (&estar, ESTAR_CHECK_INCONSISTENT | ESTAR_CHECK_RHS, "rhs too high");
+    cell->rhs = phi;
+  }
+  if (0 == status) {
+    cell->phi = cell->rhs = 0.5 * phi;
+    status = expect (&estar, ESTAR_CHECK_RHS, "rhs too low");
+    cell->phi = cell->rhs = phi;
+  }
+  if (0 == status) {
+    // the neighbors no longer match either
+    cell->phi = phi + 1.0;
+    status = expect (&estar, ESTAR_CHECK_INCONSISTENT | ESTAR_CHECK_RHS,
+		     "phi != rhs off the queue");
+    cell->phi = phi;
+  }
+  if (0 == status) {
+    // which also makes the neighbors skip it when recomputing rhs
+    cell->pqi = 1;
+    status = expect (&estar, ESTAR_CHECK_CONSISTENT | ESTAR_CHECK_QUEUED | ESTAR_CHECK_RHS,
+		     "stray pqi");
+    cell->pqi = 0;
+  }
+  
+  // corrupt the queue in the middle of a repair
+  if (0 == status) {
+    estar_set_speed (&estar, 4, 3, 0.0);
+    estar_set_speed (&estar, 3, 4, 0.0);
+    estar_propagate (&estar);
+    if (estar.pq.len < 3) {
+      printf ("  ERROR only %zu cells queued\n", (size_t) estar.pq.len);
+      status = 2;
+    }
+    else {
+      status = expect (&estar, 0, "repairing");
+    }
+  }
+  if (0 == status) {
+    key = estar.pq.heap[2]->key;
+    estar.pq.heap[2]->key = -1.0;
+    status = expect (&estar, ESTAR_CHECK_HEAP | ESTAR_CHECK_KEY, "key");
+    estar.pq.heap[2]->key = key;
+  }
+  if (0 == status) {
+    tmp = estar.pq.heap[1];
+    estar.pq.heap[1] = estar.pq.heap[2];
+    estar.pq.heap[2] = tmp;
+    status = expect (&estar, ESTAR_CHECK_PQI | ESTAR_CHECK_QUEUED | ESTAR_CHECK_HEAP,
+		     "swapped slots");
+    estar.pq.heap[2] = estar.pq.heap[1];
+    estar.pq.heap[1] = tmp;
+  }
+  if (0 == status) {
+    test_flush (&estar);
+    status = expect (&estar, 0, "repaired");
+  }
+  
+  estar_fini (&estar);
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,182 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/export.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+
+#define DIMX 97
+#define DIMY 83
+#define TILE 16
+#define RESOLUTION 0.002
+
+
+static int compare (estar_t * estar, estar_import_t * imp, char const * what)
+{
+  double phi, value;
+  size_t ix, iy;
+  
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      phi = estar_grid_at (&estar->grid, ix, iy)->phi;
+      value = estar_import_phi (imp, ix, iy);
+      if (isinf (phi) ? ! isinf (value)
+	  : phi >= ESTAR_EXPORT_MAX * RESOLUTION ? value != ESTAR_EXPORT_MAX * RESOLUTION
+	  : fabs (phi - value) > 0.5 * RESOLUTION + 1e-9) {
+	printf ("  ERROR %s: phi at %zu %zu is %g instead of %g\n", what, ix, iy, value, phi);
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  size_t const header = 53;
+  estar_t estar;
+  estar_export_t exp;
+  estar_import_t imp;
+  unsigned char * copy;
+  size_t ii, ix, iy, len, keylen, nsaturated;
+  int status;
+  
+  estar_init (&estar, DIMX, DIMY);
+  srand (5);
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      estar_set_speed (&estar, ix, iy, rand () % 10 ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0);
+    }
+  }
+  estar_set_goal (&estar, DIMX / 4, DIMY / 4);
+  test_flush (&estar);
+  estar_export_init (&exp, DIMX, DIMY, TILE, RESOLUTION);
+  estar_import_init (&imp);
+  
+  // the first frame is a key frame, and some values saturate
+  keylen = estar_export_frame (&exp, &estar, 0);
+  status = 0 != estar_import_frame (&imp, exp.buf, exp.len) || compare (&estar, &imp, "key");
+  nsaturated = 0;
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      if (estar_import_phi (&imp, ix, iy) == ESTAR_EXPORT_MAX * RESOLUTION) {
+	++nsaturated;
+      }
+    }
+  }
+  if (0 == status && 0 == nsaturated) {
+    printf ("  ERROR no saturated values, the test does not cover them\n");
+    status = 2;
+  }
+  
+  // nothing changed, so nothing to send
+  if (0 == status && header != estar_export_frame (&exp, &estar, 0)) {
+    printf ("  ERROR unchanged planner gives a frame of %zu bytes\n", exp.len);
+    status = 3;
+  }
+  if (0 == status) {
+    status = 0 != estar_import_frame (&imp, exp.buf, exp.len);
+  }
+  
+  // repairs far from the goal only touch a few tiles
+  for (ii = 0; 0 == status && ii < 10; ++ii) {
+    estar_set_speed (&estar, DIMX - 3 - ii, DIMY - 5, ii % 2 ? 1.0 : 0.0);
+    test_flush (&estar);
+    len = estar_export_frame (&exp, &estar, 0);
+    if (len >= keylen / 4) {
+      printf ("  ERROR repair %zu: delta frame of %zu bytes, key frame %zu\n", ii, len, keylen);
+      status = 4;
+    }
+    else if (0 != estar_import_frame (&imp, exp.buf, exp.len)) {
+      printf ("  ERROR repair %zu: cannot decode\n", ii);
+      status = 5;
+    }
+    else {
+      status = compare (&estar, &imp, "delta");
+    }
+  }
+  
+  // a lost frame breaks the chain until the next key frame
+  if (0 == status) {
+    estar_set_speed (&estar, DIMX / 4 + 1, DIMY / 4, 0.0);
+    test_flush (&estar);
+    estar_export_frame (&exp, &estar, 0);
+    estar_set_speed (&estar, DIMX / 4 + 1, DIMY / 4, 1.0);
+    test_flush (&estar);
+    estar_export_frame (&exp, &estar, 0);
+    if (0 == estar_import_frame (&imp, exp.buf, exp.len)) {
+      printf ("  ERROR decoded a delta frame after a lost one\n");
+      status = 6;
+    }
+    else if (0 == estar_import_frame (&imp, exp.buf, exp.len)) {
+      printf ("  ERROR decoded a delta frame after a failure\n");
+      status = 7;
+    }
+    else {
+      estar_export_frame (&exp, &estar, 1);
+      status = 0 != estar_import_frame (&imp, exp.buf, exp.len)
+	|| compare (&estar, &imp, "key after loss");
+    }
+  }
+  
+  // truncated or corrupted frames are rejected
+  if (0 == status) {
+    copy = malloc (exp.len);
+    memcpy (copy, exp.buf, exp.len);
+    if (0 == estar_import_frame (&imp, copy, exp.len - 1)) {
+      printf ("  ERROR decoded a truncated frame\n");
+      status = 8;
+    }
+    copy[header] = 0xff;	/* tile index out of range */
+    copy[header + 3] = 0xff;
+    if (0 == status && 0 == estar_import_frame (&imp, copy, exp.len)) {
+      printf ("  ERROR decoded a frame with a bad tile index\n");
+      status = 9;
+    }
+    free (copy);
+  }
+  
+  estar_import_fini (&imp);
+  estar_export_fini (&exp);
+  estar_fini (&estar);
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,123 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+#define DIMX 71
+#define DIMY 63
+#define NFRAMES 8
+
+
+/* Apply a sequence of frames through estar_set_speed_frame() and
+   through estar_set_speed() for each cell, with some propagation in
+   between, and require bit-identical phi. Every other frame turns a
+   wall into free space and the next one puts it back, so obstacles
+   that already have finite neighbors disappear and reappear. */
+int main (int argc, char ** argv)
+{
+  static float speed[DIMX * DIMY];
+  static float base[DIMX * DIMY];
+  estar_t frame, each;
+  size_t ii, jj, ix, iy;
+  char what[64];
+  int status;
+  
+  srand (37);
+  test_random_speeds (base, DIMX * DIMY, 6);
+  for (iy = 0; iy < DIMY; ++iy) {
+    base[iy * DIMX + DIMX / 2] = iy < DIMY - 3 ? 0.0f : 0.7f;
+  }
+  estar_init (&frame, DIMX, DIMY);
+  estar_init (&each, DIMX, DIMY);
+  estar_set_goal (&frame, DIMX / 4, DIMY / 3);
+  estar_set_goal (&each, DIMX / 4, DIMY / 3);
+  
+  status = 0;
+  for (ii = 0; ii < NFRAMES && 0 == status; ++ii) {
+    for (jj = 0; jj < DIMX * DIMY; ++jj) {
+      speed[jj] = base[jj];
+    }
+    if (ii % 2) {
+      for (iy = 0; iy < DIMY; ++iy) {
+	speed[iy * DIMX + DIMX / 2] = 0.9f;
+      }
+    }
+    for (jj = 0; jj < DIMX * DIMY / 20; ++jj) {
+      base[rand () % (DIMX * DIMY)] = rand () % 4 ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0;
+    }
+    
+    if (ESTAR_OK != estar_set_speed_frame (&frame, speed)) {
+      printf ("  ERROR estar_set_speed_frame failed on frame %zu\n", ii);
+      status = 1;
+      break;
+    }
+    for (iy = 0; iy < DIMY; ++iy) {
+      for (ix = 0; ix < DIMX; ++ix) {
+	estar_set_speed (&each, ix, iy, speed[iy * DIMX + ix]);
+      }
+    }
+    
+    // Leave the wavefront half way on some frames, and let it finish
+    // on the others.
+    if (ii % 3) {
+      for (jj = 0; jj < 300 * ii; ++jj) {
+	estar_propagate (&frame);
+	estar_propagate (&each);
+      }
+    }
+    else {
+      test_flush (&frame);
+      test_flush (&each);
+    }
+    snprintf (what, sizeof(what), "frame %zu", ii);
+    status = test_compare_phi (&frame, &each, 0.0, what);
+  }
+  
+  if (0 == status) {
+    test_flush (&frame);
+    test_flush (&each);
+    status = test_compare_phi (&frame, &each, 0.0, "after the last frame");
+  }
+  
+  estar_fini (&frame);
+  estar_fini (&each);
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,172 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+/* Neither a multiple of any tile size above one, nor square. */
+#define DIMX 101
+#define DIMY 37
+
+
+/* Plan on random speeds, then repair a few changes, with the cells
+   stored in tiles of the given size. */
+static void plan (estar_t * estar, float const * speed, size_t tile)
+{
+  estar_grid_conf_t conf;
+  size_t ii;
+  
+  estar_grid_conf_default (&conf);
+  conf.tile = tile;
+  estar_init_conf (estar, DIMX, DIMY, &conf);
+  estar_set_speed_bulk (estar, speed, DIMX);
+  estar_set_goal (estar, DIMX / 3, DIMY / 2);
+  test_flush (estar);
+  for (ii = 0; ii < 12; ++ii) {
+    estar_set_speed (estar, (7 * ii) % DIMX, (5 * ii + 3) % DIMY, ii % 3 ? 0.0 : 1.0);
+    estar_set_speed (estar, DIMX - 1, (3 * ii) % DIMY, 0.5);
+    test_flush (estar);
+  }
+}
+
+
+/* Whether two grids with the same dimensions and tile size hold the
+   same cells, including the tile padding, and the same topology. */
+static int same_grid (estar_grid_t * grid, estar_grid_t * ref, char const * what)
+{
+  estar_cell_t * cell;
+  estar_cell_t * want;
+  size_t ii, jj;
+  
+  for (ii = 0; ii < ref->ncells; ++ii) {
+    cell = grid->cell + ii;
+    want = ref->cell + ii;
+    if (cell->cost != want->cost || cell->phi != want->phi || cell->rhs != want->rhs
+	|| cell->key != want->key || cell->pqi != want->pqi || cell->flags != want->flags) {
+      printf ("  ERROR %s: cell %zu differs\n", what, ii);
+      return 1;
+    }
+    for (jj = 0; NULL != want->nbor[jj]; ++jj) {
+      if (cell->nbor[jj] - grid->cell != want->nbor[jj] - ref->cell) {
+	printf ("  ERROR %s: neighbor %zu of cell %zu differs\n", what, jj, ii);
+	return 2;
+      }
+    }
+    if (NULL != cell->nbor[jj]) {
+      printf ("  ERROR %s: cell %zu has too many neighbors\n", what, ii);
+      return 3;
+    }
+  }
+  return 0;
+}
+
+
+/* Initializing and resetting with several threads, or on huge pages
+   (which silently fall back to normal pages), has to give exactly
+   what a single thread gives. */
+static int test_threads (float const * speed)
+{
+  static int const pages[] = { ESTAR_PAGES_DEFAULT, ESTAR_PAGES_THP, ESTAR_PAGES_HUGETLB };
+  estar_grid_conf_t conf;
+  estar_t ref, estar;
+  size_t ii;
+  int status;
+  
+  estar_grid_conf_default (&conf);
+  conf.tile = 4;
+  status = 0;
+  for (ii = 0; 0 == status && ii < sizeof(pages) / sizeof(*pages); ++ii) {
+    conf.nthreads = 1;
+    conf.pages = ESTAR_PAGES_DEFAULT;
+    estar_init_conf (&ref, DIMX, DIMY, &conf);
+    conf.nthreads = 4;
+    conf.pages = pages[ii];
+    estar_init_conf (&estar, DIMX, DIMY, &conf);
+    status = same_grid (&estar.grid, &ref.grid, "init");
+    if (0 == status) {
+      estar_set_speed_bulk (&ref, speed, DIMX);
+      estar_set_speed_bulk (&estar, speed, DIMX);
+      estar_set_goal (&estar, DIMX / 3, DIMY / 2);
+      test_flush (&estar);
+      estar_reset (&estar);
+      status = same_grid (&estar.grid, &ref.grid, "reset");
+    }
+    estar_fini (&estar);
+    estar_fini (&ref);
+  }
+  return status;
+}
+
+
+int main (int argc, char ** argv)
+{
+  static float speed[DIMX * DIMY];
+  static size_t const tile[] = { 2, 4, 8, 16, 64, 0 };
+  char what[32];
+  estar_t ref, estar;
+  size_t ii;
+  int status;
+  
+  srand (23);
+  test_random_speeds (speed, DIMX * DIMY, 5);
+  plan (&ref, speed, 1);
+  
+  // the layout only moves the cells in memory, so phi has to be
+  // bit-identical to the row-major one
+  status = 0;
+  for (ii = 0; 0 == status && 0 != tile[ii]; ++ii) {
+    plan (&estar, speed, tile[ii]);
+    snprintf (what, sizeof(what), "tile %zu", tile[ii]);
+    if (0 != estar_check (&estar, "  ")) {
+      printf ("  ERROR %s: check failed\n", what);
+      status = 1;
+    }
+    else {
+      status = test_compare_phi (&estar, &ref, 0.0, what);
+    }
+    estar_fini (&estar);
+  }
+  estar_fini (&ref);
+  if (0 == status) {
+    status = test_threads (speed);
+  }
+  
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
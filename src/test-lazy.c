@@ -0,0 +1,153 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+
+#define DIMX 91
+#define DIMY 77
+
+
+typedef struct {
+  estar_speed_view_t view;
+  size_t ncalls;
+} counter_t;
+
+
+static double counted (void * data, size_t ix, size_t iy)
+{
+  counter_t * counter = data;
+  ++counter->ncalls;
+  return estar_speed_view (&counter->view, ix, iy);
+}
+
+
+int main (int argc, char ** argv)
+{
+  static float speed[DIMX * DIMY];
+  estar_t lazy, plain;
+  counter_t counter;
+  size_t ii, ix, iy;
+  int status;
+  
+  srand (11);
+  test_random_speeds (speed, DIMX * DIMY, 5);
+  counter.view.speed = speed;
+  counter.view.stride = DIMX;
+  counter.ncalls = 0;
+  
+  // lazy and explicit speeds give the same phi
+  estar_init (&plain, DIMX, DIMY);
+  estar_set_speed_bulk (&plain, speed, DIMX);
+  estar_set_goal (&plain, DIMX / 3, DIMY / 2);
+  test_flush (&plain);
+  estar_init (&lazy, DIMX, DIMY);
+  estar_set_speed_source (&lazy, counted, &counter);
+  estar_set_goal (&lazy, DIMX / 3, DIMY / 2);
+  test_flush (&lazy);
+  status = test_compare_phi (&lazy, &plain, 0.0, "initial");
+  if (0 == status && counter.ncalls > DIMX * DIMY) {
+    printf ("  ERROR %zu calls for %d cells\n", counter.ncalls, DIMX * DIMY);
+    status = 2;
+  }
+  
+  // changes behind and ahead of the wavefront
+  for (ii = 0; 0 == status && ii < 20; ++ii) {
+    ix = rand () % (DIMX - 4);
+    iy = rand () % (DIMY - 4);
+    speed[iy * DIMX + ix] = ii % 2 ? 0.0 : 1.0;
+    speed[(iy + 3) * DIMX + ix + 2] = 0.5;
+    estar_set_speed (&plain, ix, iy, speed[iy * DIMX + ix]);
+    estar_set_speed (&plain, ix + 2, iy + 3, 0.5);
+    estar_invalidate (&lazy, ix, iy, ix + 4, iy + 4);
+    test_flush (&plain);
+    test_flush (&lazy);
+    status = test_compare_phi (&lazy, &plain, 0.0, "invalidate");
+  }
+  
+  // boxes get clipped to the grid, and without a source nothing happens
+  if (0 == status) {
+    speed[(DIMY - 1) * DIMX + DIMX - 2] = 0.3;
+    estar_set_speed (&plain, DIMX - 2, DIMY - 1, 0.3);
+    if (ESTAR_OK != estar_invalidate (&lazy, DIMX - 3, DIMY - 2, DIMX + 5, (size_t) -1)
+	|| ESTAR_OK != estar_invalidate (&plain, 0, 0, 2 * DIMX, 2 * DIMY)) {
+      printf ("  ERROR invalidating boxes beyond the grid\n");
+      status = 5;
+    }
+    else {
+      test_flush (&plain);
+      test_flush (&lazy);
+      status = test_compare_phi (&lazy, &plain, 1e-9, "invalidate beyond the grid");
+    }
+  }
+  estar_fini (&plain);
+  estar_fini (&lazy);
+  
+  // a goal boxed in by obstacles only asks for the cells in the box
+  if (0 == status) {
+    for (ii = 0; ii < DIMX * DIMY; ++ii) {
+      speed[ii] = 1.0;
+    }
+    for (ii = 0; ii < 7; ++ii) {
+      speed[10 * DIMX + 10 + ii] = 0.0;
+      speed[16 * DIMX + 10 + ii] = 0.0;
+      speed[(10 + ii) * DIMX + 10] = 0.0;
+      speed[(10 + ii) * DIMX + 16] = 0.0;
+    }
+    counter.ncalls = 0;
+    estar_init (&lazy, DIMX, DIMY);
+    estar_set_speed_source (&lazy, counted, &counter);
+    estar_set_goal (&lazy, 13, 13);
+    test_flush (&lazy);
+    if (counter.ncalls > 7 * 7) {
+      printf ("  ERROR %zu calls inside a box of %d cells\n", counter.ncalls, 7 * 7);
+      status = 3;
+    }
+    else if ( ! isinf (estar_grid_at (&lazy.grid, 30, 30)->phi)
+	      || isinf (estar_grid_at (&lazy.grid, 12, 14)->phi)) {
+      printf ("  ERROR wrong phi inside or outside of the box\n");
+      status = 4;
+    }
+    estar_fini (&lazy);
+  }
+  
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
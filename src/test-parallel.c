@@ -0,0 +1,134 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/parallel.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+
+#define DIMX 97
+#define DIMY 83
+
+
+static int compare (estar_t * estar, estar_parallel_t * par, char const * what)
+{
+  estar_cell_t * seq;
+  estar_cell_t * cell;
+  size_t ii, ix, iy;
+  
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      seq = estar_grid_at (&estar->grid, ix, iy);
+      cell = estar_parallel_cell (par, ix, iy);
+      if (seq->phi != cell->phi) {
+	printf ("  ERROR %zu threads, %s: phi at %zu %zu is %g instead of %g\n",
+		par->nx * par->ny, what, ix, iy, cell->phi, seq->phi);
+	return 1;
+      }
+    }
+  }
+  for (ii = 0; ii < par->nx * par->ny; ++ii) {
+    if (0 != estar_check (&par->sub[ii].estar, "  ")) {
+      printf ("  ERROR %zu threads, %s: subdomain %zu is inconsistent\n",
+	      par->nx * par->ny, what, ii);
+      return 2;
+    }
+  }
+  return 0;
+}
+
+
+/* Random speeds, then a series of changes, some of them right next to
+   the goal, where they send raise and lower waves across all of the
+   subdomains. */
+static int test_threads (size_t nthreads, unsigned int seed)
+{
+  estar_grid_conf_t conf;
+  estar_parallel_t par;
+  estar_t estar;
+  size_t ii, ix, iy;
+  double speed;
+  int status;
+  
+  estar_grid_conf_default (&conf);
+  conf.tile = 4;
+  estar_init_conf (&estar, DIMX, DIMY, &conf);
+  estar_parallel_init (&par, DIMX, DIMY, nthreads, &conf);
+  srand (seed);
+  for (ii = 0; ii < DIMX * DIMY / 4; ++ii) {
+    ix = rand () % DIMX;
+    iy = rand () % DIMY;
+    speed = (rand () % 4) / 3.0;
+    estar_set_speed (&estar, ix, iy, speed);
+    estar_parallel_set_speed (&par, ix, iy, speed);
+  }
+  estar_set_goal (&estar, DIMX / 3, DIMY / 2);
+  estar_parallel_set_goal (&par, DIMX / 3, DIMY / 2);
+  test_flush (&estar);
+  estar_parallel_propagate (&par);
+  status = compare (&estar, &par, "initial");
+  
+  for (ii = 0; 0 == status && ii < 20; ++ii) {
+    if (ii % 2) {
+      ix = rand () % DIMX;
+      iy = rand () % DIMY;
+    }
+    else {
+      ix = DIMX / 3 + 1 + rand () % 3;
+      iy = DIMY / 2 + rand () % 3;
+    }
+    speed = (rand () % 4) / 3.0;
+    estar_set_speed (&estar, ix, iy, speed);
+    estar_parallel_set_speed (&par, ix, iy, speed);
+    test_flush (&estar);
+    estar_parallel_propagate (&par);
+    status = compare (&estar, &par, "repair");
+  }
+  
+  estar_parallel_fini (&par);
+  estar_fini (&estar);
+  return status;
+}
+
+
+int main (int argc, char ** argv)
+{
+  if (0 == test_threads (1, 1) && 0 == test_threads (4, 2)
+      && 0 == test_threads (6, 3) && 0 == test_threads (16, 4)) {
+    printf ("OK\n");
+    return 0;
+  }
+  return 1;
+}
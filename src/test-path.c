@@ -0,0 +1,209 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/path.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+
+#define DIMX 60
+#define DIMY 40
+#define MAXPOINTS 1000
+
+
+/* Length of the path, and whether it ends in a goal cell. */
+static int check_path (estar_t * estar, double const * xy, size_t npoints, double * length)
+{
+  size_t ii;
+  
+  *length = 0.0;
+  for (ii = 1; ii < npoints; ++ii) {
+    *length += hypot (xy[2 * ii] - xy[2 * ii - 2], xy[2 * ii + 1] - xy[2 * ii - 1]);
+  }
+  ii = npoints - 1;
+  if ( ! (estar_grid_at (&estar->grid, lrint (xy[2 * ii]), lrint (xy[2 * ii + 1]))->flags
+	  & ESTAR_FLAG_GOAL)) {
+    printf ("  ERROR path ends at %g %g\n", xy[2 * ii], xy[2 * ii + 1]);
+    return 1;
+  }
+  return 0;
+}
+
+
+static int check_trace (estar_t * estar)
+{
+  double xy[2 * MAXPOINTS], length;
+  size_t npoints;
+  int status;
+  
+  status = estar_trace_path (&estar->grid, 3.0, 4.0, xy, MAXPOINTS, &npoints);
+  if (ESTAR_PATH_GOAL != status || check_path (estar, xy, npoints, &length)) {
+    printf ("  ERROR status %d after %zu points\n", status, npoints);
+    return 1;
+  }
+  
+  // one or two points per cell, and about as long as phi says
+  if (npoints > 2 * estar_grid_at (&estar->grid, 3, 4)->phi
+      || fabs (length - estar_grid_at (&estar->grid, 3, 4)->phi) > 0.05 * length) {
+    printf ("  ERROR %zu points and length %g for phi %g\n",
+	    npoints, length, estar_grid_at (&estar->grid, 3, 4)->phi);
+    return 2;
+  }
+  
+  status = estar_trace_path (&estar->grid, 3.0, 4.0, xy, 3, &npoints);
+  if (ESTAR_PATH_FULL != status || 3 != npoints || 3.0 != xy[0] || 4.0 != xy[1]) {
+    printf ("  ERROR status %d with %zu points for a short buffer\n", status, npoints);
+    return 3;
+  }
+  
+  // the enclosed corner cannot be reached
+  status = estar_trace_path (&estar->grid, DIMX - 1, DIMY - 1, xy, MAXPOINTS, &npoints);
+  if (ESTAR_PATH_STUCK != status || 1 != npoints) {
+    printf ("  ERROR status %d with %zu points in the enclosed corner\n", status, npoints);
+    return 4;
+  }
+  return 0;
+}
+
+
+/* Whether the cached path is the same as one traced from scratch. */
+static int check_fresh (estar_t * estar, estar_path_t const * path)
+{
+  double xy[2 * MAXPOINTS];
+  size_t npoints;
+  int status;
+  
+  status = estar_trace_path (&estar->grid, 3.0, 4.0, xy, MAXPOINTS, &npoints);
+  if (path->status != status || path->npoints != npoints
+      || 0 != memcmp (path->xy, xy, 2 * npoints * sizeof(*xy))) {
+    printf ("  ERROR cached path differs from a fresh one\n");
+    return 1;
+  }
+  return 0;
+}
+
+
+static int check_cache (estar_t * estar)
+{
+  estar_path_t path;
+  double length;
+  size_t npoints;
+  int status;
+  
+  estar_path_init (&path, MAXPOINTS);
+  status = estar_path_update (&path, estar, 3.0, 4.0);
+  npoints = path.npoints;
+  if (ESTAR_PATH_GOAL != status || npoints != path.nsteps) {
+    printf ("  ERROR first update gives status %d, %zu steps for %zu points\n",
+	    status, path.nsteps, path.npoints);
+    return 1;
+  }
+  if (ESTAR_PATH_GOAL != estar_path_update (&path, estar, 3.0, 4.0) || 0 != path.nsteps) {
+    printf ("  ERROR unchanged path evaluated %zu steps\n", path.nsteps);
+    return 2;
+  }
+  
+  // a change behind the start does not touch any point
+  estar_set_speed (estar, 0, DIMY - 1, 0.5);
+  test_flush (estar);
+  if (ESTAR_PATH_GOAL != estar_path_update (&path, estar, 3.0, 4.0)
+      || npoints != path.npoints || 0 != path.nsteps) {
+    printf ("  ERROR change behind the start evaluated %zu steps\n", path.nsteps);
+    return 3;
+  }
+  
+  // a change beside the goal, off the path, only has the points near
+  // the goal evaluated again
+  estar_set_speed (estar, 58, 32, 0.5);
+  estar_set_speed (estar, 58, 33, 0.5);
+  test_flush (estar);
+  status = estar_path_update (&path, estar, 3.0, 4.0);
+  if (ESTAR_PATH_GOAL != status || npoints != path.npoints
+      || 0 == path.nsteps || path.nsteps > 5) {
+    printf ("  ERROR change beside the goal evaluated %zu steps for %zu points\n",
+	    path.nsteps, path.npoints);
+    return 4;
+  }
+  if (check_fresh (estar, &path)) {
+    return 4;
+  }
+  
+  // a wall near the goal changes the values all along the path
+  estar_set_speed (estar, 42, 25, 0.0);
+  estar_set_speed (estar, 42, 26, 0.0);
+  estar_set_speed (estar, 42, 27, 0.0);
+  estar_set_speed (estar, 42, 28, 0.0);
+  test_flush (estar);
+  status = estar_path_update (&path, estar, 3.0, 4.0);
+  if (ESTAR_PATH_GOAL != status || path.nsteps < path.npoints
+      || check_path (estar, path.xy, path.npoints, &length)) {
+    printf ("  ERROR wall gives status %d, %zu steps for %zu points\n",
+	    status, path.nsteps, path.npoints);
+    return 5;
+  }
+  if (check_fresh (estar, &path)) {
+    return 6;
+  }
+  
+  estar_path_fini (&path);
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  estar_t estar;
+  size_t ii;
+  int status;
+  
+  estar_init (&estar, DIMX, DIMY);
+  for (ii = 0; ii < 5; ++ii) {
+    estar_set_speed (&estar, DIMX - 5, DIMY - 5 + ii, 0.0);
+    estar_set_speed (&estar, DIMX - 5 + ii, DIMY - 5, 0.0);
+  }
+  for (ii = 10; ii < 30; ++ii) {
+    estar_set_speed (&estar, 30, ii, 0.0);
+  }
+  estar_set_goal (&estar, 50, 30);
+  test_flush (&estar);
+  
+  status = check_trace (&estar) || check_cache (&estar);
+  estar_fini (&estar);
+  if (0 == status) {
+    printf ("OK\n");
+  }
+  return status;
+}
@@ -0,0 +1,199 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Check that estar::Planner ends up with bit-identical phi to estar_t
+ * on a 64x64 map with random speeds, for the RowMajor, Tiled<3> and
+ * Fixed<64,64> layouts, after the initial propagation and after a
+ * repair. The scalar is the one the library was built with. */
+
+#include <estar2/planner.hpp>
+#include <estar2/estar.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+
+static size_t const dim = 64;
+
+
+struct Change {
+  size_t ix, iy;
+  double speed;
+};
+
+
+static std::vector<double> make_speed ()
+{
+  std::vector<double> speed (dim * dim);
+  srand (44);
+  for (double & sp : speed) {
+    sp = rand () % 6 ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0;
+  }
+  speed[(dim / 3) * dim + dim / 2] = 1.0;
+  return speed;
+}
+
+
+/* A wall right next to the goal, and a few obstacles that go away. */
+static std::vector<Change> make_repair (std::vector<double> const & speed)
+{
+  std::vector<Change> repair;
+  for (size_t iy = dim / 3 - 4; iy < dim / 3 + 5; ++iy) {
+    repair.push_back ({ dim / 2 + 2, iy, 0.0 });
+  }
+  for (size_t ii = 0; ii < dim * dim && repair.size () < 30; ii += 37) {
+    if (0.0 == speed[ii]) {
+      repair.push_back ({ ii % dim, ii / dim, 0.7 });
+    }
+  }
+  return repair;
+}
+
+
+static void run_c (std::vector<double> const & speed, std::vector<Change> const & repair,
+		   std::vector<double> & before, std::vector<double> & after)
+{
+  estar_t estar;
+  
+  estar_init (&estar, dim, dim);
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      estar_set_speed (&estar, ix, iy, speed[iy * dim + ix]);
+    }
+  }
+  estar_set_goal (&estar, dim / 2, dim / 3);
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+  }
+  for (size_t ii = 0; ii < dim * dim; ++ii) {
+    before[ii] = estar_grid_at (&estar.grid, ii % dim, ii / dim)->phi;
+  }
+  
+  for (Change const & change : repair) {
+    estar_set_speed (&estar, change.ix, change.iy, change.speed);
+  }
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+  }
+  for (size_t ii = 0; ii < dim * dim; ++ii) {
+    after[ii] = estar_grid_at (&estar.grid, ii % dim, ii / dim)->phi;
+  }
+  estar_fini (&estar);
+}
+
+
+template <typename Planner>
+static bool compare (char const * name, char const * what,
+		     Planner const & planner, std::vector<double> const & ref)
+{
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      if (ref[iy * dim + ix] != planner.at (ix, iy).phi) {
+	printf ("  ERROR %s %s: phi at %zu %zu is %g instead of %g\n",
+		name, what, ix, iy, (double) planner.at (ix, iy).phi, ref[iy * dim + ix]);
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+template <typename Planner>
+static bool check (char const * name,
+		   std::vector<double> const & speed, std::vector<Change> const & repair,
+		   std::vector<double> const & before, std::vector<double> const & after)
+{
+  // on the heap, the Fixed layout keeps all cells inside the planner
+  std::unique_ptr<Planner> planner (new Planner (dim, dim));
+  
+  for (size_t iy = 0; iy < dim; ++iy) {
+    for (size_t ix = 0; ix < dim; ++ix) {
+      planner->set_speed (ix, iy, speed[iy * dim + ix]);
+    }
+  }
+  planner->set_goal (dim / 2, dim / 3);
+  planner->flush ();
+  if ( ! compare (name, "initial", *planner, before)) {
+    return false;
+  }
+  
+  for (Change const & change : repair) {
+    planner->set_speed (change.ix, change.iy, change.speed);
+  }
+  planner->flush ();
+  return compare (name, "repair", *planner, after);
+}
+
+
+template <typename Scalar>
+static bool check_all (std::vector<double> const & speed, std::vector<Change> const & repair,
+		       std::vector<double> const & before, std::vector<double> const & after)
+{
+  using namespace estar;
+  bool ok;
+  ok = check<Planner<Scalar, BinaryHeap, RowMajor> >
+    ("RowMajor", speed, repair, before, after);
+  ok = check<Planner<Scalar, BinaryHeap, Tiled<3> > >
+    ("Tiled<3>", speed, repair, before, after) && ok;
+  ok = check<Planner<Scalar, BinaryHeap, Fixed<dim, dim> > >
+    ("Fixed<64,64>", speed, repair, before, after) && ok;
+  return ok;
+}
+
+
+int main (int argc, char ** argv)
+{
+  std::vector<double> const speed = make_speed ();
+  std::vector<Change> const repair = make_repair (speed);
+  std::vector<double> before (dim * dim), after (dim * dim);
+  bool ok;
+  
+  run_c (speed, repair, before, after);
+  if (before == after) {
+    printf ("  ERROR the repair does not change phi\n");
+    return EXIT_FAILURE;
+  }
+  if (0 != estar_compact_enabled ()) {
+    ok = check_all<float> (speed, repair, before, after);
+  }
+  else {
+    ok = check_all<double> (speed, repair, before, after);
+  }
+  if ( ! ok) {
+    return EXIT_FAILURE;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,279 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/pool.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+#define NJOBS 120
+
+
+typedef struct {
+  estar_job_t job;
+  float * speed;
+  size_t gx, gy;
+  double * phi;
+  estar_pool_t * pool;
+  estar_job_t * follow;		/* submitted from the done callback */
+  estar_profile_t * profile;	/* left attached along with other state */
+  estar_recorder_t * recorder;
+  int leftover;			/* got state from an earlier job */
+} request_t;
+
+
+static void setup (estar_t * estar, void * data)
+{
+  request_t * rq = data;
+  
+  if (NULL != estar->focus.cell || NULL != estar->profile || NULL != estar->recorder) {
+    rq->leftover = 1;
+  }
+  estar_set_speed_bulk (estar, rq->speed, rq->job.dimx);
+  estar_set_goal (estar, rq->gx, rq->gy);
+  if (NULL != rq->profile) {
+    estar_set_profile (estar, rq->profile);
+    estar_record_start (estar, rq->recorder, tmpfile ());
+    estar_set_focus (estar, 0, 0);
+    estar_set_roi_box (estar, 0, 0, rq->job.dimx / 2, rq->job.dimy);
+  }
+}
+
+
+static void done (estar_t * estar, void * data)
+{
+  request_t * rq = data;
+  size_t ix, iy;
+  
+  for (iy = 0; iy < rq->job.dimy; ++iy) {
+    for (ix = 0; ix < rq->job.dimx; ++ix) {
+      rq->phi[iy * rq->job.dimx + ix] = estar_grid_at (&estar->grid, ix, iy)->phi;
+    }
+  }
+  if (NULL != rq->follow) {
+    estar_pool_submit (rq->pool, rq->follow);
+  }
+}
+
+
+static void make_request (request_t * rq, estar_pool_t * pool, size_t dimx, size_t dimy)
+{
+  size_t jj, nn;
+  
+  rq->job.dimx = dimx;
+  rq->job.dimy = dimy;
+  rq->job.setup = setup;
+  rq->job.done = done;
+  rq->job.data = rq;
+  nn = rq->job.dimx * rq->job.dimy;
+  rq->speed = malloc (nn * sizeof(*rq->speed));
+  rq->phi = malloc (nn * sizeof(*rq->phi));
+  for (jj = 0; jj < nn; ++jj) {
+    rq->speed[jj] = rand () % 5 ? 0.2f + 0.8f * (rand () % 1000) / 1000.0f : 0.0f;
+  }
+  rq->gx = rand () % rq->job.dimx;
+  rq->gy = rand () % rq->job.dimy;
+  rq->pool = pool;
+  rq->follow = NULL;
+  rq->profile = NULL;
+  rq->recorder = NULL;
+  rq->leftover = 0;
+}
+
+
+static int check (request_t * rq, size_t ii)
+{
+  estar_t estar;
+  size_t ix, iy;
+  int status;
+  
+  estar_init (&estar, rq->job.dimx, rq->job.dimy);
+  estar_set_speed_bulk (&estar, rq->speed, rq->job.dimx);
+  estar_set_goal (&estar, rq->gx, rq->gy);
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+  }
+  status = 0;
+  for (iy = 0; 0 == status && iy < rq->job.dimy; ++iy) {
+    for (ix = 0; ix < rq->job.dimx; ++ix) {
+      if (estar_grid_at (&estar.grid, ix, iy)->phi != rq->phi[iy * rq->job.dimx + ix]) {
+	printf ("  ERROR job %zu: phi at %zu %zu is %g instead of %g\n", ii, ix, iy,
+		rq->phi[iy * rq->job.dimx + ix], estar_grid_at (&estar.grid, ix, iy)->phi);
+	status = 1;
+	break;
+      }
+    }
+  }
+  estar_fini (&estar);
+  return status;
+}
+
+
+static int test_threads (size_t nthreads)
+{
+  request_t rq[NJOBS];
+  estar_pool_t pool;
+  size_t ii;
+  double p50, p99;
+  int status;
+  
+  srand (nthreads);
+  estar_pool_init (&pool, nthreads, NULL);
+  pool.budget = 500;
+  // Two sizes, so that planners of different sizes share the free
+  // list, and some big jobs that need many slices.
+  for (ii = 0; ii < NJOBS; ++ii) {
+    make_request (&rq[ii], &pool, ii % 3 ? 31 : 120, ii % 3 ? 29 : 100);
+  }
+  // the last ten get submitted by the done callbacks of the first ten
+  for (ii = 0; ii < 10; ++ii) {
+    rq[ii].follow = &rq[NJOBS - 10 + ii].job;
+  }
+  for (ii = 0; ii < NJOBS - 10; ++ii) {
+    estar_pool_submit (&pool, &rq[ii].job);
+  }
+  estar_pool_wait (&pool);
+  
+  status = 0;
+  for (ii = 0; 0 == status && ii < NJOBS; ++ii) {
+    status = check (&rq[ii], ii);
+  }
+  if (0 == status && pool.ninstances > 2 * pool.max_active) {
+    printf ("  ERROR %zu threads: %zu planners for at most %zu active jobs\n",
+	    nthreads, pool.ninstances, pool.max_active);
+    status = 2;
+  }
+  estar_pool_latency (&pool, &p50, &p99);
+  if (0 == status && (pool.nlatency != NJOBS || p50 <= 0.0 || p99 < p50)) {
+    printf ("  ERROR %zu threads: %zu latencies, p50 %g p99 %g\n",
+	    nthreads, pool.nlatency, p50, p99);
+    status = 3;
+  }
+  
+  estar_pool_fini (&pool);
+  for (ii = 0; ii < NJOBS; ++ii) {
+    free (rq[ii].speed);
+    free (rq[ii].phi);
+  }
+  return status;
+}
+
+
+/* Jobs of many sizes keep only the most recently used planners. */
+static int test_sizes (void)
+{
+  request_t rq[NJOBS];
+  estar_pool_t pool;
+  size_t ii;
+  int status;
+  
+  srand (46);
+  estar_pool_init (&pool, 2, NULL);
+  pool.max_free = 3;
+  status = 0;
+  for (ii = 0; ii < NJOBS; ++ii) {
+    make_request (&rq[ii], &pool, 10 + ii, 20);
+    estar_pool_submit (&pool, &rq[ii].job);
+    if (0 == ii % 4) {
+      estar_pool_wait (&pool);
+    }
+  }
+  estar_pool_wait (&pool);
+  
+  for (ii = 0; 0 == status && ii < NJOBS; ++ii) {
+    status = check (&rq[ii], ii);
+  }
+  if (0 == status && (pool.nfree > pool.max_free || pool.ninstances != pool.nfree)) {
+    printf ("  ERROR %zu planners, %zu of them free, for at most %zu free\n",
+	    pool.ninstances, pool.nfree, pool.max_free);
+    status = 4;
+  }
+  
+  estar_pool_fini (&pool);
+  for (ii = 0; ii < NJOBS; ++ii) {
+    free (rq[ii].speed);
+    free (rq[ii].phi);
+  }
+  return status;
+}
+
+
+/* A job that leaves focus, region of interest, profile and recorder
+   behind does not pass them on to the next job on the same planner. */
+static int test_leftovers (void)
+{
+  request_t rq[2];
+  estar_pool_t pool;
+  estar_profile_t profile;
+  estar_recorder_t recorder;
+  size_t ii;
+  int status;
+  
+  srand (50);
+  estar_pool_init (&pool, 1, NULL);
+  estar_profile_init (&profile);
+  for (ii = 0; ii < 2; ++ii) {
+    make_request (&rq[ii], &pool, 40, 30);
+  }
+  rq[0].profile = &profile;
+  rq[0].recorder = &recorder;
+  estar_pool_submit (&pool, &rq[0].job);
+  estar_pool_wait (&pool);
+  fclose (recorder.fp);
+  estar_pool_submit (&pool, &rq[1].job);
+  estar_pool_wait (&pool);
+  
+  status = check (&rq[1], 1);
+  if (0 == status && (rq[1].leftover || 1 != pool.ninstances)) {
+    printf ("  ERROR the planner of the next job kept focus, profile or recorder\n");
+    status = 5;
+  }
+  
+  estar_pool_fini (&pool);
+  for (ii = 0; ii < 2; ++ii) {
+    free (rq[ii].speed);
+    free (rq[ii].phi);
+  }
+  return status;
+}
+
+
+int main (int argc, char ** argv)
+{
+  if (0 == test_threads (1) && 0 == test_threads (3) && 0 == test_threads (8)
+      && 0 == test_sizes () && 0 == test_leftovers ()) {
+    printf ("OK\n");
+    return 0;
+  }
+  return 1;
+}
@@ -48,7 +48,7 @@ static int check (estar_pqueue_t * pq, double * key, size_t len)
       printf ("  ERROR queue empty at ii = %zu\n", ii);
       return 1;
     }
-    if (cell->key != key[ii]) {
+    if (cell->key != (estar_real_t) key[ii]) {
       printf ("  ERROR key at ii = %zu is %g but should be %g\n", ii, cell->key, key[ii]);
       return 2;
     }
@@ -68,6 +68,59 @@ static int check (estar_pqueue_t * pq, double * key, size_t len)
 }
 
 
+static int check_remove (void)
+{
+  estar_t estar;
+  double rhs[] = { 1.0, 10.0, 2.0, 11.0, 12.0, 3.0, 4.0 };
+  double key[] = { 1.0, 2.0, 3.0, 4.0, 10.0, 12.0 };
+  size_t ii;
+  int status;
+  
+  // Removing the 11 moves the 4 from the other branch of the heap
+  // below the 10, so it has to bubble up.
+  estar_init (&estar, 10, 1);
+  for (ii = 0; ii < sizeof(rhs) / sizeof(double); ++ii) {
+    estar.grid.cell[ii].rhs = rhs[ii];
+    estar_pqueue_insert_or_update (&estar.pq, &estar.grid.cell[ii]);
+  }
+  estar_pqueue_remove_or_ignore (&estar.pq, &estar.grid.cell[3]);
+  status = check (&estar.pq, key, sizeof(key) / sizeof(double));
+  
+  estar_fini (&estar);
+  return status;
+}
+
+
+static int check_shrink (void)
+{
+  estar_t estar;
+  size_t ii, peak;
+  
+  estar_init (&estar, 100, 100);
+  for (ii = 0; ii < estar.grid.ncells; ++ii) {
+    estar.grid.cell[ii].rhs = ii;
+    estar_pqueue_insert_or_update (&estar.pq, &estar.grid.cell[ii]);
+  }
+  peak = estar.pq.cap;
+  
+  while (estar.pq.len > 0) {
+    estar_pqueue_extract (&estar.pq);
+    if (estar.pq.len > estar.pq.cap) {
+      printf ("  ERROR queue length %zu exceeds capacity %zu\n", estar.pq.len, estar.pq.cap);
+      return 1;
+    }
+  }
+  if (estar.pq.cap != estar.pq.mincap) {
+    printf ("  ERROR capacity %zu (peak %zu) did not shrink back to %zu\n",
+	    estar.pq.cap, peak, estar.pq.mincap);
+    return 2;
+  }
+  
+  estar_fini (&estar);
+  return 0;
+}
+
+
 int main (int argc, char ** argv)
 {
   estar_t estar;
@@ -110,7 +163,9 @@ int main (int argc, char ** argv)
   printf ("after removal of %p\n", &estar.grid.cell[2]);
   estar_dump_queue (&estar, "  ");
   
-  if (0 == check (&estar.pq, key, sizeof(key) / sizeof(double))) {
+  if (0 == check (&estar.pq, key, sizeof(key) / sizeof(double))
+      && 0 == check_remove ()
+      && 0 == check_shrink ()) {
     printf ("OK\n");
   }
   
@@ -0,0 +1,167 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+static int check_buckets (void)
+{
+  uint64_t value, low, next;
+  size_t bucket, shift;
+  
+  for (shift = 0; shift < 64; ++shift) {
+    for (value = (uint64_t) 1 << shift; value != 0; value >>= 1) {
+      bucket = estar_hist_bucket (value + (value >> 3));
+      if (bucket >= ESTAR_HIST_NBUCKETS) {
+	printf ("  ERROR bucket %zu out of range\n", bucket);
+	return 1;
+      }
+      low = estar_hist_bucket_low (bucket);
+      next = bucket + 1 < ESTAR_HIST_NBUCKETS ? estar_hist_bucket_low (bucket + 1) : UINT64_MAX;
+      if (value + (value >> 3) < low || (value + (value >> 3) >= next && next != UINT64_MAX)) {
+	printf ("  ERROR %llu not in [%llu, %llu)\n", (unsigned long long) value,
+		(unsigned long long) low, (unsigned long long) next);
+	return 2;
+      }
+      if (low > 16 && (value + (value >> 3) - low) * 16 > low) {
+	printf ("  ERROR %llu too far from %llu\n", (unsigned long long) value,
+		(unsigned long long) low);
+	return 3;
+      }
+    }
+  }
+  if (UINT64_MAX < estar_hist_bucket_low (ESTAR_HIST_NBUCKETS - 1)
+      || ESTAR_HIST_NBUCKETS - 1 != estar_hist_bucket (UINT64_MAX)) {
+    printf ("  ERROR last bucket does not hold UINT64_MAX\n");
+    return 4;
+  }
+  return 0;
+}
+
+
+typedef struct {
+  size_t nseen;
+  estar_epoch_t first;
+} seen_t;
+
+
+static void on_epoch (void * data, estar_epoch_t const * epoch)
+{
+  seen_t * seen = data;
+  if (0 == seen->nseen++) {
+    seen->first = *epoch;
+  }
+}
+
+
+static int check_epochs (void)
+{
+  estar_t estar;
+  estar_profile_t profile;
+  seen_t seen;
+  size_t ii;
+  
+  estar_init (&estar, 30, 30);
+  estar_profile_init (&profile);
+  seen.nseen = 0;
+  profile.on_epoch = on_epoch;
+  profile.on_epoch_data = &seen;
+  estar_set_profile (&estar, &profile);
+  
+  // changes the wavefront has not reached leave nothing to propagate,
+  // so they must not open an epoch that the goal would then join
+  estar_set_speed (&estar, 20, 20, 0.5);
+  if (profile.active) {
+    printf ("  ERROR a change far from any goal opened an epoch\n");
+    return 5;
+  }
+  
+  estar_set_goal (&estar, 2, 2);
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+  }
+  
+  // a flickering wall right next to the goal
+  for (ii = 0; ii < 10; ++ii) {
+    estar_set_speed (&estar, 4, 1, 0 == ii % 2 ? 0.0 : 1.0);
+    estar_set_speed (&estar, 4, 3, 0 == ii % 2 ? 0.0 : 1.0);
+    while (0 != estar.pq.len) {
+      estar_propagate (&estar);
+    }
+  }
+  
+  if (11 != profile.nepochs || 11 != seen.nseen || 11 != profile.raised.total) {
+    printf ("  ERROR %llu epochs, %zu callbacks\n",
+	    (unsigned long long) profile.nepochs, seen.nseen);
+    return 1;
+  }
+  if (1 != seen.first.nchanges || 2 != seen.first.xmax || 2 != seen.first.ymax) {
+    printf ("  ERROR first epoch has %zu changes up to %zu %zu\n",
+	    seen.first.nchanges, seen.first.xmax, seen.first.ymax);
+    return 6;
+  }
+  if (900 != profile.lowered.max || 0 != profile.raised.min || 0 == profile.raised.max) {
+    printf ("  ERROR lowered max %llu raised min %llu max %llu\n",
+	    (unsigned long long) profile.lowered.max,
+	    (unsigned long long) profile.raised.min,
+	    (unsigned long long) profile.raised.max);
+    return 2;
+  }
+  if (2 != profile.worst.nchanges || 4 != profile.worst.xmin || 4 != profile.worst.xmax
+      || 1 != profile.worst.ymin || 3 != profile.worst.ymax) {
+    printf ("  ERROR worst epoch %llu has %zu changes in [%zu %zu %zu %zu]\n",
+	    (unsigned long long) profile.worst.id, profile.worst.nchanges,
+	    profile.worst.xmin, profile.worst.ymin, profile.worst.xmax, profile.worst.ymax);
+    return 3;
+  }
+  
+  if (0 != estar_profile_write_json (&profile, stdout)) {
+    printf ("  ERROR writing profile\n");
+    return 4;
+  }
+  
+  estar_fini (&estar);
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  if (0 == check_buckets () && 0 == check_epochs ()) {
+    printf ("OK\n");
+    return 0;
+  }
+  return 1;
+}
@@ -0,0 +1,280 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include <estar2/query.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+
+#define DIMX 37
+#define DIMY 29
+
+
+static void setup (estar_t * estar)
+{
+  estar_grid_conf_t conf;
+  size_t iy;
+  
+  // tiles that do not divide the grid, so that queries straddle them
+  estar_grid_conf_default (&conf);
+  conf.tile = 4;
+  estar_init_conf (estar, DIMX, DIMY, &conf);
+  for (iy = 5; iy < 25; ++iy) {
+    estar_set_speed (estar, 20, iy, 0.0);
+  }
+  estar_set_speed (estar, 8, 8, 0.5);
+  estar_set_goal (estar, 30, 14);
+  while (0 != estar->pq.len) {
+    estar_propagate (estar);
+  }
+}
+
+
+static int check_centers (estar_t * estar)
+{
+  double xy[2 * DIMX], phi[DIMX], grad[2 * DIMX], gx, gy;
+  estar_cell_t * cell;
+  size_t ix, iy, nfinite;
+  
+  // at cell centers, phi is exactly that of the cell
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      xy[2 * ix] = ix;
+      xy[2 * ix + 1] = iy;
+    }
+    nfinite = estar_query (&estar->grid, DIMX, xy, phi, grad);
+    for (ix = 0; ix < DIMX; ++ix) {
+      cell = estar_grid_at (&estar->grid, ix, iy);
+      if (phi[ix] != cell->phi) {
+	printf ("  ERROR phi at %zu %zu is %g instead of %g\n", ix, iy, phi[ix], cell->phi);
+	return 1;
+      }
+      if (isinf (cell->phi)) {
+	++nfinite;
+      }
+      
+      // next to obstacles, the gradient is that of the cell itself
+      if (isinf (estar_grid_at (&estar->grid, ix < DIMX - 1 ? ix + 1 : ix - 1, iy)->phi)
+	  || isinf (estar_grid_at (&estar->grid, ix, iy < DIMY - 1 ? iy + 1 : iy - 1)->phi)) {
+	if (isinf (cell->phi) || 0 == estar_cell_calc_gradient (cell, &gx, &gy)) {
+	  gx = gy = 0.0;
+	}
+	if (gx != grad[2 * ix] || gy != grad[2 * ix + 1]) {
+	  printf ("  ERROR gradient at %zu %zu is %g %g instead of %g %g\n",
+		  ix, iy, grad[2 * ix], grad[2 * ix + 1], gx, gy);
+	  return 2;
+	}
+      }
+    }
+    if (DIMX != nfinite) {
+      printf ("  ERROR row %zu has %zu finite and infinite values\n", iy, nfinite);
+      return 3;
+    }
+  }
+  return 0;
+}
+
+
+static int check_interpolation (estar_t * estar)
+{
+  double xy[2], phi, grad[2], p00, p10, p01, p11;
+  
+  // halfway between four free cells far from the wall and the goal
+  xy[0] = 25.5;
+  xy[1] = 3.5;
+  estar_query (&estar->grid, 1, xy, &phi, grad);
+  p00 = estar_grid_at (&estar->grid, 25, 3)->phi;
+  p10 = estar_grid_at (&estar->grid, 26, 3)->phi;
+  p01 = estar_grid_at (&estar->grid, 25, 4)->phi;
+  p11 = estar_grid_at (&estar->grid, 26, 4)->phi;
+  if (fabs (phi - (p00 + p10 + p01 + p11) / 4.0) > 1e-12
+      || fabs (grad[0] + (p10 - p00 + p11 - p01) / 2.0) > 1e-12
+      || fabs (grad[1] + (p01 - p00 + p11 - p10) / 2.0) > 1e-12) {
+    printf ("  ERROR phi %g gradient %g %g at 25.5 3.5\n", phi, grad[0], grad[1]);
+    return 1;
+  }
+  
+  // south-west of the goal, the way down leads north and east
+  if (grad[0] <= 0.0 || grad[1] <= 0.0) {
+    printf ("  ERROR gradient %g %g points away from the goal\n", grad[0], grad[1]);
+    return 2;
+  }
+  
+  // outside of the grid, and on its outermost half cells
+  xy[0] = -0.6;
+  xy[1] = 3.0;
+  if (0 != estar_query (&estar->grid, 1, xy, &phi, grad) || ! isinf (phi)
+      || 0.0 != grad[0] || 0.0 != grad[1]) {
+    printf ("  ERROR phi %g gradient %g %g outside of the grid\n", phi, grad[0], grad[1]);
+    return 3;
+  }
+  xy[0] = DIMX - 0.6;
+  xy[1] = -0.4;
+  if (1 != estar_query (&estar->grid, 1, xy, &phi, NULL)
+      || phi != estar_grid_at (&estar->grid, DIMX - 1, 0)->phi) {
+    printf ("  ERROR phi %g in the corner of the grid\n", phi);
+    return 4;
+  }
+  return 0;
+}
+
+
+static int check_batch (estar_t * estar)
+{
+  size_t const npoints = 1000;
+  double * xy;
+  double * phi;
+  double * grad;
+  double one, onegrad[2];
+  size_t ii;
+  int status;
+  
+  // a batch spanning several blocks gives the same results as
+  // querying each point by itself
+  xy = malloc (2 * npoints * sizeof(*xy));
+  phi = malloc (npoints * sizeof(*phi));
+  grad = malloc (2 * npoints * sizeof(*grad));
+  srand (42);
+  for (ii = 0; ii < 2 * npoints; ++ii) {
+    xy[ii] = (rand () % 4200) / 100.0 - 2.0;
+  }
+  estar_query (&estar->grid, npoints, xy, phi, grad);
+  status = 0;
+  for (ii = 0; ii < npoints; ++ii) {
+    estar_query (&estar->grid, 1, xy + 2 * ii, &one, onegrad);
+    if (one != phi[ii] || onegrad[0] != grad[2 * ii] || onegrad[1] != grad[2 * ii + 1]) {
+      printf ("  ERROR point %zu at %g %g differs in batch\n", ii, xy[2 * ii], xy[2 * ii + 1]);
+      status = 1;
+      break;
+    }
+  }
+  free (xy);
+  free (phi);
+  free (grad);
+  return status;
+}
+
+
+static int compare_field (estar_t * estar, double const * gx, double const * gy)
+{
+  estar_cell_t * cell;
+  double cx, cy;
+  size_t ix, iy;
+  
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      cell = estar_grid_at (&estar->grid, ix, iy);
+      if (isinf (cell->rhs) || 0 == estar_cell_calc_gradient (cell, &cx, &cy)) {
+	cx = cy = 0.0;
+      }
+      if (cx != gx[iy * DIMX + ix] || cy != gy[iy * DIMX + ix]) {
+	printf ("  ERROR field at %zu %zu is %g %g instead of %g %g\n",
+		ix, iy, gx[iy * DIMX + ix], gy[iy * DIMX + ix], cx, cy);
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+
+static int check_field (estar_t * estar)
+{
+  double gx[DIMX * DIMY], gy[DIMX * DIMY], sx[DIMX * DIMY], sy[DIMX * DIMY];
+  unsigned long long since;
+  size_t ii, ncomputed;
+  
+  since = 0;
+  if (DIMX * DIMY != estar_compute_gradient_field (estar, 0, 0, DIMX, DIMY,
+						   gx, gy, DIMX, &since)
+      || since != estar->version || compare_field (estar, gx, gy)) {
+    return 1;
+  }
+  
+  // a wall cell next to finite ones gets infinite components from
+  // estar_cell_calc_gradient() but a zero gradient in the field
+  if (0 == estar_cell_calc_gradient (estar_grid_at (&estar->grid, 20, 10), &sx[0], &sy[0])
+      || ! isinf (sx[0]) || 0.0 != gx[10 * DIMX + 20] || 0.0 != gy[10 * DIMX + 20]) {
+    printf ("  ERROR wall cell gets %g %g in the field\n",
+	    gx[10 * DIMX + 20], gy[10 * DIMX + 20]);
+    return 1;
+  }
+  
+  // a part of the field, written with a different stride
+  estar_compute_gradient_field (estar, 3, 5, 20, 9, sx, sy, DIMX, NULL);
+  for (ii = 0; ii < 20 * 9; ++ii) {
+    if (sx[(ii / 20) * DIMX + ii % 20] != gx[(5 + ii / 20) * DIMX + 3 + ii % 20]
+	|| sy[(ii / 20) * DIMX + ii % 20] != gy[(5 + ii / 20) * DIMX + 3 + ii % 20]) {
+      printf ("  ERROR partial field differs at %zu\n", ii);
+      return 2;
+    }
+  }
+  
+  // nothing changed, nothing to do
+  if (0 != estar_compute_gradient_field (estar, 0, 0, DIMX, DIMY, gx, gy, DIMX, &since)) {
+    printf ("  ERROR field recomputed without changes\n");
+    return 3;
+  }
+  
+  // slow down the far corner: only the parts around it get
+  // recomputed, and the result matches the current rhs everywhere
+  estar_set_speed (estar, DIMX - 2, DIMY - 2, 0.25);
+  while (0 != estar->pq.len) {
+    estar_propagate (estar);
+  }
+  ncomputed = estar_compute_gradient_field (estar, 0, 0, DIMX, DIMY, gx, gy, DIMX, &since);
+  if (0 == ncomputed || DIMX * DIMY == ncomputed) {
+    printf ("  ERROR recomputed %zu of %d cells after a local change\n",
+	    ncomputed, DIMX * DIMY);
+    return 4;
+  }
+  return compare_field (estar, gx, gy) ? 5 : 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  estar_t estar;
+  int status;
+  
+  setup (&estar);
+  status = check_centers (&estar) || check_interpolation (&estar) || check_batch (&estar)
+    || check_field (&estar);
+  estar_fini (&estar);
+  if (0 == status) {
+    printf ("OK\n");
+  }
+  return status;
+}
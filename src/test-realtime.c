@@ -0,0 +1,191 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Checks that, after estar_reserve(), replanning cycles do not
+   allocate any memory, and that a full queue gets reported instead of
+   killing the process. The allocator is interposed by defining
+   malloc and friends here, which takes precedence over the libc
+   definitions also for calls made from within libestar2. */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+extern void * __libc_malloc (size_t size);
+extern void * __libc_calloc (size_t nmemb, size_t size);
+extern void * __libc_realloc (void * ptr, size_t size);
+extern void __libc_free (void * ptr);
+
+static int counting = 0;
+static size_t nalloc = 0;
+
+
+void * malloc (size_t size)
+{
+  nalloc += counting;
+  return __libc_malloc (size);
+}
+
+
+void * calloc (size_t nmemb, size_t size)
+{
+  nalloc += counting;
+  return __libc_calloc (nmemb, size);
+}
+
+
+void * realloc (void * ptr, size_t size)
+{
+  nalloc += counting;
+  return __libc_realloc (ptr, size);
+}
+
+
+void free (void * ptr)
+{
+  nalloc += counting && NULL != ptr;
+  __libc_free (ptr);
+}
+
+
+static int test_cycles (size_t dimx, size_t dimy, size_t ncycles)
+{
+  estar_t estar;
+  size_t ii, jj, ix, iy;
+  int status;
+  
+  estar_init (&estar, dimx, dimy);
+  if (ESTAR_OK != estar_reserve (&estar, dimx * dimy)) {
+    printf ("  ERROR estar_reserve failed\n");
+    return 1;
+  }
+  
+  srand (42);
+  counting = 1;
+  status = estar_set_goal (&estar, dimx / 2, dimy / 2);
+  if (ESTAR_OK == status) {
+    status = test_flush (&estar);
+  }
+  
+  // each cycle drops a few obstacles, replans, and removes them again
+  for (ii = 0; ii < ncycles && ESTAR_OK == status; ++ii) {
+    for (jj = 0; jj < 20 && ESTAR_OK == status; ++jj) {
+      ix = rand () % dimx;
+      iy = rand () % dimy;
+      if (ix != dimx / 2 || iy != dimy / 2) {
+	status = estar_set_speed (&estar, ix, iy, 0.0);
+      }
+    }
+    if (ESTAR_OK == status) {
+      status = test_flush (&estar);
+    }
+    for (ix = 0; ix < dimx && ESTAR_OK == status; ++ix) {
+      for (iy = 0; iy < dimy && ESTAR_OK == status; ++iy) {
+	status = estar_set_speed (&estar, ix, iy, 1.0);
+      }
+    }
+    if (ESTAR_OK == status) {
+      status = test_flush (&estar);
+    }
+  }
+  counting = 0;
+  
+  if (ESTAR_OK != status) {
+    printf ("  ERROR status %d in cycle %zu\n", status, ii);
+    return 2;
+  }
+  if (0 != nalloc) {
+    printf ("  ERROR %zu allocations during %zu cycles\n", nalloc, ncycles);
+    return 3;
+  }
+  if (0 != estar_check (&estar, "  ")) {
+    printf ("  ERROR inconsistent after %zu cycles\n", ncycles);
+    return 4;
+  }
+  
+  estar_fini (&estar);
+  return 0;
+}
+
+
+static int test_full (void)
+{
+  estar_t estar;
+  size_t ix, iy;
+  int status;
+  
+  // The queue starts out with room for dimx + dimy cells, so it
+  // overflows when we set more goals than that.
+  estar_init (&estar, 20, 20);
+  if (ESTAR_OK != estar_reserve (&estar, 0)) {
+    printf ("  ERROR estar_reserve failed\n");
+    return 1;
+  }
+  
+  status = ESTAR_OK;
+  counting = 1;
+  for (iy = 0; iy < 20 && ESTAR_OK == status; iy += 2) {
+    for (ix = 0; ix < 20 && ESTAR_OK == status; ++ix) {
+      status = estar_set_goal (&estar, ix, iy);
+    }
+  }
+  counting = 0;
+  
+  if (ESTAR_EFULL != status) {
+    printf ("  ERROR status %d instead of ESTAR_EFULL\n", status);
+    return 2;
+  }
+  if (estar.pq.len != estar.pq.cap) {
+    printf ("  ERROR queue length %zu but capacity %zu\n", estar.pq.len, estar.pq.cap);
+    return 3;
+  }
+  if (0 != nalloc) {
+    printf ("  ERROR %zu allocations\n", nalloc);
+    return 4;
+  }
+  
+  estar_fini (&estar);
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  if (0 == test_cycles (40, 30, 10) && 0 == test_full ()) {
+    printf ("OK\n");
+    return 0;
+  }
+  return 1;
+}
@@ -0,0 +1,146 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+
+#define DIMX 53
+#define DIMY 47
+
+
+/* Record a session and replay it with estar-replay -c, which has to
+   arrive at exactly the recorded phi. Part of the speeds get set
+   before recording starts, and those take the path through the
+   initial snapshot of the costs, as does the first region of
+   interest. */
+int main (int argc, char ** argv)
+{
+  static float speed[DIMX * DIMY];
+  char fname[] = "/tmp/test-record-XXXXXX";
+  char cmd[1024];
+  char const * slash;
+  estar_t estar;
+  estar_recorder_t rec;
+  FILE * fp;
+  size_t ii;
+  int fd, status;
+  
+  fd = mkstemp (fname);
+  if (-1 == fd || NULL == (fp = fdopen (fd, "wb"))) {
+    printf ("  ERROR cannot create %s\n", fname);
+    return 1;
+  }
+  
+  srand (37);
+  test_random_speeds (speed, DIMX * DIMY, 6);
+  estar_init (&estar, DIMX, DIMY);
+  estar_set_speed_bulk (&estar, speed, DIMX);
+  estar_set_roi_box (&estar, 0, 0, DIMX - 3, DIMY);
+  status = estar_record_start (&estar, &rec, fp);
+  
+  estar_set_goal (&estar, DIMX / 4, DIMY / 3);
+  test_flush (&estar);
+  estar_record_phi (&estar);
+  for (ii = 0; ii < 20; ++ii) {
+    estar_set_speed (&estar, rand () % DIMX, rand () % DIMY,
+		     ii % 3 ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0);
+    if (ii % 4) {
+      test_flush (&estar);
+    }
+  }
+  test_flush (&estar);
+  estar_record_phi (&estar);
+  estar_set_roi_box (&estar, 2, 0, DIMX, DIMY - 4);
+  test_flush (&estar);
+  estar_record_phi (&estar);
+  estar_set_roi (&estar, NULL, 0);
+  estar_set_focus (&estar, DIMX - 2, DIMY - 2);
+  while ( ! estar_focus_done (&estar)) {
+    estar_propagate (&estar);
+  }
+  estar_clear_focus (&estar);
+  test_flush (&estar);
+  estar_record_phi (&estar);
+  
+  if (0 != status || 0 != estar_record_stop (&estar)) {
+    printf ("  ERROR writing %s\n", fname);
+    status = 2;
+  }
+  fclose (fp);
+  estar_fini (&estar);
+  
+  // estar-replay gets built next to this program
+  if (0 == status) {
+    slash = strrchr (argv[0], '/');
+    snprintf (cmd, sizeof(cmd), "%.*sestar-replay -c -q %s",
+	      NULL == slash ? 2 : (int) (slash - argv[0] + 1),
+	      NULL == slash ? "./" : argv[0], fname);
+    if (0 != system (cmd)) {
+      printf ("  ERROR %s failed\n", cmd);
+      status = 3;
+    }
+  }
+  
+  // a goal off the grid has to be rejected, not written somewhere
+  if (0 == status) {
+    fp = fopen (fname, "wb");
+    estar_init (&estar, DIMX, DIMY);
+    if (NULL == fp || 0 != estar_record_start (&estar, &rec, fp)) {
+      printf ("  ERROR cannot rewrite %s\n", fname);
+      status = 4;
+    }
+    else {
+      estar_record (&rec, ESTAR_RECORD_GOAL, DIMX, 0, 0.0);
+      estar_record_stop (&estar);
+      fclose (fp);
+      strcat (cmd, " 2>/dev/null");
+      if (0 == system (cmd)) {
+	printf ("  ERROR %s accepted a goal off the grid\n", cmd);
+	status = 5;
+      }
+    }
+    estar_fini (&estar);
+  }
+  
+  unlink (fname);
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,168 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+
+#define DIMX 93
+#define DIMY 71
+
+
+/* The region of interest has to behave just like obstacles all around
+   it, which get removed or added as the region changes. */
+static void emulate (estar_t * twin, float const * speed, unsigned char const * mask)
+{
+  size_t ix, iy;
+  double want;
+  
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      want = NULL == mask || mask[iy * DIMX + ix] ? speed[iy * DIMX + ix] : 0.0;
+      if (want != (isinf (estar_grid_at (&twin->grid, ix, iy)->cost) ? 0.0 : speed[iy * DIMX + ix])) {
+	estar_set_speed (twin, ix, iy, want);
+      }
+    }
+  }
+  test_flush (twin);
+}
+
+
+int main (int argc, char ** argv)
+{
+  static float speed[DIMX * DIMY];
+  static unsigned char mask[DIMX * DIMY];
+  estar_t estar, twin;
+  size_t ix, iy, nexpanded;
+  unsigned long long version;
+  int status;
+  
+  srand (17);
+  test_random_speeds (speed, DIMX * DIMY, 5);
+  estar_init (&estar, DIMX, DIMY);
+  estar_set_speed_bulk (&estar, speed, DIMX);
+  estar_init (&twin, DIMX, DIMY);
+  estar_set_speed_bulk (&twin, speed, DIMX);
+  
+  // a corridor around the goal: nothing outside gets reached
+  estar_set_roi_box (&estar, DIMX / 4 - 5, DIMY / 2 - 8, DIMX / 4 + 30, DIMY / 2 + 8);
+  estar_set_goal (&estar, DIMX / 4, DIMY / 2);
+  nexpanded = 0;
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+    ++nexpanded;
+  }
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      mask[iy * DIMX + ix] = ix >= DIMX / 4 - 5 && ix < DIMX / 4 + 30
+	&& iy >= DIMY / 2 - 8 && iy < DIMY / 2 + 8;
+    }
+  }
+  emulate (&twin, speed, mask);
+  estar_set_goal (&twin, DIMX / 4, DIMY / 2);
+  test_flush (&twin);
+  status = 0 != estar_check (&estar, "  ")
+    || test_compare_phi (&estar, &twin, 0.0, "box");
+  if (0 == status && nexpanded > 35 * 16) {
+    printf ("  ERROR %zu expansions in a box of %d cells\n", nexpanded, 35 * 16);
+    status = 2;
+  }
+  
+  // growing the region continues where the border stopped
+  if (0 == status) {
+    for (iy = 0; iy < DIMY; ++iy) {
+      for (ix = 0; ix < DIMX; ++ix) {
+	mask[iy * DIMX + ix] = ix < DIMX / 2 + 10 && iy > 5;
+      }
+    }
+    estar_set_roi (&estar, mask, DIMX);
+    test_flush (&estar);
+    emulate (&twin, speed, mask);
+    status = 0 != estar_check (&estar, "  ")
+      || test_compare_phi (&estar, &twin, 0.0, "grown");
+  }
+  if (0 == status) {
+    estar_set_roi (&estar, NULL, 0);
+    test_flush (&estar);
+    emulate (&twin, speed, NULL);
+    status = 0 != estar_check (&estar, "  ")
+      || test_compare_phi (&estar, &twin, 0.0, "whole grid");
+  }
+  
+  // shrinking it repairs the cells that were cut off
+  if (0 == status) {
+    for (iy = 0; iy < DIMY; ++iy) {
+      for (ix = 0; ix < DIMX; ++ix) {
+	mask[iy * DIMX + ix] = (ix - DIMX / 4.0) * (ix - DIMX / 4.0)
+	  + 4.0 * (iy - DIMY / 2.0) * (iy - DIMY / 2.0) < 900.0;
+      }
+    }
+    estar_set_roi (&estar, mask, DIMX);
+    test_flush (&estar);
+    emulate (&twin, speed, mask);
+    status = 0 != estar_check (&estar, "  ")
+      || test_compare_phi (&estar, &twin, 0.0, "shrunk");
+  }
+  
+  // cells far from the wavefront still count as changed when they
+  // join or leave the region
+  if (0 == status) {
+    version = estar.version;
+    mask[DIMX - 1] = 1;
+    estar_set_roi (&estar, mask, DIMX);
+    if ( ! estar_changed_since (&estar, DIMX - 1, 0, DIMX, 1, version)) {
+      printf ("  ERROR joining the region does not show in the stamps\n");
+      status = 3;
+    }
+  }
+  if (0 == status) {
+    version = estar.version;
+    mask[DIMX - 1] = 0;
+    estar_set_roi (&estar, mask, DIMX);
+    if ( ! estar_changed_since (&estar, DIMX - 1, 0, DIMX, 1, version)) {
+      printf ("  ERROR leaving the region does not show in the stamps\n");
+      status = 4;
+    }
+  }
+  
+  estar_fini (&twin);
+  estar_fini (&estar);
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
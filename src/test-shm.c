@@ -0,0 +1,285 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* A producer process publishes a series of repairs of the same map,
+ * and several consumer processes read tiles while it does so. Each
+ * consistent tile has to match the producer's state after one of the
+ * rounds, which the consumers recompute for themselves, and once the
+ * producer is done, all tiles have to match the last round. The
+ * producer also checks after each round that the tiles it skipped
+ * were indeed unchanged. */
+
+#include <estar2/shm.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+
+
+#define DIMX 61
+#define DIMY 53
+#define TILE 16
+#define TDIMX ((DIMX + TILE - 1) / TILE)
+#define TDIMY ((DIMY + TILE - 1) / TILE)
+#define NROUNDS 30
+#define NCONSUMERS 3
+
+
+typedef struct {
+  double * phi;
+  double * rhs;
+  uint8_t * flags;
+} state_t;
+
+
+static estar_t estar;
+static state_t state[NROUNDS];	/* in the order of the region */
+static estar_shm_header_t layout;
+
+
+static void flush (void)
+{
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+  }
+}
+
+
+/* Round zero is the initial propagation. Each further round toggles
+   an obstacle next to the goal, moving away from it. */
+static void round_step (size_t round)
+{
+  size_t ii, ix, iy;
+  
+  if (0 == round) {
+    estar_init (&estar, DIMX, DIMY);
+    srand (17);
+    for (iy = 0; iy < DIMY; ++iy) {
+      for (ix = 0; ix < DIMX; ++ix) {
+	estar_set_speed (&estar, ix, iy,
+			 rand () % 10 ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0);
+      }
+    }
+    estar_set_goal (&estar, DIMX / 3, DIMY / 2);
+  }
+  else {
+    ii = (round - 1) / 2;
+    estar_set_speed (&estar, DIMX / 3 + 1 + ii % 5, DIMY / 2 + ii / 5, round % 2 ? 0.0 : 1.0);
+  }
+  flush ();
+}
+
+
+static void save_state (state_t * st)
+{
+  size_t const ncells = layout.tdimx * layout.tdimy * TILE * TILE;
+  estar_cell_t const * cell;
+  size_t ix, iy, ii;
+  
+  st->phi = malloc (ncells * sizeof(*st->phi));
+  st->rhs = malloc (ncells * sizeof(*st->rhs));
+  st->flags = malloc (ncells);
+  for (ii = 0; ii < ncells; ++ii) {
+    st->phi[ii] = INFINITY;
+    st->rhs[ii] = INFINITY;
+    st->flags[ii] = ESTAR_FLAG_OBSTACLE;
+  }
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      cell = estar_grid_at (&estar.grid, ix, iy);
+      ii = estar_shm_index (&layout, ix, iy);
+      st->phi[ii] = cell->phi;
+      st->rhs[ii] = cell->rhs;
+      st->flags[ii] = cell->flags;
+    }
+  }
+}
+
+
+static int same_tile (state_t const * st, size_t base,
+		      double const * phi, double const * rhs, uint8_t const * flags)
+{
+  return 0 == memcmp (st->phi + base, phi, TILE * TILE * sizeof(*phi))
+    && 0 == memcmp (st->rhs + base, rhs, TILE * TILE * sizeof(*rhs))
+    && 0 == memcmp (st->flags + base, flags, TILE * TILE);
+}
+
+
+static int consume (char const * name)
+{
+  double phi[TILE * TILE], rhs[TILE * TILE];
+  uint8_t flags[TILE * TILE];
+  uint64_t last[TDIMY][TDIMX], version;
+  estar_shm_t shm;
+  size_t tx, ty, base, rr;
+  int done, final;
+  time_t t0;
+  
+  if (0 != estar_shm_open (&shm, name)) {
+    printf ("  ERROR consumer %d: cannot open %s\n", (int) getpid (), name);
+    return 1;
+  }
+  memset (last, 0, sizeof(last));
+  t0 = time (NULL);
+  for (done = 0, final = 0; ! final; ) {
+    final = done;
+    done = 2 * NROUNDS == estar_shm_seq (&shm);
+    if (time (NULL) - t0 > 20) {
+      printf ("  ERROR consumer %d: producer did not finish\n", (int) getpid ());
+      return 2;
+    }
+    for (ty = 0; ty < shm.header->tdimy; ++ty) {
+      for (tx = 0; tx < shm.header->tdimx; ++tx) {
+	version = estar_shm_read_tile (&shm, tx, ty, phi, rhs, flags);
+	if (version < last[ty][tx]) {
+	  printf ("  ERROR consumer %d: tile %zu %zu went back from version %llu to %llu\n",
+		  (int) getpid (), tx, ty,
+		  (unsigned long long) last[ty][tx], (unsigned long long) version);
+	  return 3;
+	}
+	last[ty][tx] = version;
+	if (0 == version) {
+	  continue;		/* not published yet */
+	}
+	base = (ty * shm.header->tdimx + tx) * TILE * TILE;
+	for (rr = final ? NROUNDS - 1 : 0; rr < NROUNDS; ++rr) {
+	  if (same_tile (&state[rr], base, phi, rhs, flags)) {
+	    break;
+	  }
+	}
+	if (NROUNDS == rr) {
+	  printf ("  ERROR consumer %d: tile %zu %zu version %llu matches %s\n",
+		  (int) getpid (), tx, ty, (unsigned long long) version,
+		  final ? "not the last round" : "none of the rounds");
+	  return 4;
+	}
+      }
+    }
+  }
+  estar_shm_close (&shm);
+  return 0;
+}
+
+
+static int produce (estar_shm_t * shm)
+{
+  struct timespec const pause = { 0, 2000000 };
+  size_t rr, nwritten, total;
+  
+  total = 0;
+  for (rr = 0; rr < NROUNDS; ++rr) {
+    round_step (rr);
+    nwritten = estar_shm_publish (shm, &estar);
+    total += nwritten;
+    if (0 == rr && nwritten != layout.tdimx * layout.tdimy) {
+      printf ("  ERROR producer: first publication wrote %zu tiles\n", nwritten);
+      return 1;
+    }
+    if (0 != memcmp (shm->phi, state[rr].phi,
+		     layout.tdimx * layout.tdimy * TILE * TILE * sizeof(double))
+	|| 0 != memcmp (shm->flags, state[rr].flags, layout.tdimx * layout.tdimy * TILE * TILE)) {
+      printf ("  ERROR producer: round %zu differs after writing %zu tiles\n", rr, nwritten);
+      return 2;
+    }
+    nanosleep (&pause, NULL);
+  }
+  if (total == NROUNDS * layout.tdimx * layout.tdimy) {
+    printf ("  ERROR producer: repairs always rewrote all tiles\n");
+    return 3;
+  }
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  char name[64];
+  estar_shm_t shm, other;
+  pid_t pid[NCONSUMERS];
+  size_t ii;
+  int status, wstatus;
+  
+  // everybody computes the expected states beforehand
+  layout.tile = TILE;
+  layout.tdimx = TDIMX;
+  layout.tdimy = TDIMY;
+  for (ii = 0; ii < NROUNDS; ++ii) {
+    round_step (ii);
+    save_state (&state[ii]);
+  }
+  estar_fini (&estar);
+  
+  snprintf (name, sizeof(name), "/estar-test-shm-%d", (int) getpid ());
+  if (0 != estar_shm_create (&shm, name, DIMX, DIMY, TILE)) {
+    perror ("estar_shm_create");
+    return 1;
+  }
+  
+  // a second producer cannot take over the name, and tiles need a size
+  if (-1 != estar_shm_create (&other, name, DIMX, DIMY, TILE) || EEXIST != errno) {
+    printf ("  ERROR second producer of %s\n", name);
+    return 1;
+  }
+  snprintf (name, sizeof(name), "/estar-test-shm-%d-zero", (int) getpid ());
+  if (-1 != estar_shm_create (&other, name, DIMX, DIMY, 0) || EINVAL != errno) {
+    printf ("  ERROR region with a tile size of zero\n");
+    return 1;
+  }
+  snprintf (name, sizeof(name), "/estar-test-shm-%d", (int) getpid ());
+  for (ii = 0; ii < NCONSUMERS; ++ii) {
+    pid[ii] = fork ();
+    if (0 == pid[ii]) {
+      exit (consume (name));
+    }
+  }
+  
+  status = produce (&shm);
+  for (ii = 0; ii < NCONSUMERS; ++ii) {
+    if (pid[ii] < 0 || pid[ii] != waitpid (pid[ii], &wstatus, 0)
+	|| ! WIFEXITED (wstatus) || 0 != WEXITSTATUS (wstatus)) {
+      status = 10;
+    }
+  }
+  estar_shm_close (&shm);
+  estar_fini (&estar);
+  
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,134 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/estar.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+
+#define DIMX 67
+#define DIMY 53
+
+
+/* Every cell that went onto the queue is either still on it, or got
+   removed or extracted since. */
+static int check_queue (estar_t * estar, char const * what)
+{
+  estar_stats_t st;
+  
+  estar_stats_snapshot (estar, &st);
+  if (st.pq_insert - st.pq_remove - st.pq_extract != estar->pq.len) {
+    printf ("  ERROR %s: %llu inserts, %llu removes, %llu extracts, but %zu queued\n",
+	    what, st.pq_insert, st.pq_remove, st.pq_extract, (size_t) estar->pq.len);
+    return 1;
+  }
+  return 0;
+}
+
+
+static int flush (estar_t * estar, char const * what)
+{
+  while (0 != estar->pq.len) {
+    estar_propagate (estar);
+    if (0 != check_queue (estar, what)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+int main (int argc, char ** argv)
+{
+  estar_t estar;
+  estar_stats_t st;
+  size_t ii, ix, iy;
+  int status;
+  
+  if ( ! estar_stats_enabled ()) {
+    printf ("  ERROR the library has been built without ESTAR_STATS\n");
+    return 1;
+  }
+  
+  estar_init (&estar, DIMX, DIMY);
+  srand (29);
+  for (iy = 0; iy < DIMY; ++iy) {
+    for (ix = 0; ix < DIMX; ++ix) {
+      estar_set_speed (&estar, ix, iy, rand () % 5 ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0);
+    }
+  }
+  estar_set_goal (&estar, DIMX / 2, DIMY / 3);
+  status = check_queue (&estar, "goal") || flush (&estar, "initial");
+  
+  // repairs raise and lower cells, and remove some from the queue
+  for (ii = 0; 0 == status && ii < 30; ++ii) {
+    estar_set_speed (&estar, rand () % DIMX, rand () % DIMY, ii % 2 ? 0.0 : 1.0);
+    status = check_queue (&estar, "change");
+    if (0 == status && ii % 3) {
+      status = flush (&estar, "repair");
+    }
+  }
+  
+  // without focus, each extraction is either a raise or a lower, and
+  // each rhs computation yields at least one candidate value
+  if (0 == status) {
+    estar_stats_snapshot (&estar, &st);
+    if (st.raise + st.lower != st.pq_extract) {
+      printf ("  ERROR %llu raises and %llu lowers for %llu extracts\n",
+	      st.raise, st.lower, st.pq_extract);
+      status = 2;
+    }
+    else if (0 == st.raise || 0 == st.pq_remove || 0 == st.pq_update || 0 == st.interpolated
+	     || st.interpolated + st.non_interpolated < st.calc_rhs - st.fallback) {
+      printf ("  ERROR implausible counters\n");
+      status = 3;
+    }
+  }
+  
+  // resetting the counters
+  if (0 == status) {
+    estar_stats_reset (&estar);
+    estar_stats_snapshot (&estar, &st);
+    if (0 != st.pq_insert || 0 != st.calc_rhs || 0 != st.lower) {
+      printf ("  ERROR counters survive estar_stats_reset()\n");
+      status = 4;
+    }
+  }
+  
+  estar_fini (&estar);
+  if (0 != status) {
+    return status;
+  }
+  printf ("OK\n");
+  return 0;
+}
@@ -0,0 +1,84 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test-util.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+
+int test_flush (estar_t * estar)
+{
+  int status;
+  
+  while (0 != estar->pq.len) {
+    status = estar_propagate (estar);
+    if (ESTAR_OK != status) {
+      return status;
+    }
+  }
+  return ESTAR_OK;
+}
+
+
+int test_compare_phi (estar_t * estar, estar_t * ref, double tol, char const * what)
+{
+  double phi, want;
+  size_t ix, iy;
+  
+  for (iy = 0; iy < ref->grid.dimy; ++iy) {
+    for (ix = 0; ix < ref->grid.dimx; ++ix) {
+      phi = estar_grid_at (&estar->grid, ix, iy)->phi;
+      want = estar_grid_at (&ref->grid, ix, iy)->phi;
+      if (phi == want) {
+	continue;
+      }
+      if (0.0 == tol || isinf (phi) || isinf (want)
+	  || fabs (phi - want) > tol * (fabs (want) > 1.0 ? fabs (want) : 1.0)) {
+	printf ("  ERROR %s: phi at %zu %zu is %g instead of %g\n", what, ix, iy, phi, want);
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+
+void test_random_speeds (float * speed, size_t n, int obstacle_one_in)
+{
+  size_t ii;
+  
+  for (ii = 0; ii < n; ++ii) {
+    speed[ii] = rand () % obstacle_one_in ? 0.2 + 0.8 * (rand () % 1000) / 1000.0 : 0.0;
+  }
+}
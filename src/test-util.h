@@ -0,0 +1,57 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Fixtures shared by the test-* programs. They print what went wrong
+   and return non-zero on failure, like the checks in each test. */
+
+#ifndef ESTAR2_TEST_UTIL_H
+#define ESTAR2_TEST_UTIL_H
+
+#include <estar2/estar.h>
+
+
+/* Propagate until the queue is empty. Returns ESTAR_OK, or the first
+   error estar_propagate() reports. */
+int test_flush (estar_t * estar);
+
+/* Compare phi of two planners on grids of the same size, cell by
+   cell. A tol of zero asks for bit-identical values, otherwise they
+   may differ by tol relative to the reference (absolute below one).
+   Infinity only matches infinity. */
+int test_compare_phi (estar_t * estar, estar_t * ref, double tol, char const * what);
+
+/* Fill speed[0..n) from rand(): one in obstacle_one_in is an obstacle
+   (zero speed), the others lie in [0.2, 1]. Continuous speeds, because
+   speeds restricted to a few values can keep E* from converging. */
+void test_random_speeds (float * speed, size_t n, int obstacle_one_in);
+
+#endif
@@ -0,0 +1,219 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/volume.h>
+#include <estar2/estar.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+
+static void flush (estar_volume_t * vol)
+{
+  while (0 != vol->len) {
+    estar_volume_propagate (vol);
+  }
+}
+
+
+static int close_enough (double aa, double bb)
+{
+  if (isinf (aa) || isinf (bb)) {
+    return isinf (aa) && isinf (bb);
+  }
+  return fabs (aa - bb) <= 1e-5 * (1.0 + fabs (aa));
+}
+
+
+/* A volume that is one voxel high is a 2D grid. */
+static int test_flat (void)
+{
+  size_t const dimx = 41;
+  size_t const dimy = 33;
+  estar_volume_t vol;
+  estar_t estar;
+  size_t ii, ix, iy;
+  double speed, phi;
+  int status;
+  
+  estar_volume_init (&vol, dimx, dimy, 1);
+  estar_init (&estar, dimx, dimy);
+  srand (1);
+  for (ii = 0; ii < dimx * dimy / 4; ++ii) {
+    ix = rand () % dimx;
+    iy = rand () % dimy;
+    speed = (rand () % 4) / 3.0;
+    estar_volume_set_speed (&vol, ix, iy, 0, speed);
+    estar_set_speed (&estar, ix, iy, speed);
+  }
+  estar_volume_set_goal (&vol, 12, 20, 0);
+  estar_set_goal (&estar, 12, 20);
+  flush (&vol);
+  while (0 != estar.pq.len) {
+    estar_propagate (&estar);
+  }
+  
+  status = 0;
+  for (iy = 0; 0 == status && iy < dimy; ++iy) {
+    for (ix = 0; ix < dimx; ++ix) {
+      phi = estar_grid_at (&estar.grid, ix, iy)->phi;
+      if ( ! close_enough (estar_volume_at (&vol, ix, iy, 0)->phi, phi)) {
+	printf ("  ERROR flat phi at %zu %zu is %g instead of %g\n",
+		ix, iy, estar_volume_at (&vol, ix, iy, 0)->phi, phi);
+	status = 1;
+	break;
+      }
+    }
+  }
+  estar_volume_fini (&vol);
+  estar_fini (&estar);
+  return status;
+}
+
+
+static int test_open (void)
+{
+  size_t const dim = 21;
+  estar_volume_t vol;
+  size_t ix, iy, iz;
+  double phi;
+  int status;
+  
+  estar_volume_init (&vol, dim, dim, dim);
+  estar_volume_set_goal (&vol, 10, 10, 10);
+  flush (&vol);
+  
+  status = 0;
+  for (ix = 0; ix < dim; ++ix) {
+    if (fabs (estar_volume_at (&vol, ix, 10, 10)->phi - fabs (ix - 10.0)) > 1e-6) {
+      printf ("  ERROR phi at %zu 10 10 is %g\n", ix, estar_volume_at (&vol, ix, 10, 10)->phi);
+      status = 1;
+    }
+  }
+  
+  // the diagonal is neither a Manhattan distance nor too short
+  phi = estar_volume_at (&vol, 0, 0, 0)->phi;
+  if (phi < sqrt (300.0) || phi > 1.1 * sqrt (300.0)) {
+    printf ("  ERROR phi at the corner is %g\n", phi);
+    status = 2;
+  }
+  
+  // symmetric along all axes
+  for (iz = 0; iz < dim; ++iz) {
+    for (iy = 0; iy < dim; ++iy) {
+      for (ix = 0; ix < dim; ++ix) {
+	phi = estar_volume_at (&vol, ix, iy, iz)->phi;
+	if (phi != estar_volume_at (&vol, iy, iz, ix)->phi
+	    || phi != estar_volume_at (&vol, dim - 1 - ix, iy, iz)->phi) {
+	  printf ("  ERROR phi at %zu %zu %zu is not symmetric\n", ix, iy, iz);
+	  return 3;
+	}
+      }
+    }
+  }
+  
+  estar_volume_fini (&vol);
+  return status;
+}
+
+
+/* Repairs after changing speeds end up where planning from scratch
+   does. */
+static int test_repair (void)
+{
+  size_t const dim = 16;
+  size_t const nchanges = 30;
+  estar_volume_t vol, ref;
+  size_t ii, ix[30], iy[30], iz[30], jx, jy, jz;
+  int status;
+  
+  estar_volume_init (&vol, dim, dim, dim);
+  estar_volume_init (&ref, dim, dim, dim);
+  srand (2);
+  for (ii = 0; ii < dim * dim * dim / 5; ++ii) {
+    jx = rand () % dim;
+    jy = rand () % dim;
+    jz = rand () % dim;
+    estar_volume_set_speed (&vol, jx, jy, jz, 0.0);
+  }
+  estar_volume_set_goal (&vol, 3, 4, 5);
+  flush (&vol);
+  
+  for (ii = 0; ii < nchanges; ++ii) {
+    ix[ii] = rand () % dim;
+    iy[ii] = rand () % dim;
+    iz[ii] = rand () % dim;
+    estar_volume_set_speed (&vol, ix[ii], iy[ii], iz[ii], ii % 3 ? 0.0 : 0.5);
+    flush (&vol);
+  }
+  
+  for (jz = 0; jz < dim; ++jz) {
+    for (jy = 0; jy < dim; ++jy) {
+      for (jx = 0; jx < dim; ++jx) {
+	*estar_volume_at (&ref, jx, jy, jz) = *estar_volume_at (&vol, jx, jy, jz);
+      }
+    }
+  }
+  estar_volume_reset (&ref);
+  estar_volume_set_goal (&ref, 3, 4, 5);
+  flush (&ref);
+  
+  status = 0;
+  for (jz = 0; 0 == status && jz < dim; ++jz) {
+    for (jy = 0; 0 == status && jy < dim; ++jy) {
+      for (jx = 0; jx < dim; ++jx) {
+	if ( ! close_enough (estar_volume_at (&vol, jx, jy, jz)->phi,
+			     estar_volume_at (&ref, jx, jy, jz)->phi)) {
+	  printf ("  ERROR repaired phi at %zu %zu %zu is %g instead of %g\n",
+		  jx, jy, jz, estar_volume_at (&vol, jx, jy, jz)->phi,
+		  estar_volume_at (&ref, jx, jy, jz)->phi);
+	  status = 1;
+	  break;
+	}
+      }
+    }
+  }
+  estar_volume_fini (&vol);
+  estar_volume_fini (&ref);
+  return status;
+}
+
+
+int main (int argc, char ** argv)
+{
+  if (0 == test_flat () && 0 == test_open () && 0 == test_repair ()) {
+    printf ("OK\n");
+    return 0;
+  }
+  return 1;
+}
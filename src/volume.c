@@ -0,0 +1,328 @@
+/* Minimal Estar implementation for 2D grid with LSM kernel.
+ *
+ * Copyright (C) 2013 Roland Philippsen. All rights reserved.
+ *
+ * BSD license:
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of
+ *    contributors to this software may be used to endorse or promote
+ *    products derived from this software without specific prior written
+ *    permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHORS AND CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR THE CONTRIBUTORS TO THIS SOFTWARE BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <estar2/volume.h>
+
+#include <stdlib.h>
+#include <math.h>
+#include <err.h>
+
+#define HEAP_NODE estar_voxel_t
+#include "heap.h"
+
+
+static void init_voxels (estar_volume_t * vol)
+{
+  estar_voxel_t * voxel;
+  size_t ix, iy, iz;
+  
+  voxel = vol->voxel;
+  for (iz = 0; iz < vol->dimz + 2; ++iz) {
+    for (iy = 0; iy < vol->dimy + 2; ++iy) {
+      for (ix = 0; ix < vol->dimx + 2; ++ix, ++voxel) {
+	voxel->phi = INFINITY;
+	voxel->rhs = INFINITY;
+	voxel->key = INFINITY;
+	voxel->pqi = 0;
+	if (0 == ix || 0 == iy || 0 == iz
+	    || ix > vol->dimx || iy > vol->dimy || iz > vol->dimz) {
+	  voxel->cost = INFINITY;
+	  voxel->flags = ESTAR_FLAG_OBSTACLE;
+	}
+	else {
+	  voxel->cost = 1.0f;
+	  voxel->flags = 0;
+	}
+      }
+    }
+  }
+}
+
+
+void estar_volume_init (estar_volume_t * vol, size_t dimx, size_t dimy, size_t dimz)
+{
+  if (0 == dimx || 0 == dimy || 0 == dimz) {
+    errx (EXIT_FAILURE, __FILE__": %s: empty volume", __func__);
+  }
+  vol->dimx = dimx;
+  vol->dimy = dimy;
+  vol->dimz = dimz;
+  vol->step[0] = 1;
+  vol->step[1] = dimx + 2;
+  vol->step[2] = (dimx + 2) * (dimy + 2);
+  vol->nvoxels = vol->step[2] * (dimz + 2);
+  if (vol->nvoxels >= (size_t) UINT32_MAX) {
+    errx (EXIT_FAILURE, __FILE__": %s: %zu voxels are too many", __func__, vol->nvoxels);
+  }
+  vol->voxel = malloc (vol->nvoxels * sizeof(*vol->voxel));
+  vol->cap = dimx * dimy + dimy * dimz + dimz * dimx;
+  vol->heap = malloc ((vol->cap + 1) * sizeof(*vol->heap));
+  if (NULL == vol->voxel || NULL == vol->heap) {
+    errx (EXIT_FAILURE, __FILE__": %s: malloc", __func__);
+  }
+  vol->len = 0;
+  init_voxels (vol);
+}
+
+
+void estar_volume_fini (estar_volume_t * vol)
+{
+  free (vol->voxel);
+  free (vol->heap);
+  vol->voxel = NULL;
+  vol->heap = NULL;
+  vol->len = 0;
+  vol->cap = 0;
+}
+
+
+void estar_volume_reset (estar_volume_t * vol)
+{
+  estar_voxel_t * voxel;
+  
+  for (voxel = vol->voxel; voxel != vol->voxel + vol->nvoxels; ++voxel) {
+    voxel->phi = INFINITY;
+    voxel->rhs = INFINITY;
+    voxel->key = INFINITY;
+    voxel->pqi = 0;
+    voxel->flags &= ~ESTAR_FLAG_GOAL;
+  }
+  vol->len = 0;
+}
+
+
+static void enqueue (estar_volume_t * vol, estar_voxel_t * voxel)
+{
+  estar_voxel_t ** heap;
+  
+  voxel->key = voxel->rhs < voxel->phi ? voxel->rhs : voxel->phi;
+  if (0 != voxel->pqi) {
+    heap_update (vol->heap, vol->len, voxel);
+    return;
+  }
+  if (vol->len == vol->cap) {
+    heap = realloc (vol->heap, (2 * vol->cap + 1) * sizeof(*heap));
+    if (NULL == heap) {
+      errx (EXIT_FAILURE, __FILE__": %s: realloc", __func__);
+    }
+    vol->heap = heap;
+    vol->cap *= 2;
+  }
+  heap_insert (vol->heap, ++vol->len, voxel);
+}
+
+
+static void dequeue (estar_volume_t * vol, estar_voxel_t * voxel)
+{
+  if (0 != voxel->pqi) {
+    vol->len = heap_remove (vol->heap, vol->len, voxel);
+  }
+}
+
+
+/* Solve the eikonal equation for the lowest values along each axis,
+   aa <= bb <= cc, in as many dimensions as they allow: a neighbor only
+   contributes if it lies below the result. The one and two
+   dimensional cases are the same as interpolate() in estar.c. */
+static double interpolate (double cost, double aa, double bb, double cc)
+{
+  double sum, rr;
+  
+  rr = aa + cost;
+  if (rr <= bb) {
+    return rr;
+  }
+  sum = aa + bb;
+  rr = (sum + sqrt (sum * sum - 2.0 * (aa * aa + bb * bb - cost * cost))) / 2.0;
+  if (rr <= cc) {
+    return rr;
+  }
+  sum = aa + bb + cc;
+  return (sum + sqrt (sum * sum - 3.0 * (aa * aa + bb * bb + cc * cc - cost * cost))) / 3.0;
+}
+
+
+static void calc_rhs (estar_volume_t * vol, estar_voxel_t * voxel, double phimax)
+{
+  estar_voxel_t const * nbor;
+  double best[3], tmp, rr;
+  size_t ii;
+  
+  // Like in estar.c, do not propagate from obstacles, queued voxels,
+  // voxels above the wavefront, or voxels at infinity.
+  for (ii = 0; ii < 3; ++ii) {
+    best[ii] = INFINITY;
+    nbor = voxel - vol->step[ii];
+    if ( ! (nbor->flags & ESTAR_FLAG_OBSTACLE) && 0 == nbor->pqi && nbor->phi <= phimax) {
+      best[ii] = nbor->phi;
+    }
+    nbor = voxel + vol->step[ii];
+    if ( ! (nbor->flags & ESTAR_FLAG_OBSTACLE) && 0 == nbor->pqi && nbor->phi <= phimax
+	&& nbor->phi < best[ii]) {
+      best[ii] = nbor->phi;
+    }
+  }
+  
+  // sort the three axes
+  if (best[1] < best[0]) {
+    tmp = best[0]; best[0] = best[1]; best[1] = tmp;
+  }
+  if (best[2] < best[1]) {
+    tmp = best[1]; best[1] = best[2]; best[2] = tmp;
+    if (best[1] < best[0]) {
+      tmp = best[0]; best[0] = best[1]; best[1] = tmp;
+    }
+  }
+  
+  if ( ! isinf (best[0])) {
+    voxel->rhs = interpolate (voxel->cost, best[0], best[1], best[2]);
+    return;
+  }
+  
+  // same fallback as in estar.c
+  rr = INFINITY;
+  for (ii = 0; ii < 3; ++ii) {
+    if (voxel[- vol->step[ii]].phi < rr) {
+      rr = voxel[- vol->step[ii]].phi;
+    }
+    if (voxel[vol->step[ii]].phi < rr) {
+      rr = voxel[vol->step[ii]].phi;
+    }
+  }
+  voxel->rhs = rr + voxel->cost;
+}
+
+
+static void update (estar_volume_t * vol, estar_voxel_t * voxel)
+{
+  if (voxel->flags & ESTAR_FLAG_OBSTACLE) {
+    dequeue (vol, voxel);
+    return;
+  }
+  if ( ! (voxel->flags & ESTAR_FLAG_GOAL)) {
+    calc_rhs (vol, voxel, 0 == vol->len ? INFINITY : vol->heap[1]->key);
+  }
+  if (voxel->phi != voxel->rhs) {
+    enqueue (vol, voxel);
+  }
+  else {
+    dequeue (vol, voxel);
+  }
+}
+
+
+static void update_around (estar_volume_t * vol, estar_voxel_t * voxel)
+{
+  size_t ii;
+  for (ii = 0; ii < 3; ++ii) {
+    update (vol, voxel - vol->step[ii]);
+    update (vol, voxel + vol->step[ii]);
+  }
+}
+
+
+void estar_volume_set_goal (estar_volume_t * vol, size_t ix, size_t iy, size_t iz)
+{
+  estar_voxel_t * goal = estar_volume_at (vol, ix, iy, iz);
+  goal->rhs = 0.0f;
+  goal->flags |= ESTAR_FLAG_GOAL;
+  goal->flags &= ~ESTAR_FLAG_OBSTACLE;
+  enqueue (vol, goal);
+}
+
+
+/* See untouched() in estar.c. */
+static int untouched (estar_volume_t const * vol, estar_voxel_t const * voxel)
+{
+  size_t ii;
+  
+  if (0 != voxel->pqi || ! isinf (voxel->phi) || ! isinf (voxel->rhs)
+      || (voxel->flags & ESTAR_FLAG_GOAL)) {
+    return 0;
+  }
+  for (ii = 0; ii < 3; ++ii) {
+    if ( ! isinf (voxel[- vol->step[ii]].phi) || ! isinf (voxel[vol->step[ii]].phi)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+
+void estar_volume_set_speed (estar_volume_t * vol, size_t ix, size_t iy, size_t iz,
+			     double speed)
+{
+  estar_voxel_t * voxel;
+  float cost;
+  int need_update;
+  
+  voxel = estar_volume_at (vol, ix, iy, iz);
+  cost = speed <= 0.0 ? INFINITY : 1.0 / speed;
+  if (cost == voxel->cost) {
+    return;
+  }
+  need_update = ! untouched (vol, voxel);
+  voxel->cost = cost;
+  if (isinf (cost)) {
+    voxel->phi = INFINITY;
+    voxel->rhs = INFINITY;
+    voxel->flags |= ESTAR_FLAG_OBSTACLE;
+  }
+  else {
+    voxel->flags &= ~ESTAR_FLAG_OBSTACLE;
+  }
+  if (need_update) {
+    update (vol, voxel);
+    update_around (vol, voxel);
+  }
+}
+
+
+void estar_volume_propagate (estar_volume_t * vol)
+{
+  estar_voxel_t * voxel;
+  
+  if (0 == vol->len) {
+    return;
+  }
+  voxel = heap_extract (vol->heap, vol->len--);
+  
+  if (voxel->phi > voxel->rhs) {
+    voxel->phi = voxel->rhs;
+    update_around (vol, voxel);
+  }
+  else {
+    voxel->phi = INFINITY;
+    update_around (vol, voxel);
+    update (vol, voxel);
+  }
+}